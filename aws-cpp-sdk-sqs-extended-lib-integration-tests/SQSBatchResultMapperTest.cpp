@@ -0,0 +1,77 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/external/gtest.h>
+#include <aws/sqs/model/DeleteMessageBatchResult.h>
+#include <aws/sqs/model/DeleteMessageRequest.h>
+#include <aws/sqs/SQSClient.h>
+#include <aws/sqs/extendedlib/SQSBatchResultMapper.h>
+
+using namespace Aws;
+using namespace Aws::SQS;
+using namespace Aws::SQS::Model;
+using namespace Aws::SQS::ExtendedLib;
+
+namespace
+{
+  Aws::Vector<DeleteMessageOutcome> MapDeleteOutcomes (const DeleteMessageBatchOutcome& outcome, size_t entryCount)
+  {
+    return SQSBatchResultMapper::Map<DeleteMessageOutcome> (outcome, entryCount, [] (const DeleteMessageBatchResultEntry&)
+    {
+      return DeleteMessageOutcome (NoResult ());
+    });
+  }
+}
+
+TEST(SQSBatchResultMapperTest, TestMapsEntriesByPosition)
+{
+  DeleteMessageBatchResult result;
+  DeleteMessageBatchResultEntry resultEntry;
+  resultEntry.SetId (SQSBatchResultMapper::GetEntryId (2));
+  result.AddSuccessful (resultEntry);
+  BatchResultErrorEntry errorEntry;
+  errorEntry.SetId (SQSBatchResultMapper::GetEntryId (0));
+  errorEntry.SetCode ("ReceiptHandleIsInvalid");
+  errorEntry.SetSenderFault (true);
+  result.AddFailed (errorEntry);
+  errorEntry.SetId (SQSBatchResultMapper::GetEntryId (3));
+  errorEntry.SetCode ("InternalError");
+  errorEntry.SetSenderFault (false);
+  result.AddFailed (errorEntry);
+  // ids out of the batch are ignored
+  resultEntry.SetId ("7");
+  result.AddSuccessful (resultEntry);
+
+  Aws::Vector<DeleteMessageOutcome> outcomes = MapDeleteOutcomes (DeleteMessageBatchOutcome (result), 4);
+  ASSERT_EQ(4u, outcomes.size ());
+  EXPECT_EQ("ReceiptHandleIsInvalid", outcomes[0].GetError ().GetExceptionName ());
+  EXPECT_FALSE(outcomes[0].GetError ().ShouldRetry ());
+  EXPECT_EQ("MissingBatchResultEntry", outcomes[1].GetError ().GetExceptionName ());
+  EXPECT_TRUE(outcomes[2].IsSuccess ());
+  EXPECT_EQ("InternalError", outcomes[3].GetError ().GetExceptionName ());
+  EXPECT_TRUE(outcomes[3].GetError ().ShouldRetry ());
+}
+
+TEST(SQSBatchResultMapperTest, TestHandsABatchErrorToEveryEntry)
+{
+  Aws::Client::AWSError<SQSErrors> error (SQSErrors::UNKNOWN, "ServiceUnavailable", "unavailable", true);
+  Aws::Vector<DeleteMessageOutcome> outcomes = MapDeleteOutcomes (DeleteMessageBatchOutcome (error), 3);
+
+  ASSERT_EQ(3u, outcomes.size ());
+  for (auto& outcome : outcomes)
+  {
+    ASSERT_FALSE(outcome.IsSuccess ());
+    EXPECT_EQ("ServiceUnavailable", outcome.GetError ().GetExceptionName ());
+  }
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <aws/external/gtest.h>
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <aws/sqs/SQSClient.h>
+#include <aws/sqs/model/SendMessageBatchRequest.h>
+#include <aws/sqs/extendedlib/SQSBatchingProducer.h>
+#include "SQSTestClients.h"
+#include <thread>
+
+using namespace Aws;
+using namespace Aws::SQS;
+using namespace Aws::SQS::Model;
+using namespace Aws::SQS::ExtendedLib;
+
+static const char* ALLOCATION_TAG = "SQSBatchingProducerTest";
+
+namespace
+{
+  SendMessageRequest BuildSendMessageRequest (const char* queueUrl, const Aws::String& messageBody)
+  {
+    SendMessageRequest request;
+    request.SetQueueUrl (queueUrl);
+    request.SetMessageBody (messageBody);
+    return request;
+  }
+}
+
+TEST(SQSBatchingProducerTest, TestCoalescesSendsIntoFullBatches)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSBatchingProducer producer (sqsClient, std::chrono::milliseconds (10000));
+
+  Aws::Vector<std::future<SendMessageOutcome> > outcomes;
+  for (unsigned i = 0; i < 25; ++i)
+  {
+    outcomes.push_back (producer.SendMessage (BuildSendMessageRequest ("queue", std::to_string (i).c_str ())));
+  }
+  producer.Flush ();
+
+  for (unsigned i = 0; i < outcomes.size (); ++i)
+  {
+    SendMessageOutcome outcome = outcomes[i].get ();
+    ASSERT_TRUE(outcome.IsSuccess ());
+    EXPECT_EQ(std::to_string (i).c_str (), outcome.GetResult ().GetMessageId ());
+  }
+  ASSERT_EQ(3u, sqsClient->sendBatches.size ());
+  EXPECT_EQ(10u, sqsClient->sendBatches[0].GetEntries ().size ());
+  EXPECT_EQ(10u, sqsClient->sendBatches[1].GetEntries ().size ());
+  EXPECT_EQ(5u, sqsClient->sendBatches[2].GetEntries ().size ());
+}
+
+TEST(SQSBatchingProducerTest, TestKeepsBatchesUnderTheSizeLimit)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSBatchingProducer producer (sqsClient, std::chrono::milliseconds (10000), 1000);
+
+  // the oversized one travels alone
+  for (unsigned size : {400, 400, 400, 1500, 100})
+  {
+    producer.SendMessage (BuildSendMessageRequest ("queue", Aws::String (size, 'x')));
+  }
+  producer.Flush ();
+
+  ASSERT_EQ(4u, sqsClient->sendBatches.size ());
+  EXPECT_EQ(2u, sqsClient->sendBatches[0].GetEntries ().size ());
+  EXPECT_EQ(1u, sqsClient->sendBatches[1].GetEntries ().size ());
+  ASSERT_EQ(1u, sqsClient->sendBatches[2].GetEntries ().size ());
+  EXPECT_EQ(1500u, sqsClient->sendBatches[2].GetEntries ()[0].GetMessageBody ().size ());
+  EXPECT_EQ(1u, sqsClient->sendBatches[3].GetEntries ().size ());
+}
+
+TEST(SQSBatchingProducerTest, TestMapsFailedEntriesToTheirSend)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSBatchingProducer producer (sqsClient);
+
+  auto valid = producer.SendMessage (BuildSendMessageRequest ("queue", "valid"));
+  auto invalid = producer.SendMessage (BuildSendMessageRequest ("queue", "invalid"));
+  producer.Flush ();
+
+  EXPECT_EQ("valid", valid.get ().GetResult ().GetMessageId ());
+  SendMessageOutcome outcome = invalid.get ();
+  ASSERT_FALSE(outcome.IsSuccess ());
+  EXPECT_EQ("InvalidMessageContents", outcome.GetError ().GetExceptionName ());
+}
+
+TEST(SQSBatchingProducerTest, TestSendsPartialBatchesAfterTheLinger)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSBatchingProducer producer (sqsClient, std::chrono::milliseconds (20));
+
+  auto outcome = producer.SendMessage (BuildSendMessageRequest ("queue", "lonely"));
+  ASSERT_EQ(std::future_status::ready, outcome.wait_for (std::chrono::seconds (5)));
+  EXPECT_TRUE(outcome.get ().IsSuccess ());
+  EXPECT_EQ(1u, sqsClient->sendBatches.size ());
+}
+
+TEST(SQSBatchingProducerTest, TestCompletesAsyncSendsOnTheFlusher)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSBatchingProducer producer (sqsClient, std::chrono::milliseconds (10000));
+
+  Aws::Vector<Aws::String> messageIds;
+  Aws::Vector<std::thread::id> completedOn;
+  auto completion = [&messageIds, &completedOn] (const SendMessageOutcome& outcome)
+  {
+    messageIds.push_back (outcome.GetResult ().GetMessageId ());
+    completedOn.push_back (std::this_thread::get_id ());
+  };
+  producer.SendMessageAsync (BuildSendMessageRequest ("queue", "batched"), completion);
+  EXPECT_TRUE(messageIds.empty ());
+  producer.Flush ();
+
+  // once shut down, the send goes on its own before returning
+  producer.Shutdown ();
+  producer.SendMessageAsync (BuildSendMessageRequest ("queue", "alone"), completion);
+
+  ASSERT_EQ(2u, messageIds.size ());
+  EXPECT_EQ("batched", messageIds[0]);
+  EXPECT_NE(std::this_thread::get_id (), completedOn[0]);
+  EXPECT_EQ(std::this_thread::get_id (), completedOn[1]);
+  EXPECT_EQ(1u, sqsClient->sendBatches.size ());
+  EXPECT_EQ(1u, sqsClient->messages.size ());
+}
+
+TEST(SQSBatchingProducerTest, TestBatchEntriesKeepEveryField)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSBatchingProducer producer (sqsClient, std::chrono::milliseconds (10000));
+
+  MessageAttributeValue messageAttributeValue;
+  messageAttributeValue.SetDataType ("String");
+  messageAttributeValue.SetStringValue ("value");
+
+  // a zero delay overrides the delay of the queue only when asked to, it must then reach sqs as set
+  SendMessageRequest zeroDelay = BuildSendMessageRequest ("queue", "zero");
+  zeroDelay.SetDelaySeconds (0);
+  zeroDelay.AddMessageAttributes ("attribute", messageAttributeValue);
+  SendMessageRequest delayed = BuildSendMessageRequest ("queue", "delayed");
+  delayed.SetDelaySeconds (5);
+  producer.SendMessage (zeroDelay, true);
+  producer.SendMessage (delayed);
+  producer.SendMessage (BuildSendMessageRequest ("queue", "default"));
+  producer.SendMessage (zeroDelay);
+  producer.Flush ();
+
+  ASSERT_EQ(1u, sqsClient->sendBatches.size ());
+  Aws::String payload = sqsClient->sendBatches[0].SerializePayload ();
+  EXPECT_NE(Aws::String::npos, payload.find ("SendMessageBatchRequestEntry.1.DelaySeconds=0&"));
+  EXPECT_NE(Aws::String::npos, payload.find ("SendMessageBatchRequestEntry.2.DelaySeconds=5&"));
+  EXPECT_EQ(Aws::String::npos, payload.find ("SendMessageBatchRequestEntry.3.DelaySeconds="));
+  EXPECT_EQ(Aws::String::npos, payload.find ("SendMessageBatchRequestEntry.4.DelaySeconds="));
+  const Aws::Vector<SendMessageBatchRequestEntry>& entries = sqsClient->sendBatches[0].GetEntries ();
+  ASSERT_EQ(4u, entries.size ());
+  EXPECT_EQ("zero", entries[0].GetMessageBody ());
+  EXPECT_EQ(1u, entries[0].GetMessageAttributes ().count ("attribute"));
+}
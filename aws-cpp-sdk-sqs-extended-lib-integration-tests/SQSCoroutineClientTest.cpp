@@ -0,0 +1,209 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <aws/sqs/extendedlib/SQSCoroutineClient.h>
+
+#if defined(__cpp_impl_coroutine)
+#include <aws/external/gtest.h>
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <aws/core/utils/memory/stl/AWSDeque.h>
+#include "SQSTestClients.h"
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+using namespace Aws;
+using namespace Aws::SQS;
+using namespace Aws::SQS::Model;
+using namespace Aws::SQS::ExtendedLib;
+
+static const char* ALLOCATION_TAG = "SQSCoroutineClientTest";
+
+namespace
+{
+  // completes every send on a thread of its own, echoing the body as message id
+  class DetachedQueueClient : public SQSClient
+  {
+
+  public:
+    virtual void SendMessageAsync (const SendMessageRequest& request, const SendMessageResponseReceivedHandler& handler,
+                                   const std::shared_ptr<const Aws::Client::AsyncCallerContext>& context = nullptr) const
+    {
+      std::thread ([this, request, handler, context] ()
+      {
+        SendMessageResult result;
+        result.SetMessageId (request.GetMessageBody ());
+        handler (this, request, SendMessageOutcome (result), context);
+      }).detach ();
+    }
+
+  };
+
+  // keeps the coroutines to resume until the test runs them, as an event loop would
+  class QueuedScheduler : public SQSCoroutineScheduler
+  {
+
+  public:
+    std::mutex mutex;
+    std::condition_variable scheduled;
+    Aws::Deque<std::coroutine_handle<> > handles;
+
+    virtual void Schedule (std::coroutine_handle<> handle)
+    {
+      std::lock_guard<std::mutex> lock (mutex);
+      handles.push_back (handle);
+      scheduled.notify_all ();
+    }
+
+    void RunOne ()
+    {
+      std::unique_lock<std::mutex> lock (mutex);
+      scheduled.wait (lock, [this] ()
+      {
+        return !handles.empty ();
+      });
+      std::coroutine_handle<> handle = handles.front ();
+      handles.pop_front ();
+      lock.unlock ();
+      handle.resume ();
+    }
+
+  };
+
+  // fire and forget coroutine, enough to drive the awaiters
+  struct Detached
+  {
+    struct promise_type
+    {
+      Detached get_return_object ()
+      {
+        return Detached ();
+      }
+
+      std::suspend_never initial_suspend () noexcept
+      {
+        return std::suspend_never ();
+      }
+
+      std::suspend_never final_suspend () noexcept
+      {
+        return std::suspend_never ();
+      }
+
+      void return_void ()
+      {
+      }
+
+      void unhandled_exception ()
+      {
+        std::terminate ();
+      }
+    };
+  };
+
+  Detached SendTwice (const SQSCoroutineClient& coClient, Aws::Vector<Aws::String>& messageIds, std::thread::id& resumedOn)
+  {
+    SendMessageRequest request;
+    request.SetQueueUrl ("queue");
+    request.SetMessageBody ("first");
+    SendMessageOutcome outcome = co_await coClient.SendMessageCo (request);
+    messageIds.push_back (outcome.GetResult ().GetMessageId ());
+
+    request.SetMessageBody ("second");
+    outcome = co_await coClient.SendMessageCo (request);
+    messageIds.push_back (outcome.GetResult ().GetMessageId ());
+    resumedOn = std::this_thread::get_id ();
+  }
+
+  Detached SendThenDelete (const SQSCoroutineClient& coClient, const Aws::String& messageBody, Aws::Vector<Aws::String>& messageIds,
+                           unsigned& deletes)
+  {
+    SendMessageRequest sendRequest;
+    sendRequest.SetQueueUrl ("queue");
+    sendRequest.SetMessageBody (messageBody);
+    SendMessageOutcome sendOutcome = co_await coClient.SendMessageCo (sendRequest);
+    messageIds.push_back (sendOutcome.GetResult ().GetMessageId ());
+
+    DeleteMessageRequest deleteRequest;
+    deleteRequest.SetQueueUrl ("queue");
+    deleteRequest.SetReceiptHandle (sendOutcome.GetResult ().GetMessageId ());
+    DeleteMessageOutcome deleteOutcome = co_await coClient.DeleteMessageCo (deleteRequest);
+    if (deleteOutcome.IsSuccess ())
+    {
+      ++deletes;
+    }
+  }
+}
+
+TEST(SQSCoroutineClientTest, TestResumesThroughTheScheduler)
+{
+  auto scheduler = Aws::MakeShared<QueuedScheduler> (ALLOCATION_TAG);
+  SQSCoroutineClient coClient (Aws::MakeShared<DetachedQueueClient> (ALLOCATION_TAG), scheduler);
+
+  Aws::Vector<Aws::String> messageIds;
+  std::thread::id resumedOn;
+  SendTwice (coClient, messageIds, resumedOn);
+  EXPECT_TRUE(messageIds.empty ());
+
+  scheduler->RunOne ();
+  ASSERT_EQ(1u, messageIds.size ());
+  EXPECT_EQ("first", messageIds[0]);
+
+  scheduler->RunOne ();
+  ASSERT_EQ(2u, messageIds.size ());
+  EXPECT_EQ("second", messageIds[1]);
+  EXPECT_EQ(std::this_thread::get_id (), resumedOn);
+}
+
+TEST(SQSCoroutineClientTest, TestSuspendedCoroutinesShareBatches)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  auto scheduler = Aws::MakeShared<QueuedScheduler> (ALLOCATION_TAG);
+  auto producer = Aws::MakeShared<SQSBatchingProducer> (ALLOCATION_TAG, sqsClient, std::chrono::milliseconds (10000));
+  auto deleteAccumulator = Aws::MakeShared<SQSDeleteAccumulator> (ALLOCATION_TAG, sqsClient, std::chrono::milliseconds (10000));
+  SQSCoroutineClient coClient (sqsClient, scheduler, producer, deleteAccumulator);
+
+  // every coroutine is suspended on a queued entry, with no thread of its own
+  Aws::Vector<Aws::String> messageIds;
+  unsigned deletes = 0;
+  for (unsigned i = 0; i < 25; ++i)
+  {
+    SendThenDelete (coClient, std::to_string (i).c_str (), messageIds, deletes);
+  }
+  EXPECT_TRUE(messageIds.empty ());
+
+  producer->Flush ();
+  for (unsigned i = 0; i < 25; ++i)
+  {
+    scheduler->RunOne ();
+  }
+  ASSERT_EQ(25u, messageIds.size ());
+  EXPECT_EQ(0u, deletes);
+
+  deleteAccumulator->Flush ();
+  for (unsigned i = 0; i < 25; ++i)
+  {
+    scheduler->RunOne ();
+  }
+  EXPECT_EQ(25u, deletes);
+
+  EXPECT_TRUE(sqsClient->messages.empty ());
+  ASSERT_EQ(3u, sqsClient->sendBatches.size ());
+  EXPECT_EQ(10u, sqsClient->sendBatches[0].GetEntries ().size ());
+  EXPECT_EQ(3u, sqsClient->deleteBatches.size ());
+  EXPECT_EQ(25u, sqsClient->deletedReceiptHandles.size ());
+}
+#endif
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <aws/external/gtest.h>
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <aws/sqs/SQSClient.h>
+#include <aws/sqs/model/DeleteMessageBatchRequest.h>
+#include <aws/sqs/extendedlib/SQSDeleteAccumulator.h>
+#include "SQSTestClients.h"
+#include <atomic>
+#include <future>
+#include <thread>
+
+using namespace Aws;
+using namespace Aws::SQS;
+using namespace Aws::SQS::Model;
+using namespace Aws::SQS::ExtendedLib;
+
+static const char* ALLOCATION_TAG = "SQSDeleteAccumulatorTest";
+
+namespace
+{
+  DeleteMessageRequest BuildDeleteMessageRequest (const char* queueUrl, const Aws::String& receiptHandle)
+  {
+    DeleteMessageRequest request;
+    request.SetQueueUrl (queueUrl);
+    request.SetReceiptHandle (receiptHandle);
+    return request;
+  }
+}
+
+TEST(SQSDeleteAccumulatorTest, TestCoalescesDeletesIntoFullBatches)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSDeleteAccumulator accumulator (sqsClient, std::chrono::milliseconds (10000));
+
+  Aws::Vector<std::future<DeleteMessageOutcome> > outcomes;
+  for (unsigned i = 0; i < 25; ++i)
+  {
+    outcomes.push_back (accumulator.DeleteMessage (BuildDeleteMessageRequest ("queue", std::to_string (i).c_str ())));
+  }
+  accumulator.Flush ();
+
+  for (auto& outcome : outcomes)
+  {
+    EXPECT_TRUE(outcome.get ().IsSuccess ());
+  }
+  ASSERT_EQ(3u, sqsClient->deleteBatches.size ());
+  size_t entries = 0;
+  for (auto& batch : sqsClient->deleteBatches)
+  {
+    EXPECT_LE(batch.GetEntries ().size (), 10u);
+    entries += batch.GetEntries ().size ();
+  }
+  EXPECT_EQ(25u, entries);
+}
+
+TEST(SQSDeleteAccumulatorTest, TestMapsFailedEntriesToTheirDelete)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSDeleteAccumulator accumulator (sqsClient);
+
+  auto valid = accumulator.DeleteMessage (BuildDeleteMessageRequest ("queue", "valid"));
+  auto invalid = accumulator.DeleteMessage (BuildDeleteMessageRequest ("queue", "invalid"));
+  accumulator.Flush ();
+
+  EXPECT_TRUE(valid.get ().IsSuccess ());
+  DeleteMessageOutcome outcome = invalid.get ();
+  ASSERT_FALSE(outcome.IsSuccess ());
+  EXPECT_EQ("ReceiptHandleIsInvalid", outcome.GetError ().GetExceptionName ());
+}
+
+TEST(SQSDeleteAccumulatorTest, TestSendsPartialBatchesAfterTheLatency)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSDeleteAccumulator accumulator (sqsClient, std::chrono::milliseconds (20));
+
+  auto outcome = accumulator.DeleteMessage (BuildDeleteMessageRequest ("queue", "lonely"));
+  ASSERT_EQ(std::future_status::ready, outcome.wait_for (std::chrono::seconds (5)));
+  EXPECT_TRUE(outcome.get ().IsSuccess ());
+  EXPECT_EQ(1u, sqsClient->deleteBatches.size ());
+}
+
+TEST(SQSDeleteAccumulatorTest, TestKeepsQueuesApart)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  {
+    SQSDeleteAccumulator accumulator (sqsClient, std::chrono::milliseconds (10000), 2);
+    for (unsigned i = 0; i < 12; ++i)
+    {
+      accumulator.DeleteMessage (BuildDeleteMessageRequest (i % 2 == 0 ? "even" : "odd", std::to_string (i).c_str ()));
+    }
+  }
+
+  ASSERT_EQ(2u, sqsClient->deleteBatches.size ());
+  for (auto& batch : sqsClient->deleteBatches)
+  {
+    EXPECT_EQ(6u, batch.GetEntries ().size ());
+    for (auto& entry : batch.GetEntries ())
+    {
+      int number = std::stoi (entry.GetReceiptHandle ().c_str ());
+      EXPECT_EQ(batch.GetQueueUrl () == "even" ? 0 : 1, number % 2);
+    }
+  }
+}
+
+TEST(SQSDeleteAccumulatorTest, TestSendsTheEarliestDeadlineFirst)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future ().share ();
+  std::atomic<unsigned> batches (0);
+  sqsClient->beforeBatch = [&] ()
+  {
+    if (batches++ == 0)
+    {
+      released.wait ();
+    }
+  };
+  SQSDeleteAccumulator accumulator (sqsClient, std::chrono::milliseconds (20), 1);
+
+  // while the flusher sends "a", "b" comes due and "a" fills two more batches
+  for (unsigned i = 0; i < 10; ++i)
+  {
+    accumulator.DeleteMessage (BuildDeleteMessageRequest ("a", std::to_string (i).c_str ()));
+  }
+  while (batches == 0)
+  {
+    std::this_thread::sleep_for (std::chrono::milliseconds (1));
+  }
+  accumulator.DeleteMessage (BuildDeleteMessageRequest ("b", "due"));
+  std::this_thread::sleep_for (std::chrono::milliseconds (50));
+  for (unsigned i = 10; i < 30; ++i)
+  {
+    accumulator.DeleteMessage (BuildDeleteMessageRequest ("a", std::to_string (i).c_str ()));
+  }
+  release.set_value ();
+  accumulator.Flush ();
+
+  ASSERT_EQ(4u, sqsClient->deleteBatches.size ());
+  EXPECT_EQ("a", sqsClient->deleteBatches[0].GetQueueUrl ());
+  EXPECT_EQ("b", sqsClient->deleteBatches[1].GetQueueUrl ());
+  EXPECT_EQ("a", sqsClient->deleteBatches[2].GetQueueUrl ());
+  EXPECT_EQ("a", sqsClient->deleteBatches[3].GetQueueUrl ());
+}
+
+TEST(SQSDeleteAccumulatorTest, TestShutsDownFromItsOwnBatch)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSDeleteAccumulator accumulator (sqsClient, std::chrono::milliseconds (10000), 1);
+  sqsClient->beforeBatch = [&] ()
+  {
+    accumulator.Shutdown ();
+  };
+
+  Aws::Vector<std::future<DeleteMessageOutcome> > outcomes;
+  for (unsigned i = 0; i < 25; ++i)
+  {
+    outcomes.push_back (accumulator.DeleteMessage (BuildDeleteMessageRequest ("queue", std::to_string (i).c_str ())));
+  }
+
+  // the flusher shutting down is detached, it sends what is left before returning to its own batch
+  for (auto& outcome : outcomes)
+  {
+    ASSERT_EQ(std::future_status::ready, outcome.wait_for (std::chrono::seconds (5)));
+    EXPECT_TRUE(outcome.get ().IsSuccess ());
+  }
+  accumulator.Flush ();
+  EXPECT_EQ(25u, sqsClient->deletedReceiptHandles.size ());
+}
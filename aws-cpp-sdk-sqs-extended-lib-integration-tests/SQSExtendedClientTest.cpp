@@ -0,0 +1,975 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/external/gtest.h>
+#include <aws/core/utils/HashingUtils.h>
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <aws/core/utils/memory/stl/AWSStringStream.h>
+#include <aws/testing/MemoryTesting.h>
+#include <aws/sqs/model/ReceiveMessageRequest.h>
+#include <aws/sqs/model/DeleteMessageBatchRequest.h>
+#include <aws/sqs/extendedlib/SQSDeflateCodec.h>
+#include <aws/sqs/extendedlib/SQSExtendedClient.h>
+#include <aws/sqs/extendedlib/SQSExtendedClientConfiguration.h>
+#include <aws/sqs/extendedlib/SQSLargeMessageS3PointerView.h>
+#include <aws/sqs/extendedlib/SQSReceiptHandleView.h>
+#include "SQSTestClients.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <future>
+#include <thread>
+
+using namespace Aws;
+using namespace Aws::SQS;
+using namespace Aws::SQS::Model;
+using namespace Aws::SQS::ExtendedLib;
+
+static const char* ALLOCATION_TAG = "SQSExtendedClientTest";
+static const char* S3_BUCKET_NAME = "bucket";
+
+static const size_t LARGE_PAYLOAD_SIZE = 300 * 1024;
+// s3 takes no part under 5MB but the last one
+static const size_t MULTIPART_PART_SIZE = 5 * 1024 * 1024;
+static const size_t MULTIPART_PAYLOAD_SIZE = 2 * MULTIPART_PART_SIZE + 1024;
+// three ranged parts, the last one shorter
+static const size_t RANGED_PART_SIZE = 4096;
+static const size_t RANGED_PAYLOAD_SIZE = 2 * RANGED_PART_SIZE + 1808;
+
+namespace
+{
+  std::shared_ptr<SQSExtendedClientConfiguration> BuildConfiguration (const std::shared_ptr<RecordingS3Client>& s3Client)
+  {
+    auto sqsConfig = Aws::MakeShared<SQSExtendedClientConfiguration> (ALLOCATION_TAG);
+    sqsConfig->SetLargePayloadSupportEnabled (s3Client, S3_BUCKET_NAME);
+    return sqsConfig;
+  }
+
+  // a distinct payload per entry, so a pointer handed to the wrong entry shows
+  Aws::String BuildPayload (size_t size, unsigned seed)
+  {
+    Aws::String payload (size, static_cast<char> ('a' + seed % 26));
+    Aws::String prefix = std::to_string (seed).c_str ();
+    payload.replace (0, prefix.size (), prefix);
+    return payload;
+  }
+
+  // the payload an offloaded body points to, or an empty string when it points nowhere known
+  Aws::String GetStoredPayload (const RecordingS3Client& s3Client, const Aws::String& messageBody)
+  {
+    SQSLargeMessageS3PointerView s3PointerView;
+    if (!s3PointerView.Parse (messageBody))
+    {
+      return "";
+    }
+    std::lock_guard<std::mutex> lock (s3Client.mutex);
+    auto object = s3Client.objects.find (s3PointerView.GetS3BucketName ().ToString () + "/"
+                                         + s3PointerView.GetS3Key ().ToString ());
+    return object == s3Client.objects.end () ? "" : object->second;
+  }
+
+  // payloads of RANGED_PAYLOAD_SIZE bytes are stored raw and downloaded in parts of RANGED_PART_SIZE
+  std::shared_ptr<SQSExtendedClientConfiguration> BuildRangedConfiguration (const std::shared_ptr<RecordingS3Client>& s3Client)
+  {
+    auto sqsConfig = BuildConfiguration (s3Client);
+    sqsConfig->SetAlwaysThroughS3Enabled ();
+    sqsConfig->SetRangedDownloadThreshold (RANGED_PART_SIZE);
+    sqsConfig->SetRangedDownloadPartSize (RANGED_PART_SIZE);
+    return sqsConfig;
+  }
+
+  Message SendAndReceive (const SQSExtendedClient& client, const Aws::String& payload)
+  {
+    SendMessageRequest sendRequest;
+    sendRequest.SetQueueUrl ("queue");
+    sendRequest.SetMessageBody (payload);
+    EXPECT_TRUE(client.SendMessage (sendRequest).IsSuccess ());
+
+    ReceiveMessageRequest receiveRequest;
+    receiveRequest.SetQueueUrl ("queue");
+    receiveRequest.SetMaxNumberOfMessages (1);
+    ReceiveMessageOutcome outcome = client.ReceiveMessage (receiveRequest);
+    EXPECT_TRUE(outcome.IsSuccess ());
+    EXPECT_EQ(1u, outcome.GetResult ().GetMessages ().size ());
+    return outcome.GetResult ().GetMessages ().empty () ? Message () : outcome.GetResult ().GetMessages ()[0];
+  }
+
+  // an entry along with a string attribute of attributeSize bytes, if any
+  SendMessageBatchRequestEntry BuildBatchEntry (const Aws::String& id, const Aws::String& messageBody,
+                                                size_t attributeSize = 0)
+  {
+    SendMessageBatchRequestEntry entry;
+    entry.SetId (id);
+    entry.SetMessageBody (messageBody);
+    if (attributeSize > 0)
+    {
+      MessageAttributeValue messageAttributeValue;
+      messageAttributeValue.SetDataType ("String");
+      messageAttributeValue.SetStringValue (Aws::String (attributeSize, 'x'));
+      entry.AddMessageAttributes ("attribute", messageAttributeValue);
+    }
+    return entry;
+  }
+
+  template<typename EntryT>
+  Aws::Vector<Aws::String> GetIds (const Aws::Vector<EntryT>& entries)
+  {
+    Aws::Vector<Aws::String> ids;
+    for (auto& entry : entries)
+    {
+      ids.push_back (entry.GetId ());
+    }
+    return ids;
+  }
+
+  Aws::Vector<Aws::String> GetSortedRanges (const RecordingS3Client& s3Client)
+  {
+    std::lock_guard<std::mutex> lock (s3Client.mutex);
+    Aws::Vector<Aws::String> ranges = s3Client.getObjectRanges;
+    std::sort (ranges.begin (), ranges.end ());
+    return ranges;
+  }
+}
+
+TEST(SQSExtendedClientTest, TestUploadsBatchPayloadsConcurrently)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  s3Client->uploadDelay = std::chrono::milliseconds (50);
+  auto sqsConfig = BuildConfiguration (s3Client);
+  sqsConfig->SetS3MaxConcurrency (4);
+  sqsConfig->SetCompactS3PointerEnabled ();
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, sqsConfig);
+
+  SendMessageBatchRequest request;
+  request.SetQueueUrl ("queue");
+  for (unsigned i = 0; i < 10; ++i)
+  {
+    SendMessageBatchRequestEntry entry;
+    entry.SetId (std::to_string (i).c_str ());
+    entry.SetMessageBody (BuildPayload (LARGE_PAYLOAD_SIZE, i));
+    request.AddEntries (entry);
+  }
+  SendMessageBatchOutcome outcome = client.SendMessageBatch (request);
+
+  ASSERT_TRUE(outcome.IsSuccess ());
+  EXPECT_EQ(10u, outcome.GetResult ().GetSuccessful ().size ());
+  EXPECT_EQ(10u, s3Client->putObjectCalls);
+  // the uploads overlap, but never more of them than allowed
+  EXPECT_GT(s3Client->maxActiveUploads, 1u);
+  EXPECT_LE(s3Client->maxActiveUploads, 4u);
+
+  // each entry keeps its place in the batch and points to its own payload
+  ASSERT_EQ(1u, sqsClient->sendBatches.size ());
+  const Aws::Vector<SendMessageBatchRequestEntry>& entries = sqsClient->sendBatches[0].GetEntries ();
+  ASSERT_EQ(10u, entries.size ());
+  for (unsigned i = 0; i < entries.size (); ++i)
+  {
+    EXPECT_EQ(std::to_string (i).c_str (), entries[i].GetId ());
+    EXPECT_LT(entries[i].GetMessageBody ().size (), 1024u);
+    EXPECT_TRUE(GetStoredPayload (*s3Client, entries[i].GetMessageBody ()) == BuildPayload (LARGE_PAYLOAD_SIZE, i));
+  }
+}
+
+TEST(SQSExtendedClientTest, TestSendsSmallMessagesThroughTheGivenQueueClient)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, BuildConfiguration (s3Client));
+
+  SendMessageRequest request;
+  request.SetQueueUrl ("queue");
+  request.SetMessageBody ("small");
+  ASSERT_TRUE(client.SendMessage (request).IsSuccess ());
+
+  ASSERT_EQ(1u, sqsClient->messages.size ());
+  EXPECT_EQ("small", sqsClient->messages[0].GetMessageBody ());
+  EXPECT_EQ(0u, s3Client->putObjectCalls);
+}
+
+TEST(SQSExtendedClientTest, TestOffloadedMessagesKeepEveryField)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsConfig = BuildConfiguration (s3Client);
+  sqsConfig->SetAlwaysThroughS3Enabled ();
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, sqsConfig);
+
+  MessageAttributeValue messageAttributeValue;
+  messageAttributeValue.SetDataType ("String");
+  messageAttributeValue.SetStringValue ("value");
+
+  // an explicit zero delay overrides the delay of the queue, it must reach sqs as set
+  SendMessageRequest request;
+  request.SetQueueUrl ("queue");
+  request.SetMessageBody ("payload");
+  request.SetDelaySeconds (0);
+  request.AddMessageAttributes ("attribute", messageAttributeValue);
+  ASSERT_TRUE(client.SendMessage (request).IsSuccess ());
+
+  ASSERT_EQ(1u, sqsClient->messages.size ());
+  const SendMessageRequest& sentRequest = sqsClient->messages[0];
+  EXPECT_NE(Aws::String::npos, sentRequest.SerializePayload ().find ("DelaySeconds=0&"));
+  EXPECT_EQ(1u, sentRequest.GetMessageAttributes ().count ("attribute"));
+  EXPECT_EQ("payload", GetStoredPayload (*s3Client, sentRequest.GetMessageBody ()));
+
+  SendMessageBatchRequestEntry entry;
+  entry.SetId ("0");
+  entry.SetMessageBody ("payload");
+  entry.SetDelaySeconds (0);
+  entry.AddMessageAttributes ("attribute", messageAttributeValue);
+  SendMessageBatchRequest batchRequest;
+  batchRequest.SetQueueUrl ("queue");
+  batchRequest.AddEntries (entry);
+  ASSERT_TRUE(client.SendMessageBatch (batchRequest).IsSuccess ());
+
+  ASSERT_EQ(1u, sqsClient->sendBatches.size ());
+  EXPECT_NE(Aws::String::npos,
+            sqsClient->sendBatches[0].SerializePayload ().find ("SendMessageBatchRequestEntry.1.DelaySeconds=0&"));
+  ASSERT_EQ(1u, sqsClient->sendBatches[0].GetEntries ().size ());
+  EXPECT_EQ(1u, sqsClient->sendBatches[0].GetEntries ()[0].GetMessageAttributes ().count ("attribute"));
+}
+
+TEST(SQSExtendedClientTest, TestOffloadedPayloadIsUploadedInPlace)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  s3Client->storeObjects = false;
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, BuildConfiguration (s3Client));
+
+  SendMessageRequest request;
+  request.SetQueueUrl ("queue");
+  request.SetMessageBody (BuildPayload (4 * 1024 * 1024, 0));
+  ASSERT_TRUE(client.SendMessage (request).IsSuccess ());
+
+  // the s3 request reads the caller's body, and only the pointer goes to the queue
+  EXPECT_EQ(1u, s3Client->inPlaceUploads);
+  EXPECT_EQ(request.GetMessageBody ().size (), s3Client->uploadedBytes);
+  ASSERT_EQ(1u, sqsClient->messages.size ());
+  EXPECT_LT(sqsClient->messages[0].GetMessageBody ().size (), 1024u);
+}
+
+TEST(SQSExtendedClientTest, TestSendFailsWhenThePayloadIsNotStored)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsConfig = BuildConfiguration (s3Client);
+  sqsConfig->SetAlwaysThroughS3Enabled ();
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, sqsConfig);
+
+  SendMessageRequest request;
+  request.SetQueueUrl ("queue");
+  request.SetMessageBody ("refused payload");
+  SendMessageOutcome outcome = client.SendMessage (request);
+
+  // nothing goes to the queue that would point to a missing object
+  ASSERT_FALSE(outcome.IsSuccess ());
+  EXPECT_EQ("SQSLargePayloadNotStored", outcome.GetError ().GetExceptionName ());
+  EXPECT_TRUE(sqsClient->messages.empty ());
+}
+
+TEST(SQSExtendedClientTest, TestBatchReportsEntriesWhosePayloadIsNotStored)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsConfig = BuildConfiguration (s3Client);
+  sqsConfig->SetAlwaysThroughS3Enabled ();
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, sqsConfig);
+
+  SendMessageBatchRequest request;
+  request.SetQueueUrl ("queue");
+  for (const char* messageBody : {"payload 0", "refused 1", "payload 2"})
+  {
+    SendMessageBatchRequestEntry entry;
+    entry.SetId (Aws::String (1, messageBody[std::strlen (messageBody) - 1]));
+    entry.SetMessageBody (messageBody);
+    request.AddEntries (entry);
+  }
+  SendMessageBatchOutcome outcome = client.SendMessageBatch (request);
+
+  ASSERT_TRUE(outcome.IsSuccess ());
+  ASSERT_EQ(2u, outcome.GetResult ().GetSuccessful ().size ());
+  ASSERT_EQ(1u, outcome.GetResult ().GetFailed ().size ());
+  EXPECT_EQ("1", outcome.GetResult ().GetFailed ()[0].GetId ());
+  EXPECT_EQ("SQSLargePayloadNotStored", outcome.GetResult ().GetFailed ()[0].GetCode ());
+  ASSERT_EQ(1u, sqsClient->sendBatches.size ());
+  ASSERT_EQ(2u, sqsClient->sendBatches[0].GetEntries ().size ());
+  EXPECT_EQ("0", sqsClient->sendBatches[0].GetEntries ()[0].GetId ());
+  EXPECT_EQ("2", sqsClient->sendBatches[0].GetEntries ()[1].GetId ());
+
+  // a pack that cannot be stored fails every entry packed in it, and an empty batch is not sent
+  sqsConfig->SetBatchPackingEnabled ();
+  request.SetEntries (Aws::Vector<SendMessageBatchRequestEntry> (request.GetEntries ().begin () + 1,
+                                                                 request.GetEntries ().end ()));
+  outcome = client.SendMessageBatch (request);
+
+  ASSERT_TRUE(outcome.IsSuccess ());
+  EXPECT_TRUE(outcome.GetResult ().GetSuccessful ().empty ());
+  EXPECT_EQ(2u, outcome.GetResult ().GetFailed ().size ());
+  EXPECT_EQ(1u, sqsClient->sendBatches.size ());
+}
+
+TEST(SQSExtendedClientTest, TestBatchOffloadsTheBiggestEntriesToFitTheLimit)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, BuildConfiguration (s3Client));
+
+  // none over the threshold, but 425KB together. Offloading the three biggest brings the batch under 256KB
+  SendMessageBatchRequest request;
+  request.SetQueueUrl ("queue");
+  for (unsigned i = 0; i < 10; ++i)
+  {
+    request.AddEntries (BuildBatchEntry (std::to_string (i).c_str (), BuildPayload ((20 + 5 * i) * 1024, i)));
+  }
+  SendMessageBatchOutcome outcome = client.SendMessageBatch (request);
+
+  ASSERT_TRUE(outcome.IsSuccess ());
+  EXPECT_EQ(10u, outcome.GetResult ().GetSuccessful ().size ());
+  EXPECT_TRUE(outcome.GetResult ().GetFailed ().empty ());
+  EXPECT_EQ(3u, s3Client->putObjectCalls);
+
+  ASSERT_EQ(1u, sqsClient->sendBatches.size ());
+  const Aws::Vector<SendMessageBatchRequestEntry>& entries = sqsClient->sendBatches[0].GetEntries ();
+  ASSERT_EQ(10u, entries.size ());
+  for (unsigned i = 0; i < entries.size (); ++i)
+  {
+    EXPECT_EQ(std::to_string (i).c_str (), entries[i].GetId ());
+    Aws::String payload = BuildPayload ((20 + 5 * i) * 1024, i);
+    if (i < 7)
+    {
+      EXPECT_TRUE(entries[i].GetMessageBody () == payload);
+    }
+    else
+    {
+      EXPECT_TRUE(GetStoredPayload (*s3Client, entries[i].GetMessageBody ()) == payload);
+    }
+  }
+}
+
+TEST(SQSExtendedClientTest, TestBatchSplitsEntriesStillOverTheLimit)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, BuildConfiguration (s3Client));
+
+  // offloading leaves the attributes in the batch, 150KB for "2" and "3" and 300KB for "4", which is over the
+  // limit on its own and goes alone for sqs to judge
+  SendMessageBatchRequest request;
+  request.SetQueueUrl ("queue");
+  request.AddEntries (BuildBatchEntry ("0", "payload 0"));
+  request.AddEntries (BuildBatchEntry ("1", "invalid 1"));
+  request.AddEntries (BuildBatchEntry ("2", BuildPayload (150 * 1024, 2), 150 * 1024));
+  request.AddEntries (BuildBatchEntry ("3", BuildPayload (150 * 1024, 3), 150 * 1024));
+  request.AddEntries (BuildBatchEntry ("4", "payload 4", 300 * 1024));
+  SendMessageBatchOutcome outcome = client.SendMessageBatch (request);
+
+  EXPECT_EQ(3u, s3Client->putObjectCalls);
+  ASSERT_EQ(3u, sqsClient->sendBatches.size ());
+  EXPECT_EQ(Aws::Vector<Aws::String> ({"0", "1", "2"}), GetIds (sqsClient->sendBatches[0].GetEntries ()));
+  EXPECT_EQ(Aws::Vector<Aws::String> ({"3"}), GetIds (sqsClient->sendBatches[1].GetEntries ()));
+  EXPECT_EQ(Aws::Vector<Aws::String> ({"4"}), GetIds (sqsClient->sendBatches[2].GetEntries ()));
+
+  // the results of every batch come back under the ids of the request
+  ASSERT_TRUE(outcome.IsSuccess ());
+  const Aws::Vector<SendMessageBatchResultEntry>& successful = outcome.GetResult ().GetSuccessful ();
+  EXPECT_EQ(Aws::Vector<Aws::String> ({"0", "2", "3", "4"}), GetIds (successful));
+  EXPECT_EQ("payload 0", successful[0].GetMessageId ());
+  EXPECT_TRUE(GetStoredPayload (*s3Client, successful[1].GetMessageId ()) == BuildPayload (150 * 1024, 2));
+  EXPECT_EQ(Aws::Vector<Aws::String> ({"1"}), GetIds (outcome.GetResult ().GetFailed ()));
+}
+
+TEST(SQSExtendedClientTest, TestBulkMergesTheResultsOfEveryBatchInOrder)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsConfig = BuildConfiguration (s3Client);
+  sqsConfig->SetAsyncThreadPoolSize (3);
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, sqsConfig);
+
+  // 25 entries go in three batches, the one failing sits in the middle one
+  SendMessageBatchRequest sendRequest;
+  sendRequest.SetQueueUrl ("queue");
+  DeleteMessageBatchRequest deleteRequest;
+  deleteRequest.SetQueueUrl ("queue");
+  Aws::Vector<Aws::String> expectedIds;
+  for (unsigned i = 0; i < 25; ++i)
+  {
+    Aws::String id = std::to_string (i).c_str ();
+    Aws::String prefix = i == 13 ? "invalid " : "payload ";
+    sendRequest.AddEntries (BuildBatchEntry (id, prefix + id));
+
+    DeleteMessageBatchRequestEntry deleteEntry;
+    deleteEntry.SetId (id);
+    deleteEntry.SetReceiptHandle (prefix + id);
+    deleteRequest.AddEntries (deleteEntry);
+    if (i != 13)
+    {
+      expectedIds.push_back (id);
+    }
+  }
+
+  SendMessageBatchOutcome sendOutcome = client.SendMessageBulk (sendRequest);
+  ASSERT_TRUE(sendOutcome.IsSuccess ());
+  EXPECT_EQ(expectedIds, GetIds (sendOutcome.GetResult ().GetSuccessful ()));
+  for (auto& entry : sendOutcome.GetResult ().GetSuccessful ())
+  {
+    EXPECT_EQ("payload " + entry.GetId (), entry.GetMessageId ());
+  }
+  ASSERT_EQ(1u, sendOutcome.GetResult ().GetFailed ().size ());
+  EXPECT_EQ("13", sendOutcome.GetResult ().GetFailed ()[0].GetId ());
+  EXPECT_EQ("InvalidMessageContents", sendOutcome.GetResult ().GetFailed ()[0].GetCode ());
+  ASSERT_EQ(3u, sqsClient->sendBatches.size ());
+
+  DeleteMessageBatchOutcome deleteOutcome = client.DeleteMessageBulk (deleteRequest);
+  ASSERT_TRUE(deleteOutcome.IsSuccess ());
+  EXPECT_EQ(expectedIds, GetIds (deleteOutcome.GetResult ().GetSuccessful ()));
+  ASSERT_EQ(1u, deleteOutcome.GetResult ().GetFailed ().size ());
+  EXPECT_EQ("13", deleteOutcome.GetResult ().GetFailed ()[0].GetId ());
+  EXPECT_EQ("ReceiptHandleIsInvalid", deleteOutcome.GetResult ().GetFailed ()[0].GetCode ());
+  EXPECT_EQ(3u, sqsClient->deleteBatches.size ());
+}
+
+TEST(SQSExtendedClientTest, TestPipelinedBatchSendsInlineEntriesAheadOfTheUploads)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  std::promise<void> uploadsReleased;
+  s3Client->uploadGate = uploadsReleased.get_future ().share ();
+  auto sqsConfig = BuildConfiguration (s3Client);
+  sqsConfig->SetBatchPipeliningEnabled ();
+  sqsConfig->SetS3MaxConcurrency (2);
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, sqsConfig);
+
+  SendMessageBatchRequest request;
+  request.SetQueueUrl ("queue");
+  request.AddEntries (BuildBatchEntry ("0", "payload 0"));
+  request.AddEntries (BuildBatchEntry ("1", BuildPayload (LARGE_PAYLOAD_SIZE, 1)));
+  request.AddEntries (BuildBatchEntry ("2", "refused" + BuildPayload (LARGE_PAYLOAD_SIZE, 2)));
+  request.AddEntries (BuildBatchEntry ("3", "payload 3"));
+  std::future<SendMessageBatchOutcome> pendingOutcome = std::async (std::launch::async, [&client, &request] ()
+  {
+    return client.SendMessageBatch (request);
+  });
+
+  // the inline entries are sent while both uploads are held back
+  size_t sentBatches = 0;
+  for (unsigned i = 0; i < 500 && sentBatches == 0; ++i)
+  {
+    std::this_thread::sleep_for (std::chrono::milliseconds (10));
+    std::lock_guard<std::mutex> lock (sqsClient->mutex);
+    sentBatches = sqsClient->sendBatches.size ();
+  }
+  ASSERT_EQ(1u, sentBatches);
+  {
+    std::lock_guard<std::mutex> lock (sqsClient->mutex);
+    EXPECT_EQ(Aws::Vector<Aws::String> ({"0", "3"}), GetIds (sqsClient->sendBatches[0].GetEntries ()));
+  }
+  {
+    std::lock_guard<std::mutex> lock (s3Client->mutex);
+    EXPECT_EQ(0u, s3Client->putObjectCalls);
+  }
+
+  // the stored payload follows in a batch of its own, the refused one never reaches the queue
+  uploadsReleased.set_value ();
+  SendMessageBatchOutcome outcome = pendingOutcome.get ();
+  ASSERT_TRUE(outcome.IsSuccess ());
+  Aws::Vector<Aws::String> successfulIds = GetIds (outcome.GetResult ().GetSuccessful ());
+  std::sort (successfulIds.begin (), successfulIds.end ());
+  EXPECT_EQ(Aws::Vector<Aws::String> ({"0", "1", "3"}), successfulIds);
+  ASSERT_EQ(1u, outcome.GetResult ().GetFailed ().size ());
+  EXPECT_EQ("2", outcome.GetResult ().GetFailed ()[0].GetId ());
+  EXPECT_EQ("SQSLargePayloadNotStored", outcome.GetResult ().GetFailed ()[0].GetCode ());
+
+  ASSERT_EQ(2u, sqsClient->sendBatches.size ());
+  ASSERT_EQ(Aws::Vector<Aws::String> ({"1"}), GetIds (sqsClient->sendBatches[1].GetEntries ()));
+  EXPECT_TRUE(GetStoredPayload (*s3Client, sqsClient->sendBatches[1].GetEntries ()[0].GetMessageBody ())
+              == BuildPayload (LARGE_PAYLOAD_SIZE, 1));
+}
+
+TEST(SQSExtendedClientTest, TestMultipartUploadRetriesFailedParts)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  s3Client->partFailures[2] = 2;
+  auto sqsConfig = BuildConfiguration (s3Client);
+  sqsConfig->SetMultipartUploadThreshold (MULTIPART_PAYLOAD_SIZE / 2);
+  sqsConfig->SetMultipartUploadPartSize (MULTIPART_PART_SIZE);
+  sqsConfig->SetS3MaxRetries (2);
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, sqsConfig);
+
+  SendMessageRequest request;
+  request.SetQueueUrl ("queue");
+  request.SetMessageBody (BuildPayload (MULTIPART_PAYLOAD_SIZE, 7));
+  ASSERT_TRUE(client.SendMessage (request).IsSuccess ());
+
+  // three parts, the last one shorter, and only the failing one uploaded again
+  EXPECT_EQ(0u, s3Client->putObjectCalls);
+  ASSERT_EQ(3u, s3Client->partAttempts.size ());
+  EXPECT_EQ(1u, s3Client->partAttempts[1]);
+  EXPECT_EQ(3u, s3Client->partAttempts[2]);
+  EXPECT_EQ(1u, s3Client->partAttempts[3]);
+  EXPECT_EQ(0u, s3Client->abortedUploads);
+  ASSERT_EQ(1u, sqsClient->messages.size ());
+  EXPECT_TRUE(GetStoredPayload (*s3Client, sqsClient->messages[0].GetMessageBody ()) == request.GetMessageBody ());
+}
+
+TEST(SQSExtendedClientTest, TestMultipartUploadIsAbortedWhenAPartKeepsFailing)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  s3Client->partFailures[2] = 3;
+  auto sqsConfig = BuildConfiguration (s3Client);
+  sqsConfig->SetMultipartUploadThreshold (MULTIPART_PAYLOAD_SIZE / 2);
+  sqsConfig->SetMultipartUploadPartSize (MULTIPART_PART_SIZE);
+  sqsConfig->SetS3MaxRetries (2);
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, sqsConfig);
+
+  SendMessageRequest request;
+  request.SetQueueUrl ("queue");
+  request.SetMessageBody (BuildPayload (MULTIPART_PAYLOAD_SIZE, 7));
+  EXPECT_FALSE(client.SendMessage (request).IsSuccess ());
+
+  EXPECT_EQ(3u, s3Client->partAttempts[2]);
+  EXPECT_EQ(1u, s3Client->abortedUploads);
+  EXPECT_TRUE(s3Client->objects.empty ());
+  EXPECT_TRUE(sqsClient->messages.empty ());
+}
+
+TEST(SQSExtendedClientTest, TestCompressesLargeMessagesInline)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsConfig = BuildConfiguration (s3Client);
+  sqsConfig->SetInlineCompressionEnabled ();
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, sqsConfig);
+
+  SendMessageRequest request;
+  request.SetQueueUrl ("queue");
+  request.SetMessageBody (BuildPayload (4 * LARGE_PAYLOAD_SIZE, 3));
+  ASSERT_TRUE(client.SendMessage (request).IsSuccess ());
+
+  EXPECT_EQ(0u, s3Client->putObjectCalls);
+  ASSERT_EQ(1u, sqsClient->messages.size ());
+  const SendMessageRequest& sentRequest = sqsClient->messages[0];
+  EXPECT_EQ(1u, sentRequest.GetMessageAttributes ().count ("SQSInlinePayloadCodec"));
+  EXPECT_LE(sentRequest.GetMessageBody ().size (), sqsConfig->GetMessageSizeThreshold ());
+
+  Aws::Utils::ByteBuffer encodedBuffer = Aws::Utils::HashingUtils::Base64Decode (sentRequest.GetMessageBody ());
+  Aws::String encoded (reinterpret_cast<const char*> (encodedBuffer.GetUnderlyingData ()), encodedBuffer.GetLength ());
+  Aws::StringStream encodedStream (encoded);
+  Aws::String decoded;
+  ASSERT_TRUE(SQSDeflateCodec ().Decode (encodedStream, decoded));
+  EXPECT_TRUE(request.GetMessageBody () == decoded);
+}
+
+TEST(SQSExtendedClientTest, TestOffloadsWhatDoesNotFitInline)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsConfig = BuildConfiguration (s3Client);
+  sqsConfig->SetInlineCompressionEnabled ();
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, sqsConfig);
+
+  // does not shrink enough
+  Aws::String incompressible (LARGE_PAYLOAD_SIZE, '\0');
+  unsigned seed = 12345;
+  for (auto& c : incompressible)
+  {
+    seed = seed * 1103515245 + 12345;
+    c = static_cast<char> (seed >> 16);
+  }
+  // would shrink enough, but is too far above the threshold to be worth a try
+  Aws::String oversized (40 * sqsConfig->GetMessageSizeThreshold (), 'x');
+
+  for (const Aws::String* messageBody : {&incompressible, &oversized})
+  {
+    SendMessageRequest request;
+    request.SetQueueUrl ("queue");
+    request.SetMessageBody (*messageBody);
+    ASSERT_TRUE(client.SendMessage (request).IsSuccess ());
+  }
+
+  EXPECT_EQ(2u, s3Client->putObjectCalls);
+  ASSERT_EQ(2u, sqsClient->messages.size ());
+  for (auto& sentRequest : sqsClient->messages)
+  {
+    EXPECT_EQ(0u, sentRequest.GetMessageAttributes ().count ("SQSInlinePayloadCodec"));
+    EXPECT_EQ(1u, sentRequest.GetMessageAttributes ().count ("SQSLargePayloadSize"));
+  }
+  EXPECT_TRUE(GetStoredPayload (*s3Client, sqsClient->messages[0].GetMessageBody ()) == incompressible);
+  EXPECT_TRUE(GetStoredPayload (*s3Client, sqsClient->messages[1].GetMessageBody ()) == oversized);
+}
+
+TEST(SQSExtendedClientTest, TestReceiveFetchesPayloadsConcurrentlyInOrder)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsConfig = BuildConfiguration (s3Client);
+  sqsConfig->SetS3MaxConcurrency (4);
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, sqsConfig);
+
+  const unsigned messageCount = 10;
+  for (unsigned i = 0; i < messageCount; ++i)
+  {
+    SendMessageRequest request;
+    request.SetQueueUrl ("queue");
+    request.SetMessageBody (BuildPayload (LARGE_PAYLOAD_SIZE, i));
+    ASSERT_TRUE(client.SendMessage (request).IsSuccess ());
+  }
+
+  // the first payloads take the longest, so the downloads finish in reverse order
+  for (unsigned i = 0; i < messageCount; ++i)
+  {
+    SQSLargeMessageS3PointerView s3PointerView;
+    ASSERT_TRUE(s3PointerView.Parse (sqsClient->messages[i].GetMessageBody ()));
+    s3Client->downloadDelays[s3PointerView.GetS3BucketName ().ToString () + "/" + s3PointerView.GetS3Key ().ToString ()] =
+        std::chrono::milliseconds (20 * (messageCount - i));
+  }
+
+  ReceiveMessageRequest request;
+  request.SetQueueUrl ("queue");
+  request.SetMaxNumberOfMessages (messageCount);
+  ReceiveMessageOutcome outcome = client.ReceiveMessage (request);
+  ASSERT_TRUE(outcome.IsSuccess ());
+
+  const Aws::Vector<Message>& messages = outcome.GetResult ().GetMessages ();
+  ASSERT_EQ(messageCount, messages.size ());
+  for (unsigned i = 0; i < messageCount; ++i)
+  {
+    EXPECT_TRUE(messages[i].GetBody () == BuildPayload (LARGE_PAYLOAD_SIZE, i)) << i;
+    SQSReceiptHandleView receiptHandleView;
+    EXPECT_TRUE(receiptHandleView.Parse (messages[i].GetReceiptHandle ())) << i;
+    EXPECT_EQ(Aws::String ("handle-") + std::to_string (i).c_str (), receiptHandleView.GetSQSReceiptHandle ().ToString ());
+  }
+  EXPECT_GT(s3Client->maxActiveDownloads, 1u);
+  EXPECT_LE(s3Client->maxActiveDownloads, 4u);
+}
+
+TEST(SQSExtendedClientTest, TestRangedDownloadSplitsThePayloadIntoParts)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, BuildRangedConfiguration (s3Client));
+
+  Aws::String payload = BuildPayload (RANGED_PAYLOAD_SIZE, 0);
+  Message message = SendAndReceive (client, payload);
+
+  EXPECT_TRUE(message.GetBody () == payload);
+  Aws::Vector<Aws::String> ranges = GetSortedRanges (*s3Client);
+  ASSERT_EQ(3u, ranges.size ());
+  EXPECT_EQ("bytes=0-4095", ranges[0]);
+  EXPECT_EQ("bytes=4096-8191", ranges[1]);
+  EXPECT_EQ("bytes=8192-9999", ranges[2]);
+}
+
+TEST(SQSExtendedClientTest, TestRangedDownloadRetriesAShortPart)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  s3Client->shortRanges["bytes=4096-8191"] = 1;
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, BuildRangedConfiguration (s3Client));
+
+  Aws::String payload = BuildPayload (RANGED_PAYLOAD_SIZE, 1);
+  Message message = SendAndReceive (client, payload);
+
+  // only the part cut short is fetched again
+  EXPECT_TRUE(message.GetBody () == payload);
+  Aws::Vector<Aws::String> ranges = GetSortedRanges (*s3Client);
+  ASSERT_EQ(4u, ranges.size ());
+  EXPECT_EQ("bytes=4096-8191", ranges[1]);
+  EXPECT_EQ("bytes=4096-8191", ranges[2]);
+}
+
+TEST(SQSExtendedClientTest, TestRangedDownloadGivesUpOnAFailingPart)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsConfig = BuildRangedConfiguration (s3Client);
+  sqsConfig->SetS3MaxRetries (2);
+  sqsConfig->SetLazyPayloadLoadingEnabled ();
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, sqsConfig);
+
+  Message message = SendAndReceive (client, BuildPayload (RANGED_PAYLOAD_SIZE, 2));
+  std::shared_ptr<SQSLazyPayload> lazyPayload = client.GetLazyPayload (message);
+
+  // an error worth retrying is tried again up to the limit, what the caller already had is left as it was
+  s3Client->rangeFailures["bytes=4096-8191"] = 100;
+  Aws::String payload = "kept";
+  EXPECT_FALSE(lazyPayload->Read (0, RANGED_PAYLOAD_SIZE, payload));
+  EXPECT_EQ("kept", payload);
+  EXPECT_EQ(3u, std::count (s3Client->getObjectRanges.begin (), s3Client->getObjectRanges.end (), "bytes=4096-8191"));
+
+  // any other error ends the download at once
+  s3Client->getObjectRanges.clear ();
+  s3Client->refusedRanges.insert ("bytes=8192-9999");
+  s3Client->rangeFailures.clear ();
+  EXPECT_FALSE(lazyPayload->Read (0, RANGED_PAYLOAD_SIZE, payload));
+  EXPECT_EQ("kept", payload);
+  EXPECT_EQ(1u, std::count (s3Client->getObjectRanges.begin (), s3Client->getObjectRanges.end (), "bytes=8192-9999"));
+}
+
+TEST(SQSExtendedClientTest, TestDeleteBatchMapsPayloadErrorsToEntries)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, BuildConfiguration (s3Client));
+
+  DeleteMessageBatchRequest request;
+  request.SetQueueUrl ("queue");
+  const char* receiptHandles[] = {
+    "1", "bucket", "payload-1", "handle-1",
+    "2", "bucket", "locked-2", "handle-2",
+    "3", "unreachable", "payload-3", "handle-3",
+    "4", "bucket", "locked-4", "invalid-4",
+    "5", nullptr, nullptr, "handle-5"
+  };
+  for (size_t i = 0; i < sizeof (receiptHandles) / sizeof (receiptHandles[0]); i += 4)
+  {
+    DeleteMessageBatchRequestEntry entry;
+    entry.SetId (receiptHandles[i]);
+    entry.SetReceiptHandle (receiptHandles[i + 1]
+        ? SQSReceiptHandleView::Envelope (receiptHandles[i + 1], receiptHandles[i + 2], receiptHandles[i + 3])
+        : Aws::String (receiptHandles[i + 3]));
+    request.AddEntries (entry);
+  }
+  DeleteMessageBatchOutcome outcome = client.DeleteMessageBatch (request);
+  ASSERT_TRUE(outcome.IsSuccess ());
+
+  // one multi-object delete per bucket, beside the sqs one
+  ASSERT_EQ(2u, s3Client->deleteObjectsRequests.size ());
+  EXPECT_EQ(Aws::Vector<Aws::String> ({"handle-1", "handle-2", "handle-3", "handle-5"}), sqsClient->deletedReceiptHandles);
+
+  Aws::Vector<Aws::String> successful;
+  for (auto& entry : outcome.GetResult ().GetSuccessful ())
+  {
+    successful.push_back (entry.GetId ());
+  }
+  EXPECT_EQ(Aws::Vector<Aws::String> ({"1", "5"}), successful);
+
+  // an entry sqs deleted but whose payload is still in s3 fails with the s3 error, one sqs kept with its own
+  Aws::Map<Aws::String, Aws::String> failed;
+  for (auto& entry : outcome.GetResult ().GetFailed ())
+  {
+    failed[entry.GetId ()] = entry.GetCode ();
+    EXPECT_EQ(entry.GetId () == "4", entry.GetSenderFault ()) << entry.GetId ();
+  }
+  ASSERT_EQ(3u, failed.size ());
+  EXPECT_EQ("AccessDenied", failed["2"]);
+  EXPECT_EQ("NetworkingError", failed["3"]);
+  EXPECT_EQ("ReceiptHandleIsInvalid", failed["4"]);
+}
+
+TEST(SQSExtendedClientTest, TestDeleteBatchSendsQuietGroupsOf1000Keys)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, BuildConfiguration (s3Client));
+
+  const size_t entryCount = 2500;
+  DeleteMessageBatchRequest request;
+  request.SetQueueUrl ("queue");
+  for (size_t i = 0; i < entryCount; ++i)
+  {
+    Aws::String id = std::to_string (i).c_str ();
+    DeleteMessageBatchRequestEntry entry;
+    entry.SetId (id);
+    entry.SetReceiptHandle (SQSReceiptHandleView::Envelope (S3_BUCKET_NAME, "payload-" + id, "handle-" + id));
+    request.AddEntries (entry);
+  }
+  DeleteMessageBatchOutcome outcome = client.DeleteMessageBatch (request);
+  ASSERT_TRUE(outcome.IsSuccess ());
+  EXPECT_EQ(entryCount, outcome.GetResult ().GetSuccessful ().size ());
+  EXPECT_TRUE(outcome.GetResult ().GetFailed ().empty ());
+
+  // s3 takes at most 1000 keys per call
+  ASSERT_EQ(3u, s3Client->deleteObjectsRequests.size ());
+  size_t groupSizes[] = {1000, 1000, 500};
+  for (size_t i = 0; i < 3; ++i)
+  {
+    EXPECT_EQ(groupSizes[i], s3Client->deleteObjectsRequests[i].GetDelete ().GetObjects ().size ());
+    EXPECT_TRUE(s3Client->deleteObjectsRequests[i].GetDelete ().GetQuiet ());
+  }
+  EXPECT_EQ(entryCount, s3Client->deletedKeys.size ());
+}
+
+TEST(SQSExtendedClientTest, TestDeduplicatedPayloadsAreKeyedBySha256)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsConfig = BuildConfiguration (s3Client);
+  sqsConfig->SetAlwaysThroughS3Enabled ();
+  sqsConfig->SetPayloadDeduplicationEnabled ();
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, sqsConfig);
+
+  SendMessageRequest request;
+  request.SetQueueUrl ("queue");
+  request.SetMessageBody ("payload");
+  ASSERT_TRUE(client.SendMessage (request).IsSuccess ());
+  ASSERT_TRUE(client.SendMessage (request).IsSuccess ());
+
+  // the second send finds the object in the cache, without asking s3
+  EXPECT_EQ(1u, s3Client->putObjectCalls);
+  EXPECT_EQ(1u, s3Client->headObjectCalls);
+  ASSERT_EQ(2u, sqsClient->messages.size ());
+  SQSLargeMessageS3PointerView s3PointerView;
+  ASSERT_TRUE(s3PointerView.Parse (sqsClient->messages[0].GetMessageBody ()));
+  Aws::String s3Key = Aws::String ("SQSLargePayloadSha256-")
+      + Aws::Utils::HashingUtils::HexEncode (Aws::Utils::HashingUtils::CalculateSHA256 ("payload"));
+  EXPECT_EQ(s3Key, s3PointerView.GetS3Key ().ToString ());
+  EXPECT_EQ(sqsClient->messages[0].GetMessageBody (), sqsClient->messages[1].GetMessageBody ());
+}
+
+TEST(SQSExtendedClientTest, TestDeduplicationReusesFreshObjectsFoundInS3)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsConfig = BuildConfiguration (s3Client);
+  sqsConfig->SetAlwaysThroughS3Enabled ();
+  sqsConfig->SetPayloadDeduplicationEnabled ();
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+
+  SendMessageRequest request;
+  request.SetQueueUrl ("queue");
+  request.SetMessageBody ("payload");
+  {
+    SQSExtendedClient client (sqsClient, sqsConfig);
+    ASSERT_TRUE(client.SendMessage (request).IsSuccess ());
+  }
+
+  // another client, with nothing cached yet, finds the object in s3
+  SQSExtendedClient client (sqsClient, sqsConfig);
+  ASSERT_TRUE(client.SendMessage (request).IsSuccess ());
+  EXPECT_EQ(1u, s3Client->putObjectCalls);
+  EXPECT_EQ(2u, s3Client->headObjectCalls);
+}
+
+TEST(SQSExtendedClientTest, TestDeduplicationKeepsASafetyMarginBeforeMaxAge)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsConfig = BuildConfiguration (s3Client);
+  sqsConfig->SetAlwaysThroughS3Enabled ();
+  sqsConfig->SetPayloadDeduplicationEnabled ();
+  sqsConfig->SetPayloadDeduplicationMaxAge (10);
+  sqsConfig->SetPayloadDeduplicationSafetyMargin (5);
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, sqsConfig);
+
+  Aws::String s3Key = Aws::String ("SQSLargePayloadSha256-")
+      + Aws::Utils::HashingUtils::HexEncode (Aws::Utils::HashingUtils::CalculateSHA256 ("payload"));
+  SendMessageRequest request;
+  request.SetQueueUrl ("queue");
+  request.SetMessageBody ("payload");
+
+  // stored 4s ago, it has more than the margin left and is reused
+  s3Client->lastModified[Aws::String (S3_BUCKET_NAME) + "/" + s3Key] =
+      Aws::Utils::DateTime (Aws::Utils::DateTime::Now ().Millis () - 4000);
+  ASSERT_TRUE(client.SendMessage (request).IsSuccess ());
+  EXPECT_EQ(0u, s3Client->putObjectCalls);
+
+  // cached as 4s old, it is checked again once inside the margin, and stored again then
+  std::this_thread::sleep_for (std::chrono::milliseconds (1200));
+  ASSERT_TRUE(client.SendMessage (request).IsSuccess ());
+  EXPECT_EQ(2u, s3Client->headObjectCalls);
+  EXPECT_EQ(1u, s3Client->putObjectCalls);
+
+  // now fresh, it is reused from the cache
+  ASSERT_TRUE(client.SendMessage (request).IsSuccess ());
+  EXPECT_EQ(2u, s3Client->headObjectCalls);
+  EXPECT_EQ(1u, s3Client->putObjectCalls);
+}
+
+TEST(SQSExtendedClientTest, TestSharedPayloadsAreNotDeleted)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, BuildConfiguration (s3Client));
+
+  for (const char* s3Key : {"SQSLargePayloadSha256-6f1c", "SQSLargePayloadBatch-42", "6f1c-42"})
+  {
+    DeleteMessageRequest request;
+    request.SetQueueUrl ("queue");
+    request.SetReceiptHandle (SQSReceiptHandleView::Envelope (S3_BUCKET_NAME, s3Key, "handle"));
+    ASSERT_TRUE(client.DeleteMessage (request).IsSuccess ());
+  }
+
+  // other messages may point to deduplicated or packed objects, a lifecycle rule expires them
+  ASSERT_EQ(1u, s3Client->deletedKeys.size ());
+  EXPECT_EQ("6f1c-42", s3Client->deletedKeys[0]);
+  EXPECT_EQ(Aws::Vector<Aws::String> (3, "handle"), sqsClient->deletedReceiptHandles);
+}
+
+TEST(SQSExtendedClientTest, TestDestructionWaitsForQueuedAsyncOperations)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  s3Client->uploadDelay = std::chrono::milliseconds (20);
+  auto sqsConfig = BuildConfiguration (s3Client);
+  sqsConfig->SetAsyncThreadPoolSize (1);
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+
+  Aws::Vector<SendMessageOutcomeCallable> sendOutcomes;
+  std::atomic<unsigned> handlerCalls (0);
+  {
+    SQSExtendedClient client (sqsClient, sqsConfig);
+    for (unsigned i = 0; i < 4; ++i)
+    {
+      SendMessageRequest request;
+      request.SetQueueUrl ("queue");
+      request.SetMessageBody (BuildPayload (LARGE_PAYLOAD_SIZE, i));
+      sendOutcomes.push_back (client.SendMessageCallable (request));
+      client.SendMessageAsync (request, [&handlerCalls] (const SQSClient*, const SendMessageRequest&, const SendMessageOutcome& outcome,
+                                                         const std::shared_ptr<const Aws::Client::AsyncCallerContext>&)
+      {
+        if (outcome.IsSuccess ())
+        {
+          ++handlerCalls;
+        }
+      });
+    }
+  }
+
+  // one thread cannot have got through them all, the rest was queued when the client went away
+  for (auto& sendOutcome : sendOutcomes)
+  {
+    ASSERT_EQ(std::future_status::ready, sendOutcome.wait_for (std::chrono::seconds (0)));
+    EXPECT_TRUE(sendOutcome.get ().IsSuccess ());
+  }
+  EXPECT_EQ(4u, handlerCalls.load ());
+  EXPECT_EQ(8u, s3Client->putObjectCalls);
+  EXPECT_EQ(8u, sqsClient->messages.size ());
+}
+
+#ifdef USE_AWS_MEMORY_MANAGEMENT
+
+TEST(SQSExtendedClientTest, TestOffloadingCopiesThePayloadAtMostOnce)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  s3Client->storeObjects = false;
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSExtendedClient client (sqsClient, BuildConfiguration (s3Client));
+
+  SendMessageRequest request;
+  request.SetQueueUrl ("queue");
+  request.SetMessageBody (BuildPayload (4 * 1024 * 1024, 0));
+
+  BaseTestMemorySystem memorySystem;
+  Aws::Utils::Memory::InitializeAWSMemorySystem (memorySystem);
+  bool isSent = client.SendMessage (request).IsSuccess ();
+  Aws::Utils::Memory::ShutdownAWSMemorySystem ();
+
+  ASSERT_TRUE(isSent);
+  // the copy of the request that gets the pointer as body is the only one holding the payload for a while
+  EXPECT_LT(memorySystem.GetTotalBytesAllocated (), 2ULL * request.GetMessageBody ().size ());
+}
+
+#endif // USE_AWS_MEMORY_MANAGEMENT
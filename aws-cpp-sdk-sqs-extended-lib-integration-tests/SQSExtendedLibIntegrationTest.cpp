@@ -35,6 +35,9 @@
 #include <aws/cognito-identity/CognitoIdentityClient.h>
 #include <aws/sqs/extendedlib/SQSExtendedClient.h>
 #include <aws/sqs/extendedlib/SQSExtendedClientConfiguration.h>
+#include <aws/sqs/extendedlib/SQSReceiptHandleView.h>
+#include <aws/sqs/extendedlib/SQSVisibilityHeartbeat.h>
+#include <future>
 #include <math.h>
 
 using namespace Aws;
@@ -64,6 +67,14 @@ static const char* LARGEMESSAGE_WITHPAYLOADSUPPORTENABLED_BUCKET = BUCKET_PREFIX
 static const char* SMALLMESSAGE_WITHALLWAYSTHROUGHS3ENABLED_BUCKET = BUCKET_PREFIX "SMessageWithAllwaysThroughS3Enabled";
 static const char* LARGEMESSAGE_WITHALLWAYSTHROUGHS3ENABLED_BUCKET = BUCKET_PREFIX "LMessageWithAllwaysThroughS3Enabled";
 static const char* RANDOMBATCHMESSAGES_BUCKET = BUCKET_PREFIX "RamdomBatchMessages";
+static const char* PACKEDBATCHMESSAGES_BUCKET = BUCKET_PREFIX "PackedBatchMessages";
+static const char* ASYNCMESSAGES_BUCKET = BUCKET_PREFIX "AsyncMessages";
+static const char* OVERSIZEDBATCHMESSAGES_BUCKET = BUCKET_PREFIX "OversizedBatchMessages";
+static const char* BULKMESSAGES_BUCKET = BUCKET_PREFIX "BulkMessages";
+static const char* PIPELINEDBATCHMESSAGES_BUCKET = BUCKET_PREFIX "PipelinedBatchMessages";
+static const char* MESSAGEVISIBILITY_BUCKET = BUCKET_PREFIX "MessageVisibility";
+static const char* COMPACTS3POINTER_BUCKET = BUCKET_PREFIX "CompactS3Pointer";
+static const char* RECEIPTHANDLEENVELOPE_BUCKET = BUCKET_PREFIX "ReceiptHandleEnvelope";
 
 #define QUEUENAME_PREFIX "ExtendedQueue_ITest_"
 
@@ -74,6 +85,14 @@ static const char* LARGEMESSAGE_WITHPAYLOADSUPPORTEDISABLED_QUEUENAME = QUEUENAM
 static const char* SMALLMESSAGE_WITHALLWAYSTHROUGHS3ENABLED_QUEUENAME = QUEUENAME_PREFIX "SMessageWithAllwaysThroughS3Enabled";
 static const char* LARGEMESSAGE_WITHALLWAYSTHROUGHS3ENABLED_QUEUENAME = QUEUENAME_PREFIX "LMessageWithAllwaysThroughS3Enabled";
 static const char* RANDOMBATCHMESSAGES_QUEUENAME = QUEUENAME_PREFIX "RamdomBatchMessages";
+static const char* PACKEDBATCHMESSAGES_QUEUENAME = QUEUENAME_PREFIX "PackedBatchMessages";
+static const char* ASYNCMESSAGES_QUEUENAME = QUEUENAME_PREFIX "AsyncMessages";
+static const char* OVERSIZEDBATCHMESSAGES_QUEUENAME = QUEUENAME_PREFIX "OversizedBatchMessages";
+static const char* BULKMESSAGES_QUEUENAME = QUEUENAME_PREFIX "BulkMessages";
+static const char* PIPELINEDBATCHMESSAGES_QUEUENAME = QUEUENAME_PREFIX "PipelinedBatchMessages";
+static const char* MESSAGEVISIBILITY_QUEUENAME = QUEUENAME_PREFIX "MessageVisibility";
+static const char* COMPACTS3POINTER_QUEUENAME = QUEUENAME_PREFIX "CompactS3Pointer";
+static const char* RECEIPTHANDLEENVELOPE_QUEUENAME = QUEUENAME_PREFIX "ReceiptHandleEnvelope";
 
 namespace
 {
@@ -718,3 +737,580 @@ TEST_F(ExtendedQueueOperationTest, TestBatchMessagesWithRamdomPayloadSize)
   ASSERT_TRUE(deleteB.IsSuccess ());
 }
 
+TEST_F(ExtendedQueueOperationTest, TestBatchMessagesPackedInOneObject)
+{
+  // build a bucket, an extended sqs config packing batch payloads, an extended sqs client and a queue
+  Aws::String s3BucketName = RandomizedS3BucketName(PACKEDBATCHMESSAGES_BUCKET);
+  CreateBucket (s3Client, s3BucketName);
+
+  auto sqsConfig = Aws::MakeShared<SQSExtendedClientConfiguration> (ALLOCATION_TAG);
+  sqsConfig->SetLargePayloadSupportEnabled (s3Client, s3BucketName);
+  sqsConfig->SetBatchPackingEnabled ();
+
+  std::shared_ptr<SQSClient> sqsClient = Aws::MakeShared<SQSExtendedClient> (ALLOCATION_TAG, sqsStdClient, sqsConfig);
+
+  Aws::String queueUrl = CreateQueue (sqsClient, PACKEDBATCHMESSAGES_QUEUENAME);
+
+  Aws::Vector<unsigned> messageSizes = {QUEUE_SIZE_LIMIT + 1000, 100, QUEUE_SIZE_LIMIT + 2000, QUEUE_SIZE_LIMIT + 3000};
+  unsigned numberOfMessages = messageSizes.size();
+
+  // create sendBatchEntries, each large body is told apart by its first character
+  Aws::Vector<SendMessageBatchRequestEntry> sendBatchEntries;
+  for (unsigned i = 1; i <= numberOfMessages; i++)
+  {
+    SendMessageBatchRequestEntry entry;
+    String messageBody = ExtendedQueueOperationTest::GenerateMessageBody (messageSizes[i-1]);
+    messageBody[0] = static_cast<char> ('0' + i);
+    entry.SetMessageBody (messageBody);
+    entry.SetId (std::to_string (i).c_str ());
+    sendBatchEntries.push_back (entry);
+  }
+
+  // send messages
+  SendMessageBatchRequest sendMessageBatchRequest;
+  sendMessageBatchRequest.SetQueueUrl (queueUrl);
+  sendMessageBatchRequest.SetEntries (sendBatchEntries);
+  SendMessageBatchOutcome sendM = sqsClient->SendMessageBatch (sendMessageBatchRequest);
+  ASSERT_TRUE(sendM.IsSuccess ());
+  ASSERT_EQ(numberOfMessages, sendM.GetResult ().GetSuccessful ().size ());
+
+  // receive messages, several per call so the packed ones get fetched together
+  ReceiveMessageRequest receiveMessageRequest;
+  receiveMessageRequest.SetQueueUrl (queueUrl);
+  receiveMessageRequest.SetMaxNumberOfMessages (10);
+  Vector<Message> messages;
+  for (unsigned attempt = 0; attempt < 10 && messages.size () < numberOfMessages; attempt++)
+  {
+    auto receiveM = sqsClient->ReceiveMessage (receiveMessageRequest);
+    ASSERT_TRUE(receiveM.IsSuccess ());
+    for (auto& message : receiveM.GetResult ().GetMessages ())
+    {
+      messages.push_back (message);
+    }
+  }
+  ASSERT_EQ(numberOfMessages, messages.size ());
+
+  // every large body comes back whole, and all of them from the same object
+  Aws::String s3Key;
+  for (auto& message : messages)
+  {
+    unsigned i = message.GetBody ()[0] - '0';
+    ASSERT_TRUE(i >= 1 && i <= numberOfMessages);
+    EXPECT_EQ(sendBatchEntries[i - 1].GetMessageBody (), message.GetBody ());
+
+    if (message.GetReceiptHandle ().find (S3_KEY_MARKER) != std::string::npos)
+    {
+      Aws::String messageS3Key = ExtendedQueueOperationTest::GetFromReceiptHandleByMarker (message.GetReceiptHandle (),
+                                                                                           S3_KEY_MARKER);
+      EXPECT_TRUE(s3Key.empty () || s3Key == messageS3Key);
+      s3Key = messageS3Key;
+    }
+  }
+  ASSERT_FALSE(s3Key.empty ());
+
+  // create deleteBatchEntries
+  Aws::Vector<DeleteMessageBatchRequestEntry> deleteBatchEntries;
+  for (unsigned i = 1; i <= numberOfMessages; i++)
+  {
+    DeleteMessageBatchRequestEntry entry;
+    entry.SetReceiptHandle (messages[i - 1].GetReceiptHandle ());
+    entry.SetId (std::to_string (i).c_str ());
+    deleteBatchEntries.push_back (entry);
+  }
+
+  // delete messages
+  DeleteMessageBatchRequest deleteMessageBatchRequest;
+  deleteMessageBatchRequest.SetQueueUrl (queueUrl);
+  deleteMessageBatchRequest.SetEntries (deleteBatchEntries);
+  DeleteMessageBatchOutcome deleteM = sqsClient->DeleteMessageBatch (deleteMessageBatchRequest);
+  ASSERT_TRUE(deleteM.IsSuccess ());
+
+  // the packed object is left to the bucket lifecycle
+  HeadObjectRequest headObjectRequest;
+  headObjectRequest.SetBucket (s3BucketName);
+  headObjectRequest.SetKey (s3Key);
+  HeadObjectOutcome headObjectOutcome = s3Client->HeadObject (headObjectRequest);
+  ASSERT_TRUE(headObjectOutcome.IsSuccess ());
+
+  DeleteObjectRequest deleteObjectRequest;
+  deleteObjectRequest.SetBucket (s3BucketName);
+  deleteObjectRequest.SetKey (s3Key);
+  s3Client->DeleteObject (deleteObjectRequest);
+
+  // delete queue
+  DeleteQueueOutcome deleteQ = DeleteQueue (sqsClient, queueUrl);
+  ASSERT_TRUE(deleteQ.IsSuccess ());
+
+  //delete bucket
+  DeleteBucketOutcome deleteB = DeleteBucket (s3Client, s3BucketName);
+  ASSERT_TRUE(deleteB.IsSuccess ());
+}
+
+TEST_F(ExtendedQueueOperationTest, TestLargeMessagesThroughAsyncOperations)
+{
+  // build a bucket, an extended sqs config, an extended sqs client and a queue
+  Aws::String s3BucketName = RandomizedS3BucketName(ASYNCMESSAGES_BUCKET);
+  CreateBucket (s3Client, s3BucketName);
+
+  auto sqsConfig = Aws::MakeShared<SQSExtendedClientConfiguration> (ALLOCATION_TAG);
+  sqsConfig->SetLargePayloadSupportEnabled (s3Client, s3BucketName);
+
+  std::shared_ptr<SQSClient> sqsClient = Aws::MakeShared<SQSExtendedClient> (ALLOCATION_TAG, sqsStdClient, sqsConfig);
+
+  Aws::String queueUrl = CreateQueue (sqsClient, ASYNCMESSAGES_QUEUENAME);
+
+  // send every message before waiting for any, each large body is told apart by its first character
+  unsigned numberOfMessages = 5;
+  Aws::Vector<Aws::String> messageBodies;
+  Aws::Vector<SendMessageOutcomeCallable> sendOutcomes;
+  for (unsigned i = 1; i <= numberOfMessages; i++)
+  {
+    Aws::String messageBody = ExtendedQueueOperationTest::GenerateMessageBody (QUEUE_SIZE_LIMIT + 1000);
+    messageBody[0] = static_cast<char> ('0' + i);
+    messageBodies.push_back (messageBody);
+
+    SendMessageRequest sendMessageRequest;
+    sendMessageRequest.SetQueueUrl (queueUrl);
+    sendMessageRequest.SetMessageBody (messageBody);
+    sendOutcomes.push_back (sqsClient->SendMessageCallable (sendMessageRequest));
+  }
+  for (auto& sendOutcome : sendOutcomes)
+  {
+    ASSERT_TRUE(sendOutcome.get ().IsSuccess ());
+  }
+
+  // receive messages through the handler
+  ReceiveMessageRequest receiveMessageRequest;
+  receiveMessageRequest.SetQueueUrl (queueUrl);
+  receiveMessageRequest.SetMaxNumberOfMessages (10);
+  Vector<Message> messages;
+  for (unsigned attempt = 0; attempt < 10 && messages.size () < numberOfMessages; attempt++)
+  {
+    std::promise<ReceiveMessageOutcome> receiveOutcome;
+    sqsClient->ReceiveMessageAsync (receiveMessageRequest, [&receiveOutcome] (const SQSClient*, const ReceiveMessageRequest&,
+                                                                              const ReceiveMessageOutcome& outcome,
+                                                                              const std::shared_ptr<const AsyncCallerContext>&)
+    {
+      receiveOutcome.set_value (outcome);
+    });
+    ReceiveMessageOutcome receiveM = receiveOutcome.get_future ().get ();
+    ASSERT_TRUE(receiveM.IsSuccess ());
+    for (auto& message : receiveM.GetResult ().GetMessages ())
+    {
+      messages.push_back (message);
+    }
+  }
+  ASSERT_EQ(numberOfMessages, messages.size ());
+
+  // every body comes back whole, then its message and payload are deleted
+  Aws::Vector<DeleteMessageOutcomeCallable> deleteOutcomes;
+  for (auto& message : messages)
+  {
+    unsigned i = message.GetBody ()[0] - '0';
+    ASSERT_TRUE(i >= 1 && i <= numberOfMessages);
+    EXPECT_EQ(messageBodies[i - 1], message.GetBody ());
+
+    DeleteMessageRequest deleteMessageRequest;
+    deleteMessageRequest.SetQueueUrl (queueUrl);
+    deleteMessageRequest.SetReceiptHandle (message.GetReceiptHandle ());
+    deleteOutcomes.push_back (sqsClient->DeleteMessageCallable (deleteMessageRequest));
+  }
+  for (auto& deleteOutcome : deleteOutcomes)
+  {
+    ASSERT_TRUE(deleteOutcome.get ().IsSuccess ());
+  }
+
+  // check if s3keys were removed
+  for (auto& message : messages)
+  {
+    HeadObjectRequest headObjectRequest;
+    headObjectRequest.SetBucket (s3BucketName);
+    headObjectRequest.SetKey (ExtendedQueueOperationTest::GetFromReceiptHandleByMarker (message.GetReceiptHandle (),
+                                                                                       S3_KEY_MARKER));
+    HeadObjectOutcome headObjectOutcome = s3Client->HeadObject (headObjectRequest);
+    ASSERT_FALSE(headObjectOutcome.IsSuccess ());
+  }
+
+  // delete queue
+  DeleteQueueOutcome deleteQ = DeleteQueue (sqsClient, queueUrl);
+  ASSERT_TRUE(deleteQ.IsSuccess ());
+
+  //delete bucket
+  DeleteBucketOutcome deleteB = DeleteBucket (s3Client, s3BucketName);
+  ASSERT_TRUE(deleteB.IsSuccess ());
+}
+
+TEST_F(ExtendedQueueOperationTest, TestBatchMessagesOverTheAggregateLimit)
+{
+  // build a bucket, an extended sqs config, an extended sqs client and a queue
+  Aws::String s3BucketName = RandomizedS3BucketName(OVERSIZEDBATCHMESSAGES_BUCKET);
+  CreateBucket (s3Client, s3BucketName);
+
+  auto sqsConfig = Aws::MakeShared<SQSExtendedClientConfiguration> (ALLOCATION_TAG);
+  sqsConfig->SetLargePayloadSupportEnabled (s3Client, s3BucketName);
+
+  std::shared_ptr<SQSClient> sqsClient = Aws::MakeShared<SQSExtendedClient> (ALLOCATION_TAG, sqsStdClient, sqsConfig);
+
+  Aws::String queueUrl = CreateQueue (sqsClient, OVERSIZEDBATCHMESSAGES_QUEUENAME);
+
+  // every body is under the threshold, all of them together are way over the batch limit
+  unsigned numberOfMessages = 10;
+  Aws::Vector<SendMessageBatchRequestEntry> sendBatchEntries;
+  for (unsigned i = 0; i < numberOfMessages; i++)
+  {
+    SendMessageBatchRequestEntry entry;
+    String messageBody = ExtendedQueueOperationTest::GenerateMessageBody (200 * 1024);
+    messageBody[0] = static_cast<char> ('0' + i);
+    entry.SetMessageBody (messageBody);
+    entry.SetId (std::to_string (i).c_str ());
+    sendBatchEntries.push_back (entry);
+  }
+
+  SendMessageBatchRequest sendMessageBatchRequest;
+  sendMessageBatchRequest.SetQueueUrl (queueUrl);
+  sendMessageBatchRequest.SetEntries (sendBatchEntries);
+  SendMessageBatchOutcome sendM = sqsClient->SendMessageBatch (sendMessageBatchRequest);
+  ASSERT_TRUE(sendM.IsSuccess ());
+  ASSERT_EQ(numberOfMessages, sendM.GetResult ().GetSuccessful ().size ());
+
+  // receive messages
+  ReceiveMessageRequest receiveMessageRequest;
+  receiveMessageRequest.SetQueueUrl (queueUrl);
+  receiveMessageRequest.SetMaxNumberOfMessages (10);
+  Vector<Message> messages;
+  for (unsigned attempt = 0; attempt < 10 && messages.size () < numberOfMessages; attempt++)
+  {
+    auto receiveM = sqsClient->ReceiveMessage (receiveMessageRequest);
+    ASSERT_TRUE(receiveM.IsSuccess ());
+    for (auto& message : receiveM.GetResult ().GetMessages ())
+    {
+      messages.push_back (message);
+    }
+  }
+  ASSERT_EQ(numberOfMessages, messages.size ());
+
+  // only as many bodies as needed went through s3, the last one fitted in the batch
+  unsigned offloadedMessages = 0;
+  for (auto& message : messages)
+  {
+    unsigned i = message.GetBody ()[0] - '0';
+    ASSERT_TRUE(i < numberOfMessages);
+    EXPECT_EQ(sendBatchEntries[i].GetMessageBody (), message.GetBody ());
+    if (message.GetReceiptHandle ().find (S3_KEY_MARKER) != std::string::npos)
+    {
+      offloadedMessages++;
+    }
+
+    DeleteMessageOutcome deleteM = ExtendedQueueOperationTest::DeleteMessage (sqsClient, queueUrl,
+                                                                               message.GetReceiptHandle ());
+    ASSERT_TRUE(deleteM.IsSuccess ());
+  }
+  EXPECT_EQ(numberOfMessages - 1, offloadedMessages);
+
+  // delete queue
+  DeleteQueueOutcome deleteQ = DeleteQueue (sqsClient, queueUrl);
+  ASSERT_TRUE(deleteQ.IsSuccess ());
+
+  //delete bucket
+  DeleteBucketOutcome deleteB = DeleteBucket (s3Client, s3BucketName);
+  ASSERT_TRUE(deleteB.IsSuccess ());
+}
+
+TEST_F(ExtendedQueueOperationTest, TestBulkMessagesInConcurrentBatches)
+{
+  // build a bucket, an extended sqs config, an extended sqs client and a queue
+  Aws::String s3BucketName = RandomizedS3BucketName(BULKMESSAGES_BUCKET);
+  CreateBucket (s3Client, s3BucketName);
+
+  auto sqsConfig = Aws::MakeShared<SQSExtendedClientConfiguration> (ALLOCATION_TAG);
+  sqsConfig->SetLargePayloadSupportEnabled (s3Client, s3BucketName);
+
+  auto sqsClient = Aws::MakeShared<SQSExtendedClient> (ALLOCATION_TAG, sqsStdClient, sqsConfig);
+
+  Aws::String queueUrl = CreateQueue (sqsClient, BULKMESSAGES_QUEUENAME);
+
+  // more entries than a single batch takes, a few of them large
+  unsigned numberOfMessages = 35;
+  SendMessageBatchRequest sendMessageBatchRequest;
+  sendMessageBatchRequest.SetQueueUrl (queueUrl);
+  for (unsigned i = 0; i < numberOfMessages; i++)
+  {
+    SendMessageBatchRequestEntry entry;
+    entry.SetMessageBody (i % 10 == 0 ? ExtendedQueueOperationTest::GenerateMessageBody (QUEUE_SIZE_LIMIT + 1000)
+                                      : std::to_string (i).c_str ());
+    entry.SetId (std::to_string (i).c_str ());
+    sendMessageBatchRequest.AddEntries (entry);
+  }
+  SendMessageBatchOutcome sendM = sqsClient->SendMessageBulk (sendMessageBatchRequest);
+  ASSERT_TRUE(sendM.IsSuccess ());
+  ASSERT_EQ(numberOfMessages, sendM.GetResult ().GetSuccessful ().size ());
+  EXPECT_EQ(0uL, sendM.GetResult ().GetFailed ().size ());
+
+  // receive messages
+  ReceiveMessageRequest receiveMessageRequest;
+  receiveMessageRequest.SetQueueUrl (queueUrl);
+  receiveMessageRequest.SetMaxNumberOfMessages (10);
+  DeleteMessageBatchRequest deleteMessageBatchRequest;
+  deleteMessageBatchRequest.SetQueueUrl (queueUrl);
+  for (unsigned attempt = 0; attempt < 20 && deleteMessageBatchRequest.GetEntries ().size () < numberOfMessages; attempt++)
+  {
+    auto receiveM = sqsClient->ReceiveMessage (receiveMessageRequest);
+    ASSERT_TRUE(receiveM.IsSuccess ());
+    for (auto& message : receiveM.GetResult ().GetMessages ())
+    {
+      DeleteMessageBatchRequestEntry entry;
+      entry.SetReceiptHandle (message.GetReceiptHandle ());
+      entry.SetId (std::to_string (deleteMessageBatchRequest.GetEntries ().size ()).c_str ());
+      deleteMessageBatchRequest.AddEntries (entry);
+    }
+  }
+  ASSERT_EQ(numberOfMessages, deleteMessageBatchRequest.GetEntries ().size ());
+
+  // delete messages
+  DeleteMessageBatchOutcome deleteM = sqsClient->DeleteMessageBulk (deleteMessageBatchRequest);
+  ASSERT_TRUE(deleteM.IsSuccess ());
+  EXPECT_EQ(numberOfMessages, deleteM.GetResult ().GetSuccessful ().size ());
+
+  // delete queue
+  DeleteQueueOutcome deleteQ = DeleteQueue (sqsClient, queueUrl);
+  ASSERT_TRUE(deleteQ.IsSuccess ());
+
+  //delete bucket
+  DeleteBucketOutcome deleteB = DeleteBucket (s3Client, s3BucketName);
+  ASSERT_TRUE(deleteB.IsSuccess ());
+}
+
+TEST_F(ExtendedQueueOperationTest, TestPipelinedBatchMessages)
+{
+  // build a bucket, an extended sqs config, an extended sqs client and a queue
+  Aws::String s3BucketName = RandomizedS3BucketName(PIPELINEDBATCHMESSAGES_BUCKET);
+  CreateBucket (s3Client, s3BucketName);
+
+  auto sqsConfig = Aws::MakeShared<SQSExtendedClientConfiguration> (ALLOCATION_TAG);
+  sqsConfig->SetLargePayloadSupportEnabled (s3Client, s3BucketName);
+  sqsConfig->SetBatchPipeliningEnabled ();
+
+  std::shared_ptr<SQSClient> sqsClient = Aws::MakeShared<SQSExtendedClient> (ALLOCATION_TAG, sqsStdClient, sqsConfig);
+
+  Aws::String queueUrl = CreateQueue (sqsClient, PIPELINEDBATCHMESSAGES_QUEUENAME);
+
+  // two large bodies among small ones, the small ones do not wait for the uploads
+  unsigned numberOfMessages = 10;
+  Aws::Vector<SendMessageBatchRequestEntry> sendBatchEntries;
+  for (unsigned i = 0; i < numberOfMessages; i++)
+  {
+    SendMessageBatchRequestEntry entry;
+    String messageBody = ExtendedQueueOperationTest::GenerateMessageBody (i % 5 == 0 ? QUEUE_SIZE_LIMIT + 1000 : 1000);
+    messageBody[0] = static_cast<char> ('0' + i);
+    entry.SetMessageBody (messageBody);
+    entry.SetId (std::to_string (i).c_str ());
+    sendBatchEntries.push_back (entry);
+  }
+
+  SendMessageBatchRequest sendMessageBatchRequest;
+  sendMessageBatchRequest.SetQueueUrl (queueUrl);
+  sendMessageBatchRequest.SetEntries (sendBatchEntries);
+  SendMessageBatchOutcome sendM = sqsClient->SendMessageBatch (sendMessageBatchRequest);
+  ASSERT_TRUE(sendM.IsSuccess ());
+  ASSERT_EQ(numberOfMessages, sendM.GetResult ().GetSuccessful ().size ());
+  EXPECT_EQ(0uL, sendM.GetResult ().GetFailed ().size ());
+
+  // receive messages
+  ReceiveMessageRequest receiveMessageRequest;
+  receiveMessageRequest.SetQueueUrl (queueUrl);
+  receiveMessageRequest.SetMaxNumberOfMessages (10);
+  Vector<Message> messages;
+  for (unsigned attempt = 0; attempt < 10 && messages.size () < numberOfMessages; attempt++)
+  {
+    auto receiveM = sqsClient->ReceiveMessage (receiveMessageRequest);
+    ASSERT_TRUE(receiveM.IsSuccess ());
+    for (auto& message : receiveM.GetResult ().GetMessages ())
+    {
+      messages.push_back (message);
+    }
+  }
+  ASSERT_EQ(numberOfMessages, messages.size ());
+
+  for (auto& message : messages)
+  {
+    unsigned i = message.GetBody ()[0] - '0';
+    ASSERT_TRUE(i < numberOfMessages);
+    EXPECT_EQ(sendBatchEntries[i].GetMessageBody (), message.GetBody ());
+
+    DeleteMessageOutcome deleteM = ExtendedQueueOperationTest::DeleteMessage (sqsClient, queueUrl,
+                                                                               message.GetReceiptHandle ());
+    ASSERT_TRUE(deleteM.IsSuccess ());
+  }
+
+  // delete queue
+  DeleteQueueOutcome deleteQ = DeleteQueue (sqsClient, queueUrl);
+  ASSERT_TRUE(deleteQ.IsSuccess ());
+
+  //delete bucket
+  DeleteBucketOutcome deleteB = DeleteBucket (s3Client, s3BucketName);
+  ASSERT_TRUE(deleteB.IsSuccess ());
+}
+
+TEST_F(ExtendedQueueOperationTest, TestVisibilityOfLargeMessages)
+{
+  // build a bucket, an extended sqs config, an extended sqs client and a queue
+  Aws::String s3BucketName = RandomizedS3BucketName(MESSAGEVISIBILITY_BUCKET);
+  CreateBucket (s3Client, s3BucketName);
+
+  auto sqsConfig = Aws::MakeShared<SQSExtendedClientConfiguration> (ALLOCATION_TAG);
+  sqsConfig->SetLargePayloadSupportEnabled (s3Client, s3BucketName);
+
+  std::shared_ptr<SQSClient> sqsClient = Aws::MakeShared<SQSExtendedClient> (ALLOCATION_TAG, sqsStdClient, sqsConfig);
+
+  Aws::String queueUrl = CreateQueue (sqsClient, MESSAGEVISIBILITY_QUEUENAME);
+
+  // send and receive a large message
+  Aws::String messageBody = ExtendedQueueOperationTest::GenerateMessageBody (QUEUE_SIZE_LIMIT + 1000);
+  SendMessageOutcome sendM = ExtendedQueueOperationTest::SendMessage (sqsClient, queueUrl, messageBody);
+  ASSERT_TRUE(sendM.IsSuccess ());
+
+  ReceiveMessageOutcome receiveM = ExtendedQueueOperationTest::ReceiveMessage (sqsClient, queueUrl);
+  ASSERT_TRUE(receiveM.IsSuccess ());
+  ASSERT_EQ(1uL, receiveM.GetResult ().GetMessages ().size ());
+  Aws::String receiptHandle = receiveM.GetResult ().GetMessages ()[0].GetReceiptHandle ();
+  ASSERT_TRUE(receiptHandle.find (S3_KEY_MARKER) != std::string::npos);
+
+  // the extended receipt handle is taken as is
+  ChangeMessageVisibilityRequest changeMessageVisibilityRequest;
+  changeMessageVisibilityRequest.SetQueueUrl (queueUrl);
+  changeMessageVisibilityRequest.SetReceiptHandle (receiptHandle);
+  changeMessageVisibilityRequest.SetVisibilityTimeout (60);
+  ChangeMessageVisibilityOutcome changeM = sqsClient->ChangeMessageVisibility (changeMessageVisibilityRequest);
+  ASSERT_TRUE(changeM.IsSuccess ());
+
+  // a nack makes it visible again at once
+  {
+    SQSVisibilityHeartbeat heartbeat (sqsClient);
+    heartbeat.Track (queueUrl, receiptHandle);
+    ChangeMessageVisibilityOutcome nackM = heartbeat.Nack (queueUrl, receiptHandle).get ();
+    ASSERT_TRUE(nackM.IsSuccess ());
+  }
+
+  receiveM = ExtendedQueueOperationTest::ReceiveMessage (sqsClient, queueUrl);
+  ASSERT_TRUE(receiveM.IsSuccess ());
+  ASSERT_EQ(1uL, receiveM.GetResult ().GetMessages ().size ());
+  EXPECT_EQ(messageBody, receiveM.GetResult ().GetMessages ()[0].GetBody ());
+
+  // delete message
+  DeleteMessageOutcome deleteM = ExtendedQueueOperationTest::DeleteMessage (sqsClient, queueUrl,
+                                                                             receiveM.GetResult ().GetMessages ()[0].GetReceiptHandle ());
+  ASSERT_TRUE(deleteM.IsSuccess ());
+
+  // delete queue
+  DeleteQueueOutcome deleteQ = DeleteQueue (sqsClient, queueUrl);
+  ASSERT_TRUE(deleteQ.IsSuccess ());
+
+  //delete bucket
+  DeleteBucketOutcome deleteB = DeleteBucket (s3Client, s3BucketName);
+  ASSERT_TRUE(deleteB.IsSuccess ());
+}
+
+TEST_F(ExtendedQueueOperationTest, TestLargeMessageWithCompactS3Pointer)
+{
+  // build a bucket, a sender writing compact pointers, a receiver with the default config and a queue
+  Aws::String s3BucketName = RandomizedS3BucketName(COMPACTS3POINTER_BUCKET);
+  CreateBucket (s3Client, s3BucketName);
+
+  auto senderConfig = Aws::MakeShared<SQSExtendedClientConfiguration> (ALLOCATION_TAG);
+  senderConfig->SetLargePayloadSupportEnabled (s3Client, s3BucketName);
+  senderConfig->SetCompactS3PointerEnabled ();
+  std::shared_ptr<SQSClient> senderClient = Aws::MakeShared<SQSExtendedClient> (ALLOCATION_TAG, sqsStdClient, senderConfig);
+
+  auto receiverConfig = Aws::MakeShared<SQSExtendedClientConfiguration> (ALLOCATION_TAG);
+  receiverConfig->SetLargePayloadSupportEnabled (s3Client, s3BucketName);
+  std::shared_ptr<SQSClient> receiverClient = Aws::MakeShared<SQSExtendedClient> (ALLOCATION_TAG, sqsStdClient, receiverConfig);
+
+  Aws::String queueUrl = CreateQueue (senderClient, COMPACTS3POINTER_QUEUENAME);
+
+  // send message
+  Aws::String messageBody = ExtendedQueueOperationTest::GenerateMessageBody (QUEUE_SIZE_LIMIT + 1000);
+  SendMessageOutcome sendM = ExtendedQueueOperationTest::SendMessage (senderClient, queueUrl, messageBody);
+  ASSERT_TRUE(sendM.IsSuccess ());
+
+  // receive message, the pointer is read whatever the config of the receiver
+  ReceiveMessageOutcome receiveM = ExtendedQueueOperationTest::ReceiveMessage (receiverClient, queueUrl);
+  ASSERT_TRUE(receiveM.IsSuccess ());
+  ASSERT_EQ(1uL, receiveM.GetResult ().GetMessages ().size ());
+  EXPECT_EQ(messageBody, receiveM.GetResult ().GetMessages ()[0].GetBody ());
+
+  // delete message
+  Aws::String receiptHandle = receiveM.GetResult ().GetMessages ()[0].GetReceiptHandle ();
+  ASSERT_TRUE(receiptHandle.find (S3_KEY_MARKER) != std::string::npos);
+  DeleteMessageOutcome deleteM = ExtendedQueueOperationTest::DeleteMessage (receiverClient, queueUrl, receiptHandle);
+  ASSERT_TRUE(deleteM.IsSuccess ());
+
+  // delete queue
+  DeleteQueueOutcome deleteQ = DeleteQueue (senderClient, queueUrl);
+  ASSERT_TRUE(deleteQ.IsSuccess ());
+
+  //delete bucket
+  DeleteBucketOutcome deleteB = DeleteBucket (s3Client, s3BucketName);
+  ASSERT_TRUE(deleteB.IsSuccess ());
+}
+
+TEST_F(ExtendedQueueOperationTest, TestLargeMessageWithReceiptHandleEnvelope)
+{
+  // build a bucket, an extended sqs config handing out envelopes, an extended sqs client and a queue
+  Aws::String s3BucketName = RandomizedS3BucketName(RECEIPTHANDLEENVELOPE_BUCKET);
+  CreateBucket (s3Client, s3BucketName);
+
+  auto sqsConfig = Aws::MakeShared<SQSExtendedClientConfiguration> (ALLOCATION_TAG);
+  sqsConfig->SetLargePayloadSupportEnabled (s3Client, s3BucketName);
+  sqsConfig->SetReceiptHandleEnvelopeEnabled ();
+
+  std::shared_ptr<SQSClient> sqsClient = Aws::MakeShared<SQSExtendedClient> (ALLOCATION_TAG, sqsStdClient, sqsConfig);
+
+  Aws::String queueUrl = CreateQueue (sqsClient, RECEIPTHANDLEENVELOPE_QUEUENAME);
+
+  // send message
+  Aws::String messageBody = ExtendedQueueOperationTest::GenerateMessageBody (QUEUE_SIZE_LIMIT + 1000);
+  SendMessageOutcome sendM = ExtendedQueueOperationTest::SendMessage (sqsClient, queueUrl, messageBody);
+  ASSERT_TRUE(sendM.IsSuccess ());
+
+  // receive message
+  ReceiveMessageOutcome receiveM = ExtendedQueueOperationTest::ReceiveMessage (sqsClient, queueUrl);
+  ASSERT_TRUE(receiveM.IsSuccess ());
+  ASSERT_EQ(1uL, receiveM.GetResult ().GetMessages ().size ());
+  EXPECT_EQ(messageBody, receiveM.GetResult ().GetMessages ()[0].GetBody ());
+
+  // the receipt handle is an envelope pointing at the payload
+  Aws::String receiptHandle = receiveM.GetResult ().GetMessages ()[0].GetReceiptHandle ();
+  ASSERT_EQ(0u, receiptHandle.find (SQSReceiptHandleView::ENVELOPE_TAG));
+  SQSReceiptHandleView receiptHandleView;
+  ASSERT_TRUE(receiptHandleView.Parse (receiptHandle));
+  EXPECT_EQ(s3BucketName, receiptHandleView.GetS3BucketName ().ToString ());
+  Aws::String s3KeyToTest = receiptHandleView.GetS3Key ().ToString ();
+
+  // the envelope is taken as is
+  ChangeMessageVisibilityRequest changeMessageVisibilityRequest;
+  changeMessageVisibilityRequest.SetQueueUrl (queueUrl);
+  changeMessageVisibilityRequest.SetReceiptHandle (receiptHandle);
+  changeMessageVisibilityRequest.SetVisibilityTimeout (60);
+  ChangeMessageVisibilityOutcome changeM = sqsClient->ChangeMessageVisibility (changeMessageVisibilityRequest);
+  ASSERT_TRUE(changeM.IsSuccess ());
+
+  // delete message
+  DeleteMessageOutcome deleteM = ExtendedQueueOperationTest::DeleteMessage (sqsClient, queueUrl, receiptHandle);
+  ASSERT_TRUE(deleteM.IsSuccess ());
+
+  // check if s3key was removed
+  HeadObjectRequest headObjectRequest;
+  headObjectRequest.SetBucket (s3BucketName);
+  headObjectRequest.SetKey (s3KeyToTest);
+  HeadObjectOutcome headObjectOutcome = s3Client->HeadObject (headObjectRequest);
+  ASSERT_FALSE(headObjectOutcome.IsSuccess ());
+
+  // delete queue
+  DeleteQueueOutcome deleteQ = DeleteQueue (sqsClient, queueUrl);
+  ASSERT_TRUE(deleteQ.IsSuccess ());
+
+  //delete bucket
+  DeleteBucketOutcome deleteB = DeleteBucket (s3Client, s3BucketName);
+  ASSERT_TRUE(deleteB.IsSuccess ());
+}
+
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/external/gtest.h>
+#include <aws/core/utils/json/JsonSerializer.h>
+#include <aws/sqs/extendedlib/SQSLargeMessageS3Pointer.h>
+#include <aws/sqs/extendedlib/SQSLargeMessageS3PointerView.h>
+#include <chrono>
+#include <iostream>
+
+using namespace Aws;
+using namespace Aws::Utils::Json;
+using namespace Aws::SQS::ExtendedLib;
+
+namespace
+{
+  SQSLargeMessageS3Pointer BuildS3Pointer (const char* s3BucketName, const char* s3Key)
+  {
+    SQSLargeMessageS3Pointer s3Pointer;
+    s3Pointer.SetS3BucketName (s3BucketName);
+    s3Pointer.SetS3Key (s3Key);
+    return s3Pointer;
+  }
+
+  bool IsWithin (const SQSStringView& view, const Aws::String& body)
+  {
+    return view.GetData () >= body.data () && view.GetData () + view.GetSize () <= body.data () + body.size ();
+  }
+}
+
+TEST(SQSLargeMessageS3PointerTest, TestCompactFormRoundTrip)
+{
+  SQSLargeMessageS3Pointer s3Pointer = BuildS3Pointer ("bucket", "SQSLargePayloadBatch-6f1c");
+  s3Pointer.SetCodec ("deflate");
+  s3Pointer.SetS3Offset (1024);
+  s3Pointer.SetS3Length (262145);
+
+  Aws::String body = s3Pointer.Serialize ();
+  EXPECT_EQ("SQSS3P/1 6:bucket 25:SQSLargePayloadBatch-6f1c 7:deflate 1024 262145", body);
+
+  SQSLargeMessageS3PointerView s3PointerView;
+  ASSERT_TRUE(s3PointerView.Parse (body));
+  EXPECT_TRUE(s3PointerView.GetS3BucketName () == "bucket");
+  EXPECT_TRUE(s3PointerView.GetS3Key () == "SQSLargePayloadBatch-6f1c");
+  EXPECT_TRUE(s3PointerView.GetCodec () == "deflate");
+  EXPECT_EQ(1024, s3PointerView.GetS3Offset ());
+  EXPECT_EQ(262145, s3PointerView.GetS3Length ());
+
+  // the fields are read in place
+  EXPECT_TRUE(IsWithin (s3PointerView.GetS3BucketName (), body));
+  EXPECT_TRUE(IsWithin (s3PointerView.GetS3Key (), body));
+
+  SQSLargeMessageS3Pointer parsed = s3PointerView.ToS3Pointer ();
+  EXPECT_EQ("bucket", parsed.GetS3BucketName ());
+  EXPECT_EQ("SQSLargePayloadBatch-6f1c", parsed.GetS3Key ());
+  EXPECT_EQ("deflate", parsed.GetCodec ());
+  EXPECT_EQ(1024, parsed.GetS3Offset ());
+  EXPECT_TRUE(parsed.S3LengthHasBeenSet ());
+  EXPECT_EQ(262145, parsed.GetS3Length ());
+}
+
+TEST(SQSLargeMessageS3PointerTest, TestCompactFormTakesAnyKey)
+{
+  // separators and the tag itself inside a key do not confuse the length prefixed fields
+  SQSLargeMessageS3Pointer s3Pointer = BuildS3Pointer ("bucket", "a key: SQSS3P/1 6:other - -\n\"{}\"");
+
+  Aws::String body = s3Pointer.Serialize ();
+  SQSLargeMessageS3PointerView s3PointerView;
+  ASSERT_TRUE(s3PointerView.Parse (body));
+  EXPECT_EQ("a key: SQSS3P/1 6:other - -\n\"{}\"", s3PointerView.GetS3Key ().ToString ());
+  EXPECT_TRUE(s3PointerView.GetCodec ().IsEmpty ());
+  EXPECT_FALSE(s3PointerView.S3OffsetHasBeenSet ());
+  EXPECT_FALSE(s3PointerView.S3LengthHasBeenSet ());
+  EXPECT_FALSE(s3PointerView.ToS3Pointer ().S3LengthHasBeenSet ());
+}
+
+TEST(SQSLargeMessageS3PointerTest, TestReadsTheJsonForm)
+{
+  // as written by JsonValue::WriteReadable and JsonValue::WriteCompact
+  Aws::String readable = "{\n\t\"S3BucketName\":\t\"bucket\",\n\t\"S3Key\":\t\"8e9f-42\",\n\t\"S3Offset\":\t0,\n"
+                         "\t\"S3Length\":\t42\n}";
+  Aws::String compact = "{\"S3BucketName\":\"bucket\",\"S3Key\":\"8e9f-42\",\"S3Offset\":0,\"S3Length\":42}";
+
+  for (auto& body : { readable, compact })
+  {
+    SQSLargeMessageS3PointerView s3PointerView;
+    ASSERT_TRUE(s3PointerView.Parse (body));
+    EXPECT_TRUE(s3PointerView.GetS3BucketName () == "bucket");
+    EXPECT_TRUE(s3PointerView.GetS3Key () == "8e9f-42");
+    EXPECT_TRUE(s3PointerView.S3OffsetHasBeenSet ());
+    EXPECT_EQ(42, s3PointerView.GetS3Length ());
+  }
+
+  // fields written by other releases are skipped
+  SQSLargeMessageS3PointerView s3PointerView;
+  ASSERT_TRUE(s3PointerView.Parse ("{ \"Version\": 2, \"S3Key\": \"key\", \"Tagged\": true, \"S3BucketName\": \"bucket\" }"));
+  EXPECT_TRUE(s3PointerView.GetS3Key () == "key");
+  EXPECT_FALSE(s3PointerView.S3LengthHasBeenSet ());
+}
+
+TEST(SQSLargeMessageS3PointerTest, TestRefusesWhatItCannotReadInPlace)
+{
+  const char* bodies[] = {
+    "",
+    "SQSS3P/1",
+    "SQSS3P/1 6:bucket 3:key 0: - ",
+    "SQSS3P/1 6:bucket 30:key 0: - -",
+    "SQSS3P/1 6:bucket 3:key 0: 99999999999999999999 -",
+    "SQSS3P/1 6:bucket 3:key 0: - - trailing",
+    "SQSS3P/2 6:bucket 3:key 0: - -",
+    "{\"S3BucketName\":\"bucket\",\"S3Key\":\"a\\/b\"}",
+    "{\"S3BucketName\":\"bucket\",\"S3Key\":\"key\",\"Nested\":{}}",
+    "{\"S3BucketName\":\"bucket\",\"S3Key\":\"key\",}",
+    "{\"S3BucketName\":\"bucket\" \"S3Key\":\"key\"}",
+    "{\"S3BucketName\":\"bucket\"",
+    "plain message body"
+  };
+  for (const char* body : bodies)
+  {
+    SQSLargeMessageS3PointerView s3PointerView;
+    EXPECT_FALSE(s3PointerView.Parse (body)) << body;
+    EXPECT_TRUE(s3PointerView.GetS3Key ().IsEmpty ()) << body;
+  }
+}
+
+TEST(SQSLargeMessageS3PointerTest, TestEncodingCost)
+{
+  const unsigned iterations = 100000;
+  SQSLargeMessageS3Pointer s3Pointer = BuildS3Pointer ("sqs-extended-lib-test-bucket", "2f6a4d0e-8c51-4b3e-9b7d-0c1e5f3a9d42");
+  Aws::String jsonBody = s3Pointer.Jsonize ().WriteReadable ();
+  Aws::String compactBody = s3Pointer.Serialize ();
+  size_t checksum = 0;
+
+  auto start = std::chrono::steady_clock::now ();
+  for (unsigned i = 0; i < iterations; ++i)
+  {
+    checksum += s3Pointer.Jsonize ().WriteReadable ().size ();
+  }
+  auto jsonEncode = std::chrono::steady_clock::now () - start;
+
+  start = std::chrono::steady_clock::now ();
+  for (unsigned i = 0; i < iterations; ++i)
+  {
+    SQSLargeMessageS3Pointer parsed = JsonValue (jsonBody);
+    checksum += parsed.GetS3Key ().size ();
+  }
+  auto jsonDecode = std::chrono::steady_clock::now () - start;
+
+  start = std::chrono::steady_clock::now ();
+  for (unsigned i = 0; i < iterations; ++i)
+  {
+    checksum += s3Pointer.Serialize ().size ();
+  }
+  auto compactEncode = std::chrono::steady_clock::now () - start;
+
+  start = std::chrono::steady_clock::now ();
+  for (unsigned i = 0; i < iterations; ++i)
+  {
+    SQSLargeMessageS3PointerView s3PointerView;
+    s3PointerView.Parse (compactBody);
+    checksum += s3PointerView.GetS3Key ().GetSize ();
+  }
+  auto compactDecode = std::chrono::steady_clock::now () - start;
+
+  start = std::chrono::steady_clock::now ();
+  for (unsigned i = 0; i < iterations; ++i)
+  {
+    SQSLargeMessageS3PointerView s3PointerView;
+    s3PointerView.Parse (jsonBody);
+    checksum += s3PointerView.GetS3Key ().GetSize ();
+  }
+  auto viewJsonDecode = std::chrono::steady_clock::now () - start;
+
+  auto perMessage = [iterations] (std::chrono::steady_clock::duration elapsed)
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds> (elapsed).count () / iterations;
+  };
+  std::cout << "s3 pointer, ns per message:" << std::endl
+            << "  json encode " << perMessage (jsonEncode) << ", decode " << perMessage (jsonDecode) << std::endl
+            << "  compact encode " << perMessage (compactEncode) << ", decode " << perMessage (compactDecode) << std::endl
+            << "  json decoded in place " << perMessage (viewJsonDecode) << std::endl;
+  EXPECT_GT(checksum, 0u);
+}
@@ -0,0 +1,227 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <aws/external/gtest.h>
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/sqs/extendedlib/SQSLazyPayload.h>
+
+using namespace Aws;
+using namespace Aws::SQS::ExtendedLib;
+
+static const char* ALLOCATION_TAG = "SQSLazyPayloadTest";
+
+namespace
+{
+  // serves ranges of a payload kept in memory, as s3 would, and counts the gets
+  class PayloadLoader
+  {
+
+  public:
+    Aws::String storedObject;
+    unsigned gets;
+
+    PayloadLoader (const Aws::String& object) :
+        storedObject (object), gets (0)
+    {
+    }
+
+    SQSLazyPayload::Loader Bind ()
+    {
+      return [this] (const SQSLargeMessageS3Pointer& s3Pointer, Aws::String& payload)
+      {
+        ++gets;
+        if (!s3Pointer.S3LengthHasBeenSet ())
+        {
+          payload.append (storedObject);
+        }
+        else
+        {
+          payload.append (storedObject, s3Pointer.GetS3Offset (), s3Pointer.GetS3Length ());
+        }
+        return true;
+      };
+    }
+
+    SQSLazyPayload::StreamLoader BindStream ()
+    {
+      return [this] (const SQSLargeMessageS3Pointer& s3Pointer, const Aws::IOStreamFactory& streamFactory)
+      {
+        ++gets;
+        Aws::IOStream* destination = streamFactory ();
+        *destination << storedObject;
+        Aws::Delete (destination);
+        return true;
+      };
+    }
+
+  };
+
+  // stands for a file sink, whatever is written outlives the stream
+  class SinkBuf : public std::streambuf
+  {
+
+  private:
+    Aws::String& m_sink;
+
+  protected:
+    virtual std::streamsize xsputn (const char* s, std::streamsize n)
+    {
+      m_sink.append (s, static_cast<size_t> (n));
+      return n;
+    }
+
+    virtual int_type overflow (int_type c)
+    {
+      if (c != traits_type::eof ())
+      {
+        m_sink += traits_type::to_char_type (c);
+      }
+      return c;
+    }
+
+  public:
+    SinkBuf (Aws::String& sink) :
+        m_sink (sink)
+    {
+    }
+
+  };
+
+  class SinkStream : public Aws::IOStream
+  {
+
+  private:
+    SinkBuf m_sinkBuf;
+
+  public:
+    SinkStream (Aws::String& sink) :
+        Aws::IOStream (nullptr), m_sinkBuf (sink)
+    {
+      rdbuf (&m_sinkBuf);
+    }
+
+  };
+
+  SQSLargeMessageS3Pointer BuildS3Pointer ()
+  {
+    SQSLargeMessageS3Pointer s3Pointer;
+    s3Pointer.SetS3BucketName ("bucket");
+    s3Pointer.SetS3Key ("key");
+    return s3Pointer;
+  }
+} // anonymous namespace
+
+TEST(SQSLazyPayloadTest, TestNothingIsFetchedUntilRead)
+{
+  PayloadLoader loader ("0123456789");
+  SQSLazyPayload payload (BuildS3Pointer (), 10, loader.Bind ());
+
+  EXPECT_TRUE(payload.IsOffloaded ());
+  EXPECT_EQ(10, payload.GetSize ());
+  EXPECT_FALSE(payload.IsLoaded ());
+  EXPECT_EQ(0u, loader.gets);
+
+  EXPECT_EQ("0123456789", payload.GetBody ());
+  EXPECT_EQ("0123456789", payload.GetBody ());
+  EXPECT_EQ(1u, loader.gets);
+}
+
+TEST(SQSLazyPayloadTest, TestRawPayloadIsReadByRange)
+{
+  PayloadLoader loader ("0123456789");
+  SQSLazyPayload payload (BuildS3Pointer (), 10, loader.Bind ());
+
+  Aws::String head;
+  ASSERT_TRUE(payload.Read (2, 3, head));
+  EXPECT_EQ("234", head);
+
+  Aws::String tail;
+  ASSERT_TRUE(payload.Read (8, 100, tail));
+  EXPECT_EQ("89", tail);
+  EXPECT_FALSE(payload.IsLoaded ());
+  EXPECT_EQ(2u, loader.gets);
+
+  Aws::String outside;
+  EXPECT_FALSE(payload.Read (11, 1, outside));
+}
+
+TEST(SQSLazyPayloadTest, TestPackedPayloadIsReadWithinItsRange)
+{
+  PayloadLoader loader ("aaaa0123456789bbbb");
+  SQSLargeMessageS3Pointer s3Pointer = BuildS3Pointer ();
+  s3Pointer.SetS3Offset (4);
+  s3Pointer.SetS3Length (10);
+  SQSLazyPayload payload (s3Pointer, 10, loader.Bind ());
+
+  Aws::String range;
+  ASSERT_TRUE(payload.Read (5, 10, range));
+  EXPECT_EQ("56789", range);
+  EXPECT_EQ("0123456789", payload.GetBody ());
+}
+
+TEST(SQSLazyPayloadTest, TestEncodedPayloadIsLoadedOnce)
+{
+  PayloadLoader loader ("0123456789");
+  SQSLargeMessageS3Pointer s3Pointer = BuildS3Pointer ();
+  s3Pointer.SetCodec ("identity");
+  SQSLazyPayload payload (s3Pointer, 10, loader.Bind ());
+
+  Aws::String first;
+  Aws::String second;
+  ASSERT_TRUE(payload.Read (0, 4, first));
+  ASSERT_TRUE(payload.Read (4, 4, second));
+  EXPECT_EQ("0123", first);
+  EXPECT_EQ("4567", second);
+  EXPECT_TRUE(payload.IsLoaded ());
+  EXPECT_EQ(1u, loader.gets);
+}
+
+TEST(SQSLazyPayloadTest, TestInlinePayloadIsAtHand)
+{
+  SQSLazyPayload payload ("small body");
+
+  EXPECT_FALSE(payload.IsOffloaded ());
+  EXPECT_TRUE(payload.IsLoaded ());
+  EXPECT_EQ("small body", payload.GetBody ());
+}
+
+TEST(SQSLazyPayloadTest, TestDownloadStreamsWithoutLoading)
+{
+  PayloadLoader loader ("0123456789");
+  SQSLazyPayload payload (BuildS3Pointer (), 10, loader.Bind (), loader.BindStream ());
+
+  Aws::String sink;
+  ASSERT_TRUE(payload.Download ([&sink] ()
+  {
+    return Aws::New<SinkStream> (ALLOCATION_TAG, sink);
+  }));
+  EXPECT_EQ("0123456789", sink);
+  EXPECT_FALSE(payload.IsLoaded ());
+}
+
+TEST(SQSLazyPayloadTest, TestDownloadWritesLoadedPayload)
+{
+  PayloadLoader loader ("0123456789");
+  SQSLazyPayload payload (BuildS3Pointer (), 10, loader.Bind ());
+
+  Aws::String sink;
+  ASSERT_TRUE(payload.Download ([&sink] ()
+  {
+    return Aws::New<SinkStream> (ALLOCATION_TAG, sink);
+  }));
+  EXPECT_EQ("0123456789", sink);
+  EXPECT_EQ(1u, loader.gets);
+}
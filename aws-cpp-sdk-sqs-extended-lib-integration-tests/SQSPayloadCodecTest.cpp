@@ -0,0 +1,142 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <aws/external/gtest.h>
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/core/utils/memory/stl/AWSStringStream.h>
+#include <aws/sqs/extendedlib/SQSDeflateCodec.h>
+#include <aws/sqs/extendedlib/SQSExtendedClientConfiguration.h>
+
+using namespace Aws;
+using namespace Aws::SQS::ExtendedLib;
+
+namespace
+{
+  Aws::String GenerateJsonPayload (const unsigned records)
+  {
+    Aws::String payload = "[";
+    for (unsigned i = 0; i < records; ++i)
+    {
+      payload += "{\"id\":";
+      payload += std::to_string (i).c_str ();
+      payload += ",\"status\":\"delivered\",\"region\":\"us-east-1\"},";
+    }
+    payload += "{}]";
+    return payload;
+  }
+} // anonymous namespace
+
+TEST(SQSPayloadCodecTest, TestDeflateRoundTrip)
+{
+  Aws::String payload = GenerateJsonPayload (20000);
+
+  SQSDeflateCodec codec;
+  Aws::String encoded;
+  ASSERT_TRUE(codec.Encode (payload.c_str (), payload.size (), encoded));
+  EXPECT_LT(encoded.size () * 5, payload.size ());
+
+  Aws::StringStream encodedStream (encoded);
+  Aws::String decoded;
+  decoded.reserve (payload.size ());
+  ASSERT_TRUE(codec.Decode (encodedStream, decoded));
+  EXPECT_TRUE(payload == decoded);
+}
+
+TEST(SQSPayloadCodecTest, TestDeflateDecodesIntoStream)
+{
+  Aws::String payload = GenerateJsonPayload (20000);
+
+  SQSDeflateCodec codec;
+  Aws::String encoded;
+  ASSERT_TRUE(codec.Encode (payload.c_str (), payload.size (), encoded));
+
+  Aws::StringStream encodedStream (encoded);
+  Aws::StringStream decodedStream;
+  ASSERT_TRUE(codec.Decode (encodedStream, static_cast<Aws::OStream&> (decodedStream)));
+  EXPECT_TRUE(payload == decodedStream.str ());
+}
+
+TEST(SQSPayloadCodecTest, TestDeflateGrowsItsOutputWithTheEncoding)
+{
+  Aws::String payload = GenerateJsonPayload (200000);
+
+  SQSDeflateCodec codec;
+  Aws::String encoded;
+  ASSERT_TRUE(codec.Encode (payload.c_str (), payload.size (), encoded));
+
+  // the output spans several chunks, and its buffer follows the encoded size rather than the payload size
+  EXPECT_GT(encoded.size (), 64u * 1024u);
+  EXPECT_LT(encoded.capacity (), payload.size () / 4);
+
+  Aws::StringStream encodedStream (encoded);
+  Aws::String decoded;
+  ASSERT_TRUE(codec.Decode (encodedStream, decoded));
+  EXPECT_TRUE(payload == decoded);
+}
+
+TEST(SQSPayloadCodecTest, TestDeflateGivesUpPastTheGivenLength)
+{
+  Aws::String payload = GenerateJsonPayload (200000);
+
+  SQSDeflateCodec codec;
+  Aws::String encoded;
+  ASSERT_TRUE(codec.Encode (payload.c_str (), payload.size (), encoded));
+
+  // the output is never allowed past the limit, whatever the payload would need
+  Aws::String encodedWithin;
+  EXPECT_FALSE(codec.EncodeWithin (payload.c_str (), payload.size (), encoded.size () / 2, encodedWithin));
+  EXPECT_TRUE(encodedWithin.empty ());
+  EXPECT_LE(encodedWithin.capacity (), encoded.size ());
+
+  ASSERT_TRUE(codec.EncodeWithin (payload.c_str (), payload.size (), encoded.size (), encodedWithin));
+  EXPECT_TRUE(encoded == encodedWithin);
+}
+
+TEST(SQSPayloadCodecTest, TestDeflateKeepsIncompressiblePayloadRaw)
+{
+  Aws::String payload (4096, '\0');
+  unsigned seed = 12345;
+  for (auto& c : payload)
+  {
+    seed = seed * 1103515245 + 12345;
+    c = static_cast<char> (seed >> 16);
+  }
+
+  SQSDeflateCodec codec (1);
+  Aws::String encoded;
+  EXPECT_FALSE(codec.Encode (payload.c_str (), payload.size (), encoded));
+}
+
+TEST(SQSPayloadCodecTest, TestDeflateRejectsTruncatedPayload)
+{
+  Aws::String payload = GenerateJsonPayload (1000);
+
+  SQSDeflateCodec codec;
+  Aws::String encoded;
+  ASSERT_TRUE(codec.Encode (payload.c_str (), payload.size (), encoded));
+
+  Aws::StringStream truncatedStream (encoded.substr (0, encoded.size () / 2));
+  Aws::String decoded;
+  EXPECT_FALSE(codec.Decode (truncatedStream, decoded));
+}
+
+TEST(SQSPayloadCodecTest, TestDeflateIsKnownByDefault)
+{
+  SQSExtendedClientConfiguration sqsConfig;
+  EXPECT_TRUE(sqsConfig.GetPayloadCodec () == nullptr);
+  ASSERT_TRUE(sqsConfig.GetPayloadCodec (SQSDeflateCodec::NAME) != nullptr);
+  EXPECT_STREQ(SQSDeflateCodec::NAME, sqsConfig.GetPayloadCodec (SQSDeflateCodec::NAME)->GetName ());
+  EXPECT_TRUE(sqsConfig.GetPayloadCodec ("unknown") == nullptr);
+}
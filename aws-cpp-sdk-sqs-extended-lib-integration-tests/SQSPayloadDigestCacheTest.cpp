@@ -0,0 +1,57 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/external/gtest.h>
+#include <aws/sqs/extendedlib/SQSPayloadDigestCache.h>
+
+using namespace Aws;
+using namespace Aws::SQS::ExtendedLib;
+
+TEST(SQSPayloadDigestCacheTest, TestDropsTheLeastRecentlySeenEntry)
+{
+  SQSPayloadDigestCache cache (2, std::chrono::seconds (60));
+
+  cache.Add ("a");
+  cache.Add ("b");
+  // seeing a again makes b the oldest
+  EXPECT_TRUE(cache.Contains ("a"));
+  cache.Add ("c");
+
+  EXPECT_FALSE(cache.Contains ("b"));
+  EXPECT_TRUE(cache.Contains ("a"));
+  EXPECT_TRUE(cache.Contains ("c"));
+}
+
+TEST(SQSPayloadDigestCacheTest, TestForgetsObjectsPastMaxAge)
+{
+  SQSPayloadDigestCache cache (10, std::chrono::seconds (60));
+
+  // objects found in s3 are as old as s3 says, not as old as their cache entry
+  cache.Add ("young", std::chrono::milliseconds (1000));
+  cache.Add ("old", std::chrono::milliseconds (61000));
+  EXPECT_TRUE(cache.Contains ("young"));
+  EXPECT_FALSE(cache.Contains ("old"));
+
+  // uploading an object again makes it new
+  cache.Add ("old");
+  EXPECT_TRUE(cache.Contains ("old"));
+}
+
+TEST(SQSPayloadDigestCacheTest, TestZeroCapacityKeepsNothing)
+{
+  SQSPayloadDigestCache cache (0, std::chrono::seconds (60));
+
+  cache.Add ("a");
+  EXPECT_FALSE(cache.Contains ("a"));
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <aws/external/gtest.h>
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/testing/MemoryTesting.h>
+#include <aws/sqs/extendedlib/SQSPayloadStream.h>
+
+using namespace Aws;
+using namespace Aws::SQS::ExtendedLib;
+
+static const char* ALLOCATION_TAG = "SQSPayloadStreamTest";
+
+static const size_t PAYLOAD_SIZE = 4 * 1024 * 1024;
+
+namespace
+{
+  // Reads the whole stream in small chunks, the way the http client drains a request body
+  size_t DrainStream (Aws::IOStream& stream, Aws::String& readBack)
+  {
+    char chunk[4096];
+    size_t total = 0;
+    while (stream.read (chunk, sizeof (chunk)) || stream.gcount () > 0)
+    {
+      readBack.append (chunk, static_cast<size_t> (stream.gcount ()));
+      total += static_cast<size_t> (stream.gcount ());
+    }
+    return total;
+  }
+} // anonymous namespace
+
+TEST(SQSPayloadStreamTest, TestStreamExposesCallerBufferInPlace)
+{
+  Aws::String payload (PAYLOAD_SIZE, 'x');
+  payload[0] = 'a';
+  payload[PAYLOAD_SIZE - 1] = 'z';
+
+  SQSPayloadStream stream (payload.c_str (), payload.size ());
+
+  // the whole payload is available at once, there is no intermediate buffer to refill
+  ASSERT_EQ(static_cast<std::streamsize> (PAYLOAD_SIZE), stream.rdbuf ()->in_avail ());
+
+  stream.seekg (0, std::ios_base::end);
+  ASSERT_EQ(static_cast<std::streamoff> (PAYLOAD_SIZE), static_cast<std::streamoff> (stream.tellg ()));
+
+  // a retried request rewinds the body and reads it again
+  stream.seekg (0, std::ios_base::beg);
+  Aws::String readBack;
+  ASSERT_EQ(PAYLOAD_SIZE, DrainStream (stream, readBack));
+  EXPECT_TRUE(payload == readBack);
+
+  stream.clear ();
+  stream.seekg (PAYLOAD_SIZE - 1);
+  EXPECT_EQ('z', stream.get ());
+}
+
+TEST(SQSPayloadStreamTest, TestStreamRejectsOutOfRangeSeeks)
+{
+  Aws::String payload ("payload");
+  SQSPayloadStream stream (payload.c_str (), payload.size ());
+
+  stream.seekg (static_cast<std::streamoff> (payload.size () + 1));
+  EXPECT_TRUE(stream.fail ());
+
+  stream.clear ();
+  stream.seekg (-1, std::ios_base::beg);
+  EXPECT_TRUE(stream.fail ());
+}
+
+TEST(SQSPayloadStreamTest, TestRegionStreamWritesInPlace)
+{
+  Aws::String payload (10, '.');
+
+  SQSPayloadRegionStream first (&payload[0], 4);
+  first << "0123";
+  EXPECT_TRUE(first.good ());
+  EXPECT_EQ(4, first.tellp ());
+
+  SQSPayloadRegionStream second (&payload[4], 6);
+  second.write ("456789", 6);
+  EXPECT_TRUE(second.good ());
+  EXPECT_EQ("0123456789", payload);
+}
+
+TEST(SQSPayloadStreamTest, TestRegionStreamFailsPastItsEnd)
+{
+  Aws::String payload (8, '.');
+
+  SQSPayloadRegionStream region (&payload[2], 4);
+  region.write ("abcdef", 6);
+  EXPECT_FALSE(region.good ());
+  EXPECT_EQ("..abcd..", payload);
+}
+
+#ifdef USE_AWS_MEMORY_MANAGEMENT
+
+TEST(SQSPayloadStreamTest, TestStreamingPayloadAllocatesNoPayloadCopy)
+{
+  Aws::String payload (PAYLOAD_SIZE, 'x');
+  size_t bytesRead = 0;
+
+  BaseTestMemorySystem memorySystem;
+  Aws::Utils::Memory::InitializeAWSMemorySystem (memorySystem);
+  {
+    // this is what StorePayloadInS3 hands to PutObject
+    std::shared_ptr<Aws::IOStream> body = Aws::MakeShared<SQSPayloadStream> (ALLOCATION_TAG, payload.c_str (),
+                                                                             payload.size ());
+    char chunk[4096];
+    while (body->read (chunk, sizeof (chunk)) || body->gcount () > 0)
+    {
+      bytesRead += static_cast<size_t> (body->gcount ());
+    }
+  }
+  Aws::Utils::Memory::ShutdownAWSMemorySystem ();
+
+  ASSERT_EQ(PAYLOAD_SIZE, bytesRead);
+  // the only copy of the payload is the caller's own, the stream allocates a small fixed amount
+  EXPECT_LT(memorySystem.GetTotalBytesAllocated (), 4096ULL);
+  EXPECT_EQ(0ULL, memorySystem.GetCurrentBytesAllocated ());
+}
+
+#endif // USE_AWS_MEMORY_MANAGEMENT
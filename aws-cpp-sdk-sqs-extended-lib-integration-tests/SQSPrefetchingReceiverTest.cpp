@@ -0,0 +1,178 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <aws/external/gtest.h>
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <aws/sqs/SQSClient.h>
+#include <aws/sqs/model/ReceiveMessageRequest.h>
+#include <aws/sqs/extendedlib/SQSExtendedClient.h>
+#include <aws/sqs/extendedlib/SQSPrefetchingReceiver.h>
+#include "SQSTestClients.h"
+#include <atomic>
+
+using namespace Aws;
+using namespace Aws::SQS;
+using namespace Aws::SQS::Model;
+using namespace Aws::SQS::ExtendedLib;
+
+static const char* ALLOCATION_TAG = "SQSPrefetchingReceiverTest";
+
+namespace
+{
+  // hands out numbered messages, as many as asked for, until the queue runs dry. Receives take receiveDelay
+  class NumberedQueueClient : public SQSClient
+  {
+
+  public:
+    unsigned queueLength;
+    mutable std::atomic<unsigned> sentMessages;
+    mutable std::atomic<unsigned> receiveCalls;
+    std::chrono::milliseconds receiveDelay;
+
+    NumberedQueueClient (unsigned length) :
+        queueLength (length), sentMessages (0), receiveCalls (0), receiveDelay (0)
+    {
+    }
+
+    virtual ReceiveMessageOutcome ReceiveMessage (const ReceiveMessageRequest& request) const
+    {
+      ++receiveCalls;
+      std::this_thread::sleep_for (receiveDelay);
+
+      ReceiveMessageResult result;
+      for (int i = 0; i < request.GetMaxNumberOfMessages (); ++i)
+      {
+        unsigned number = sentMessages++;
+        if (number >= queueLength)
+        {
+          sentMessages = queueLength;
+          break;
+        }
+
+        Message message;
+        message.SetBody (std::to_string (number).c_str ());
+        result.AddMessages (message);
+      }
+
+      if (result.GetMessages ().empty ())
+      {
+        // an empty queue holds a long poll open
+        std::this_thread::sleep_for (std::chrono::milliseconds (20));
+      }
+      return ReceiveMessageOutcome (result);
+    }
+
+  };
+
+  ReceiveMessageRequest BuildReceiveMessageRequest ()
+  {
+    ReceiveMessageRequest request;
+    request.SetQueueUrl ("queue");
+    request.SetMaxNumberOfMessages (10);
+    return request;
+  }
+} // anonymous namespace
+
+TEST(SQSPrefetchingReceiverTest, TestMessagesComeInOrder)
+{
+  auto sqsClient = Aws::MakeShared<NumberedQueueClient> (ALLOCATION_TAG, 35);
+  SQSPrefetchingReceiver receiver (sqsClient, BuildReceiveMessageRequest ());
+
+  Message message;
+  for (unsigned i = 0; i < 35; ++i)
+  {
+    ASSERT_TRUE(receiver.Next (message, std::chrono::milliseconds (1000)));
+    EXPECT_EQ(std::to_string (i).c_str (), message.GetBody ());
+  }
+  EXPECT_FALSE(receiver.Next (message, std::chrono::milliseconds (50)));
+}
+
+TEST(SQSPrefetchingReceiverTest, TestBufferStaysBounded)
+{
+  auto sqsClient = Aws::MakeShared<NumberedQueueClient> (ALLOCATION_TAG, 1000);
+  SQSPrefetchingReceiver receiver (sqsClient, BuildReceiveMessageRequest (), 25);
+
+  std::this_thread::sleep_for (std::chrono::milliseconds (100));
+  EXPECT_EQ(20u, receiver.GetBufferedMessages ());
+  EXPECT_EQ(2u, sqsClient->receiveCalls.load ());
+
+  Message message;
+  ASSERT_TRUE(receiver.Next (message, std::chrono::milliseconds (1000)));
+  ASSERT_TRUE(receiver.Next (message, std::chrono::milliseconds (1000)));
+  ASSERT_TRUE(receiver.Next (message, std::chrono::milliseconds (1000)));
+  ASSERT_TRUE(receiver.Next (message, std::chrono::milliseconds (1000)));
+  ASSERT_TRUE(receiver.Next (message, std::chrono::milliseconds (1000)));
+  std::this_thread::sleep_for (std::chrono::milliseconds (100));
+  EXPECT_EQ(25u, receiver.GetBufferedMessages ());
+}
+
+TEST(SQSPrefetchingReceiverTest, TestMessagesCloseToVisibilityTimeoutAreDropped)
+{
+  auto sqsClient = Aws::MakeShared<NumberedQueueClient> (ALLOCATION_TAG, 10);
+  ReceiveMessageRequest request = BuildReceiveMessageRequest ();
+  request.SetVisibilityTimeout (2);
+  SQSPrefetchingReceiver receiver (sqsClient, request, 100, 1024 * 1024, 1, 30, 1);
+
+  std::this_thread::sleep_for (std::chrono::milliseconds (1100));
+  Message message;
+  EXPECT_FALSE(receiver.Next (message, std::chrono::milliseconds (50)));
+  EXPECT_EQ(10u, receiver.GetDroppedMessages ());
+}
+
+TEST(SQSPrefetchingReceiverTest, TestPollersShareTheMessageLimit)
+{
+  auto sqsClient = Aws::MakeShared<NumberedQueueClient> (ALLOCATION_TAG, 1000);
+  sqsClient->receiveDelay = std::chrono::milliseconds (50);
+  SQSPrefetchingReceiver receiver (sqsClient, BuildReceiveMessageRequest (), 20, 1024 * 1024, 4);
+
+  // the pollers all start with an empty buffer, only two receives fit in it
+  std::this_thread::sleep_for (std::chrono::milliseconds (300));
+  EXPECT_EQ(20u, receiver.GetBufferedMessages ());
+  EXPECT_EQ(2u, sqsClient->receiveCalls.load ());
+}
+
+TEST(SQSPrefetchingReceiverTest, TestLazyPayloadsAreFetchedOnceTheyFit)
+{
+  const size_t payloadSize = 300 * 1024;
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  auto sqsConfig = Aws::MakeShared<SQSExtendedClientConfiguration> (ALLOCATION_TAG);
+  sqsConfig->SetLargePayloadSupportEnabled (s3Client, "bucket");
+  sqsConfig->SetLazyPayloadLoadingEnabled ();
+  auto sqsClient = Aws::MakeShared<SQSExtendedClient> (ALLOCATION_TAG, Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG),
+                                                       sqsConfig);
+  for (unsigned i = 0; i < 10; ++i)
+  {
+    SendMessageRequest request;
+    request.SetQueueUrl ("queue");
+    request.SetMessageBody (Aws::String (payloadSize, static_cast<char> ('a' + i)));
+    ASSERT_TRUE(sqsClient->SendMessage (request).IsSuccess ());
+  }
+
+  ReceiveMessageRequest request = BuildReceiveMessageRequest ();
+  request.SetMaxNumberOfMessages (1);
+  SQSPrefetchingReceiver receiver (sqsClient, request, 100, 1024 * 1024);
+
+  // a fourth payload is received but left in s3, it would not fit
+  std::this_thread::sleep_for (std::chrono::milliseconds (200));
+  EXPECT_EQ(3u, receiver.GetBufferedMessages ());
+  EXPECT_EQ(3u, s3Client->getObjectCalls);
+
+  Message message;
+  for (unsigned i = 0; i < 10; ++i)
+  {
+    ASSERT_TRUE(receiver.Next (message, std::chrono::milliseconds (1000)));
+    EXPECT_TRUE(message.GetBody () == Aws::String (payloadSize, static_cast<char> ('a' + i))) << i;
+  }
+}
@@ -0,0 +1,230 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/external/gtest.h>
+#include <aws/sqs/extendedlib/SQSReceiptHandleView.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+using namespace Aws;
+using namespace Aws::SQS::ExtendedLib;
+
+static const char* SQS_RECEIPT_HANDLE = "AQEBzbVv6ZlhvNzIq+bJjM/7mHxXoZLeJ0o2Z3K9Qn1gQ2Vv8w==";
+
+namespace
+{
+  bool IsWithin (const SQSStringView& view, const Aws::String& receiptHandle)
+  {
+    return view.GetData () >= receiptHandle.data ()
+        && view.GetData () + view.GetSize () <= receiptHandle.data () + receiptHandle.size ();
+  }
+
+  // what the marker form was read with before the view, kept to compare against
+  Aws::String GetFromReceiptHandleByMarker (const Aws::String& receiptHandle, const Aws::String& marker)
+  {
+    size_t firstOccurence = receiptHandle.find (marker);
+    size_t secondOccurence = receiptHandle.find (marker, firstOccurence + 1);
+    return receiptHandle.substr (firstOccurence + marker.length (), secondOccurence - firstOccurence - marker.length ());
+  }
+
+  Aws::String RandomString (std::mt19937& random, size_t maxLength)
+  {
+    static const char alphabet[] = "ab:- 0123456789SQSRH/.s3Key";
+    std::uniform_int_distribution<size_t> length (0, maxLength);
+    std::uniform_int_distribution<size_t> character (0, sizeof (alphabet) - 2);
+    Aws::String str (length (random), ' ');
+    for (auto& c : str)
+    {
+      c = alphabet[character (random)];
+    }
+    return str;
+  }
+}
+
+TEST(SQSReceiptHandleViewTest, TestEnvelopeRoundTrip)
+{
+  Aws::String receiptHandle = SQSReceiptHandleView::Envelope ("bucket", "6f1c-42", SQS_RECEIPT_HANDLE);
+  EXPECT_EQ(Aws::String ("SQSRH/1 6:bucket 7:6f1c-42 ") + SQS_RECEIPT_HANDLE, receiptHandle);
+
+  SQSReceiptHandleView receiptHandleView;
+  ASSERT_TRUE(receiptHandleView.Parse (receiptHandle));
+  EXPECT_TRUE(receiptHandleView.IsExtended ());
+  EXPECT_TRUE(receiptHandleView.GetS3BucketName () == "bucket");
+  EXPECT_TRUE(receiptHandleView.GetS3Key () == "6f1c-42");
+  EXPECT_TRUE(receiptHandleView.GetSQSReceiptHandle () == SQS_RECEIPT_HANDLE);
+
+  // the parts are read in place
+  EXPECT_TRUE(IsWithin (receiptHandleView.GetS3Key (), receiptHandle));
+  EXPECT_TRUE(IsWithin (receiptHandleView.GetSQSReceiptHandle (), receiptHandle));
+}
+
+TEST(SQSReceiptHandleViewTest, TestEnvelopeTakesKeysHoldingMarkers)
+{
+  Aws::String s3Key = Aws::String ("folder/") + SQSReceiptHandleView::S3_KEY_MARKER + " 3:odd SQSRH/1 ";
+  Aws::String receiptHandle = SQSReceiptHandleView::Envelope ("bucket", s3Key, SQS_RECEIPT_HANDLE);
+
+  SQSReceiptHandleView receiptHandleView;
+  ASSERT_TRUE(receiptHandleView.Parse (receiptHandle));
+  EXPECT_EQ(s3Key, receiptHandleView.GetS3Key ().ToString ());
+  EXPECT_TRUE(receiptHandleView.GetSQSReceiptHandle () == SQS_RECEIPT_HANDLE);
+}
+
+TEST(SQSReceiptHandleViewTest, TestReadsTheMarkerForm)
+{
+  Aws::String receiptHandle = SQSReceiptHandleView::EmbedWithMarkers ("bucket", "6f1c-42", SQS_RECEIPT_HANDLE);
+  EXPECT_EQ(Aws::String ("-..s3BucketName..-bucket-..s3BucketName..--..s3Key..-6f1c-42-..s3Key..-") + SQS_RECEIPT_HANDLE,
+            receiptHandle);
+
+  SQSReceiptHandleView receiptHandleView;
+  ASSERT_TRUE(receiptHandleView.Parse (receiptHandle));
+  EXPECT_EQ(GetFromReceiptHandleByMarker (receiptHandle, SQSReceiptHandleView::S3_BUCKET_NAME_MARKER),
+            receiptHandleView.GetS3BucketName ().ToString ());
+  EXPECT_EQ(GetFromReceiptHandleByMarker (receiptHandle, SQSReceiptHandleView::S3_KEY_MARKER),
+            receiptHandleView.GetS3Key ().ToString ());
+  EXPECT_TRUE(receiptHandleView.GetSQSReceiptHandle () == SQS_RECEIPT_HANDLE);
+}
+
+TEST(SQSReceiptHandleViewTest, TestTakesAnythingElseAsIssuedBySqs)
+{
+  const char* receiptHandles[] = {
+    "",
+    SQS_RECEIPT_HANDLE,
+    "SQSRH/1",
+    "SQSRH/1 6:bucket",
+    "SQSRH/1 6:bucket 7:6f1c-42",
+    "SQSRH/1 6:bucket 70:6f1c-42 handle",
+    "SQSRH/1 6:bucket7:6f1c-42 handle",
+    "SQSRH/1 99999999999:bucket 7:6f1c-42 handle",
+    "SQSRH/2 6:bucket 7:6f1c-42 handle",
+    "-..s3BucketName..-bucket-..s3BucketName..-handle",
+    "-..s3BucketName..-bucket-..s3BucketName..--..s3Key..-6f1c-42",
+    "handle-..s3BucketName..-bucket-..s3BucketName..--..s3Key..-6f1c-42-..s3Key..-"
+  };
+  for (const char* receiptHandle : receiptHandles)
+  {
+    SQSReceiptHandleView receiptHandleView;
+    EXPECT_FALSE(receiptHandleView.Parse (receiptHandle)) << receiptHandle;
+    EXPECT_FALSE(receiptHandleView.IsExtended ()) << receiptHandle;
+    EXPECT_TRUE(receiptHandleView.GetSQSReceiptHandle () == receiptHandle) << receiptHandle;
+  }
+}
+
+TEST(SQSReceiptHandleViewTest, TestFuzzedReceiptHandles)
+{
+  std::mt19937 random (20161017);
+
+  // any envelope reads back as written
+  for (unsigned i = 0; i < 10000; ++i)
+  {
+    Aws::String s3BucketName = RandomString (random, 16);
+    Aws::String s3Key = RandomString (random, 64);
+    Aws::String sqsReceiptHandle = RandomString (random, 64);
+    Aws::String receiptHandle = SQSReceiptHandleView::Envelope (s3BucketName, s3Key, sqsReceiptHandle);
+
+    SQSReceiptHandleView receiptHandleView;
+    ASSERT_TRUE(receiptHandleView.Parse (receiptHandle)) << receiptHandle;
+    ASSERT_EQ(s3BucketName, receiptHandleView.GetS3BucketName ().ToString ());
+    ASSERT_EQ(s3Key, receiptHandleView.GetS3Key ().ToString ());
+    ASSERT_EQ(sqsReceiptHandle, receiptHandleView.GetSQSReceiptHandle ().ToString ());
+  }
+
+  // truncated, mutated or random handles never make the parts reach out of the handle
+  std::uniform_int_distribution<int> byte (0, 255);
+  for (unsigned i = 0; i < 100000; ++i)
+  {
+    Aws::String receiptHandle = i % 2 == 0
+        ? SQSReceiptHandleView::Envelope (RandomString (random, 8), RandomString (random, 16), RandomString (random, 16))
+        : SQSReceiptHandleView::EmbedWithMarkers (RandomString (random, 8), RandomString (random, 16), RandomString (random, 16));
+    if (!receiptHandle.empty ())
+    {
+      std::uniform_int_distribution<size_t> pos (0, receiptHandle.size () - 1);
+      switch (i % 3)
+      {
+        case 0:
+          receiptHandle.resize (pos (random));
+          break;
+        case 1:
+          receiptHandle[pos (random)] = static_cast<char> (byte (random));
+          break;
+        default:
+          receiptHandle.insert (pos (random), 1, static_cast<char> (byte (random)));
+          break;
+      }
+    }
+
+    SQSReceiptHandleView receiptHandleView;
+    bool isExtended = receiptHandleView.Parse (receiptHandle);
+    ASSERT_TRUE(IsWithin (receiptHandleView.GetSQSReceiptHandle (), receiptHandle));
+    if (isExtended)
+    {
+      ASSERT_TRUE(IsWithin (receiptHandleView.GetS3BucketName (), receiptHandle));
+      ASSERT_TRUE(IsWithin (receiptHandleView.GetS3Key (), receiptHandle));
+    }
+    else
+    {
+      ASSERT_EQ(receiptHandle.size (), receiptHandleView.GetSQSReceiptHandle ().GetSize ());
+    }
+  }
+}
+
+TEST(SQSReceiptHandleViewTest, TestParsingCost)
+{
+  const unsigned iterations = 100000;
+  Aws::String markerHandle = SQSReceiptHandleView::EmbedWithMarkers ("sqs-extended-lib-test-bucket",
+                                                                     "2f6a4d0e-8c51-4b3e-9b7d-0c1e5f3a9d42", SQS_RECEIPT_HANDLE);
+  Aws::String envelopeHandle = SQSReceiptHandleView::Envelope ("sqs-extended-lib-test-bucket",
+                                                               "2f6a4d0e-8c51-4b3e-9b7d-0c1e5f3a9d42", SQS_RECEIPT_HANDLE);
+  size_t checksum = 0;
+
+  auto start = std::chrono::steady_clock::now ();
+  for (unsigned i = 0; i < iterations; ++i)
+  {
+    Aws::String s3BucketName = GetFromReceiptHandleByMarker (markerHandle, SQSReceiptHandleView::S3_BUCKET_NAME_MARKER);
+    Aws::String s3Key = GetFromReceiptHandleByMarker (markerHandle, SQSReceiptHandleView::S3_KEY_MARKER);
+    size_t lastOccurence = markerHandle.rfind (SQSReceiptHandleView::S3_KEY_MARKER);
+    Aws::String sqsReceiptHandle = markerHandle.substr (lastOccurence + std::strlen (SQSReceiptHandleView::S3_KEY_MARKER));
+    checksum += s3BucketName.size () + s3Key.size () + sqsReceiptHandle.size ();
+  }
+  auto markerFind = std::chrono::steady_clock::now () - start;
+
+  start = std::chrono::steady_clock::now ();
+  for (unsigned i = 0; i < iterations; ++i)
+  {
+    SQSReceiptHandleView receiptHandleView;
+    receiptHandleView.Parse (markerHandle);
+    checksum += receiptHandleView.GetSQSReceiptHandle ().GetSize ();
+  }
+  auto markerView = std::chrono::steady_clock::now () - start;
+
+  start = std::chrono::steady_clock::now ();
+  for (unsigned i = 0; i < iterations; ++i)
+  {
+    SQSReceiptHandleView receiptHandleView;
+    receiptHandleView.Parse (envelopeHandle);
+    checksum += receiptHandleView.GetSQSReceiptHandle ().GetSize ();
+  }
+  auto envelopeView = std::chrono::steady_clock::now () - start;
+
+  auto perHandle = [iterations] (std::chrono::steady_clock::duration elapsed)
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds> (elapsed).count () / iterations;
+  };
+  std::cout << "receipt handle, ns per parse:" << std::endl
+            << "  markers with find and substr " << perHandle (markerFind) << std::endl
+            << "  markers in place " << perHandle (markerView) << std::endl
+            << "  envelope in place " << perHandle (envelopeView) << std::endl;
+  EXPECT_GT(checksum, 0u);
+}
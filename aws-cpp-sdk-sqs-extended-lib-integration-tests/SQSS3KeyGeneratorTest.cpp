@@ -0,0 +1,102 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <aws/external/gtest.h>
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/core/utils/memory/stl/AWSSet.h>
+#include <aws/core/utils/memory/stl/AWSVector.h>
+#include <aws/sqs/extendedlib/SQSUuidS3KeyGenerator.h>
+#include <mutex>
+#include <thread>
+
+using namespace Aws;
+using namespace Aws::SQS::ExtendedLib;
+
+TEST(SQSS3KeyGeneratorTest, TestUuidV4Format)
+{
+  SQSUuidS3KeyGenerator keyGenerator;
+  Aws::String key = keyGenerator.GenerateKey ();
+
+  ASSERT_EQ(36u, key.size ());
+  EXPECT_EQ('-', key[8]);
+  EXPECT_EQ('-', key[13]);
+  EXPECT_EQ('4', key[14]);
+  EXPECT_EQ('-', key[18]);
+  EXPECT_TRUE(key[19] == '8' || key[19] == '9' || key[19] == 'a' || key[19] == 'b');
+  EXPECT_EQ('-', key[23]);
+}
+
+TEST(SQSS3KeyGeneratorTest, TestUuidV7IsTimeOrdered)
+{
+  SQSUuidS3KeyGenerator keyGenerator (SQSS3KeyFormat::UUID_V7);
+  Aws::String first = keyGenerator.GenerateKey ();
+  std::this_thread::sleep_for (std::chrono::milliseconds (2));
+  Aws::String second = keyGenerator.GenerateKey ();
+
+  EXPECT_EQ('7', first[14]);
+  EXPECT_LT(first.substr (0, 13), second.substr (0, 13));
+}
+
+TEST(SQSS3KeyGeneratorTest, TestHashedPrefixIsStable)
+{
+  SQSUuidS3KeyGenerator keyGenerator (SQSS3KeyFormat::UUID_V7, SQSS3KeyPrefix::HASHED, 3);
+  Aws::String key = keyGenerator.GenerateKey ("SQSLargePayloadSha256-00ff");
+
+  EXPECT_EQ(key, keyGenerator.GenerateKey ("SQSLargePayloadSha256-00ff"));
+  EXPECT_EQ('/', key[3]);
+  EXPECT_EQ("SQSLargePayloadSha256-00ff", key.substr (4));
+
+  SQSUuidS3KeyGenerator randomKeyGenerator (SQSS3KeyFormat::UUID_V4, SQSS3KeyPrefix::RANDOM, 3);
+  EXPECT_EQ(key, randomKeyGenerator.GenerateKey ("SQSLargePayloadSha256-00ff"));
+}
+
+TEST(SQSS3KeyGeneratorTest, TestNoCollisionsAcrossThreads)
+{
+  const unsigned threadCount = 16;
+  const unsigned keysPerThread = 20000;
+  SQSUuidS3KeyGenerator keyGenerators[] =
+  {
+    SQSUuidS3KeyGenerator (SQSS3KeyFormat::UUID_V4),
+    SQSUuidS3KeyGenerator (SQSS3KeyFormat::UUID_V7, SQSS3KeyPrefix::RANDOM, 2)
+  };
+
+  for (const auto& keyGenerator : keyGenerators)
+  {
+    Aws::Set<Aws::String> keys;
+    std::mutex keysMutex;
+    Aws::Vector<std::thread> threads;
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+      threads.push_back (std::thread ([&keyGenerator, &keys, &keysMutex, keysPerThread] ()
+      {
+        Aws::Vector<Aws::String> threadKeys;
+        threadKeys.reserve (keysPerThread);
+        for (unsigned j = 0; j < keysPerThread; ++j)
+        {
+          threadKeys.push_back (keyGenerator.GenerateKey ());
+        }
+
+        std::lock_guard<std::mutex> lock (keysMutex);
+        keys.insert (threadKeys.begin (), threadKeys.end ());
+      }));
+    }
+    for (auto& thread : threads)
+    {
+      thread.join ();
+    }
+
+    EXPECT_EQ(threadCount * keysPerThread, keys.size ());
+  }
+}
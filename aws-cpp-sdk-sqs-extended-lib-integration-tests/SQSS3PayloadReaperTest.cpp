@@ -0,0 +1,326 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <aws/external/gtest.h>
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <aws/core/utils/memory/stl/AWSSet.h>
+#include <aws/s3/S3Client.h>
+#include <aws/s3/model/DeleteObjectsRequest.h>
+#include <aws/sqs/extendedlib/SQSS3PayloadReaper.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+using namespace Aws;
+using namespace Aws::S3;
+using namespace Aws::S3::Model;
+using namespace Aws::SQS::ExtendedLib;
+
+static const char* ALLOCATION_TAG = "SQSS3PayloadReaperTest";
+static const char* LOG_PATH = "SQSS3PayloadReaperTest.log";
+
+namespace
+{
+  // records the keys deleted per bucket, refusing each key of refusedKeys as many times as asked
+  class RecordingS3Client : public S3Client
+  {
+
+  public:
+    mutable std::mutex mutex;
+    mutable Aws::Set<Aws::String> deletedKeys;
+    mutable Aws::Map<Aws::String, unsigned> refusedKeys;
+    mutable size_t deleteCalls;
+    mutable size_t largestDelete;
+    // called ahead of every delete, outside the lock
+    std::function<void ()> beforeDelete;
+
+    RecordingS3Client () :
+        deleteCalls (0), largestDelete (0)
+    {
+    }
+
+    virtual DeleteObjectsOutcome DeleteObjects (const DeleteObjectsRequest& request) const
+    {
+      if (beforeDelete)
+      {
+        beforeDelete ();
+      }
+      std::lock_guard<std::mutex> lock (mutex);
+      ++deleteCalls;
+      largestDelete = std::max (largestDelete, request.GetDelete ().GetObjects ().size ());
+
+      DeleteObjectsResult result;
+      Aws::Vector<Error> errors;
+      for (auto& object : request.GetDelete ().GetObjects ())
+      {
+        auto refusedKey = refusedKeys.find (object.GetKey ());
+        if (refusedKey != refusedKeys.end () && refusedKey->second > 0)
+        {
+          --refusedKey->second;
+          Error error;
+          error.SetKey (object.GetKey ());
+          error.SetCode ("InternalError");
+          errors.push_back (error);
+          continue;
+        }
+        deletedKeys.insert (request.GetBucket () + "/" + object.GetKey ());
+      }
+      result.SetErrors (errors);
+      return DeleteObjectsOutcome (result);
+    }
+
+  };
+}
+
+TEST(SQSS3PayloadReaperTest, TestReapsEnqueuedKeysInMultiObjectDeletes)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  SQSS3PayloadReaper reaper (s3Client, 2);
+
+  for (unsigned i = 0; i < 2500; ++i)
+  {
+    ASSERT_TRUE(reaper.Enqueue ("bucket", std::to_string (i).c_str ()));
+  }
+  reaper.Flush ();
+
+  EXPECT_EQ(2500u, s3Client->deletedKeys.size ());
+  EXPECT_EQ(2500u, reaper.GetReapedDeletes ());
+  EXPECT_EQ(0u, reaper.GetPendingDeletes ());
+  EXPECT_LE(s3Client->largestDelete, 1000u);
+  EXPECT_LT(s3Client->deleteCalls, 2500u);
+
+  reaper.Shutdown ();
+  EXPECT_FALSE(reaper.Enqueue ("bucket", "late"));
+}
+
+TEST(SQSS3PayloadReaperTest, TestRetriesRefusedKeys)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  s3Client->refusedKeys["flaky"] = 2;
+  s3Client->refusedKeys["broken"] = 100;
+  SQSS3PayloadReaper reaper (s3Client, 1, 2);
+
+  reaper.Enqueue ("bucket", "flaky");
+  reaper.Enqueue ("bucket", "broken");
+  reaper.Flush ();
+
+  EXPECT_EQ(1u, s3Client->deletedKeys.count ("bucket/flaky"));
+  EXPECT_EQ(0u, s3Client->deletedKeys.count ("bucket/broken"));
+  EXPECT_EQ(1u, reaper.GetReapedDeletes ());
+  EXPECT_EQ(1u, reaper.GetFailedDeletes ());
+}
+
+TEST(SQSS3PayloadReaperTest, TestShutdownDrainsPendingKeys)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  {
+    SQSS3PayloadReaper reaper (s3Client, 4);
+    for (unsigned i = 0; i < 100; ++i)
+    {
+      reaper.Enqueue (i % 2 == 0 ? "even" : "odd", std::to_string (i).c_str ());
+    }
+  }
+
+  EXPECT_EQ(100u, s3Client->deletedKeys.size ());
+  EXPECT_EQ(1u, s3Client->deletedKeys.count ("odd/99"));
+}
+
+TEST(SQSS3PayloadReaperTest, TestRecoversPendingKeysFromLog)
+{
+  {
+    // k1 was reaped, k2 was still pending and the write of k3 was cut short
+    std::ofstream log (LOG_PATH, std::ios_base::out | std::ios_base::trunc);
+    log << "+ 6:bucket 2:k1\n+ 6:bucket 2:k2\n- 6:bucket 2:k1\n+ 6:bucket 2:k3";
+  }
+
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  {
+    SQSS3PayloadReaper reaper (s3Client, 1, 3, LOG_PATH);
+    reaper.Flush ();
+    EXPECT_EQ(1u, reaper.GetReapedDeletes ());
+  }
+  EXPECT_EQ(1u, s3Client->deletedKeys.size ());
+  EXPECT_EQ(1u, s3Client->deletedKeys.count ("bucket/k2"));
+
+  // a clean shutdown leaves nothing to recover
+  {
+    SQSS3PayloadReaper reaper (s3Client, 1, 3, LOG_PATH);
+    EXPECT_EQ(0u, reaper.GetPendingDeletes ());
+  }
+  std::remove (LOG_PATH);
+}
+
+TEST(SQSS3PayloadReaperTest, TestLogRecordsEnqueuedAndReapedKeys)
+{
+  std::remove (LOG_PATH);
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  s3Client->refusedKeys["k1"] = 100;
+  {
+    SQSS3PayloadReaper reaper (s3Client, 1, 0, LOG_PATH);
+    reaper.Enqueue ("bucket", "k1");
+    reaper.Enqueue ("bucket", "k2");
+    reaper.Flush ();
+
+    // given up keys stay unmarked, the next reaper tries them again
+    std::ifstream log (LOG_PATH);
+    Aws::String content ((std::istreambuf_iterator<char> (log)), std::istreambuf_iterator<char> ());
+    for (auto line : {"+ 6:bucket 2:k1\n", "+ 6:bucket 2:k2\n", "- 6:bucket 2:k2\n"})
+    {
+      EXPECT_NE(Aws::String::npos, content.find (line));
+    }
+    EXPECT_EQ(Aws::String::npos, content.find ("- 6:bucket 2:k1\n"));
+    EXPECT_EQ(1u, reaper.GetFailedDeletes ());
+  }
+
+  {
+    std::ifstream log (LOG_PATH);
+    Aws::String content ((std::istreambuf_iterator<char> (log)), std::istreambuf_iterator<char> ());
+    EXPECT_EQ("+ 6:bucket 2:k1\n", content);
+  }
+
+  s3Client->refusedKeys["k1"] = 0;
+  {
+    SQSS3PayloadReaper reaper (s3Client, 1, 0, LOG_PATH);
+    reaper.Flush ();
+    EXPECT_EQ(1u, reaper.GetReapedDeletes ());
+  }
+  EXPECT_EQ(1u, s3Client->deletedKeys.count ("bucket/k1"));
+
+  std::ifstream log (LOG_PATH);
+  Aws::String content ((std::istreambuf_iterator<char> (log)), std::istreambuf_iterator<char> ());
+  EXPECT_TRUE(content.empty ());
+  std::remove (LOG_PATH);
+}
+
+TEST(SQSS3PayloadReaperTest, TestRecoversKeysHoldingNewlines)
+{
+  std::remove (LOG_PATH);
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  s3Client->refusedKeys["a b\n+ 6:bucket 2:k9\n"] = 100;
+  {
+    SQSS3PayloadReaper reaper (s3Client, 1, 0, LOG_PATH);
+    reaper.Enqueue ("bucket", "a b\n+ 6:bucket 2:k9\n");
+    reaper.Flush ();
+  }
+
+  // the key comes back whole, without the line it seems to hold
+  s3Client->refusedKeys.clear ();
+  {
+    SQSS3PayloadReaper reaper (s3Client, 1, 0, LOG_PATH);
+    reaper.Flush ();
+    EXPECT_EQ(1u, reaper.GetReapedDeletes ());
+  }
+  EXPECT_EQ(1u, s3Client->deletedKeys.size ());
+  EXPECT_EQ(1u, s3Client->deletedKeys.count ("bucket/a b\n+ 6:bucket 2:k9\n"));
+  std::remove (LOG_PATH);
+}
+
+TEST(SQSS3PayloadReaperTest, TestCompactsLogWhileRunning)
+{
+  std::remove (LOG_PATH);
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  {
+    SQSS3PayloadReaper reaper (s3Client, 2, 0, LOG_PATH);
+    for (unsigned i = 0; i < 5000; ++i)
+    {
+      reaper.Enqueue ("bucket", std::to_string (i).c_str ());
+    }
+    reaper.Flush ();
+    EXPECT_EQ(5000u, reaper.GetReapedDeletes ());
+
+    // without compaction the log would hold a line per enqueue and one per delete
+    std::ifstream log (LOG_PATH);
+    Aws::String content ((std::istreambuf_iterator<char> (log)), std::istreambuf_iterator<char> ());
+    EXPECT_LT(std::count (content.begin (), content.end (), '\n'), 5000);
+  }
+
+  SQSS3PayloadReaper reaper (s3Client, 1, 0, LOG_PATH);
+  EXPECT_EQ(0u, reaper.GetPendingDeletes ());
+  reaper.Shutdown ();
+  std::remove (LOG_PATH);
+}
+
+TEST(SQSS3PayloadReaperTest, TestShutdownCutsRetriesShort)
+{
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  s3Client->refusedKeys["broken"] = 100;
+  SQSS3PayloadReaper reaper (s3Client, 1, 10);
+
+  // ten retries would back off for minutes
+  reaper.Enqueue ("bucket", "broken");
+  std::this_thread::sleep_for (std::chrono::milliseconds (50));
+  auto start = std::chrono::steady_clock::now ();
+  reaper.Shutdown ();
+
+  EXPECT_LT(std::chrono::steady_clock::now () - start, std::chrono::seconds (1));
+  EXPECT_EQ(1u, reaper.GetFailedDeletes ());
+  EXPECT_EQ(1u, s3Client->deleteCalls);
+}
+
+TEST(SQSS3PayloadReaperTest, TestShutsDownFromItsOwnDelete)
+{
+  std::remove (LOG_PATH);
+  auto s3Client = Aws::MakeShared<RecordingS3Client> (ALLOCATION_TAG);
+  std::promise<void> enqueued;
+  std::shared_future<void> isEnqueued = enqueued.get_future ().share ();
+  {
+    SQSS3PayloadReaper reaper (s3Client, 1, 0, LOG_PATH);
+    bool isShutDown = false;
+    s3Client->beforeDelete = [&] ()
+    {
+      if (!isShutDown)
+      {
+        isShutDown = true;
+        isEnqueued.wait ();
+        reaper.Shutdown ();
+      }
+    };
+    reaper.Enqueue ("first", "k1");
+    reaper.Enqueue ("second", "k2");
+    reaper.Enqueue ("second", "k3");
+    enqueued.set_value ();
+    reaper.Flush ();
+  }
+
+  // the keys after the one being deleted go from the shutdown, that one stays pending in the log
+  {
+    std::lock_guard<std::mutex> lock (s3Client->mutex);
+    EXPECT_EQ(1u, s3Client->deletedKeys.count ("second/k2"));
+    EXPECT_EQ(1u, s3Client->deletedKeys.count ("second/k3"));
+  }
+  std::ifstream log (LOG_PATH);
+  Aws::String content ((std::istreambuf_iterator<char> (log)), std::istreambuf_iterator<char> ());
+  EXPECT_EQ("+ 5:first 2:k1\n", content);
+  std::remove (LOG_PATH);
+
+  // the detached reaper still finishes its delete on the client
+  for (unsigned i = 0; i < 500; ++i)
+  {
+    {
+      std::lock_guard<std::mutex> lock (s3Client->mutex);
+      if (s3Client->deletedKeys.count ("first/k1") > 0)
+      {
+        break;
+      }
+    }
+    std::this_thread::sleep_for (std::chrono::milliseconds (10));
+  }
+  std::this_thread::sleep_for (std::chrono::milliseconds (10));
+}
@@ -0,0 +1,505 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/core/utils/DateTime.h>
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <aws/core/utils/memory/stl/AWSMap.h>
+#include <aws/core/utils/memory/stl/AWSSet.h>
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/core/utils/memory/stl/AWSStringStream.h>
+#include <aws/core/utils/memory/stl/AWSVector.h>
+#include <aws/s3/S3Client.h>
+#include <aws/s3/model/PutObjectRequest.h>
+#include <aws/s3/model/GetObjectRequest.h>
+#include <aws/s3/model/HeadObjectRequest.h>
+#include <aws/s3/model/DeleteObjectRequest.h>
+#include <aws/s3/model/DeleteObjectsRequest.h>
+#include <aws/s3/model/CreateMultipartUploadRequest.h>
+#include <aws/s3/model/UploadPartRequest.h>
+#include <aws/s3/model/CompleteMultipartUploadRequest.h>
+#include <aws/s3/model/AbortMultipartUploadRequest.h>
+#include <aws/sqs/SQSClient.h>
+#include <aws/sqs/model/SendMessageRequest.h>
+#include <aws/sqs/model/SendMessageBatchRequest.h>
+#include <aws/sqs/model/ReceiveMessageRequest.h>
+#include <aws/sqs/model/DeleteMessageRequest.h>
+#include <aws/sqs/model/DeleteMessageBatchRequest.h>
+#include <aws/sqs/model/ChangeMessageVisibilityBatchRequest.h>
+#include <aws/sqs/extendedlib/SQSPayloadStream.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * In-memory bucket standing in for s3 in unit tests. Objects are kept per "bucket/key", and every call is
+       * recorded. Uploads can be slowed down to observe how many of them run at once, held back behind uploadGate, and
+       * left unstored when only their size matters. Downloads of the objects in downloadDelays take as long as asked, the ranges in
+       * shortRanges come back with half their bytes and the ones in rangeFailures fail with an error worth retrying, as
+       * many times as asked, while the ones in refusedRanges always fail with one that is not. Payloads starting with
+       * "refused" are refused, and each part number of partFailures fails as many times as asked with an error worth
+       * retrying. Multi-object deletes keep the keys starting with "locked", and fail as a whole on the bucket
+       * "unreachable".
+       */
+      class RecordingS3Client : public Aws::S3::S3Client
+      {
+
+      public:
+        mutable std::mutex mutex;
+        mutable Aws::Map<Aws::String, Aws::String> objects;
+        mutable Aws::Map<Aws::String, Aws::Utils::DateTime> lastModified;
+        mutable Aws::Vector<Aws::String> deletedKeys;
+        mutable Aws::Vector<Aws::S3::Model::DeleteObjectsRequest> deleteObjectsRequests;
+        mutable size_t headObjectCalls;
+        mutable size_t putObjectCalls;
+        mutable size_t activeUploads;
+        mutable size_t maxActiveUploads;
+        mutable size_t uploadedBytes;
+        mutable size_t inPlaceUploads;
+        mutable Aws::Map<Aws::String, Aws::Map<int, Aws::String> > uploadedParts;
+        mutable Aws::Map<int, unsigned> partFailures;
+        mutable Aws::Map<int, unsigned> partAttempts;
+        mutable size_t abortedUploads;
+        mutable size_t getObjectCalls;
+        mutable size_t activeDownloads;
+        mutable size_t maxActiveDownloads;
+        mutable Aws::Vector<Aws::String> getObjectRanges;
+        mutable Aws::Map<Aws::String, unsigned> shortRanges;
+        mutable Aws::Map<Aws::String, unsigned> rangeFailures;
+        Aws::Set<Aws::String> refusedRanges;
+        std::chrono::milliseconds uploadDelay;
+        // uploads wait for it once it is set, to hold them back until a test lets them go
+        std::shared_future<void> uploadGate;
+        Aws::Map<Aws::String, std::chrono::milliseconds> downloadDelays;
+        bool storeObjects;
+
+        RecordingS3Client () :
+            headObjectCalls (0), putObjectCalls (0), activeUploads (0), maxActiveUploads (0), uploadedBytes (0), inPlaceUploads (0),
+            abortedUploads (0), getObjectCalls (0), activeDownloads (0), maxActiveDownloads (0), uploadDelay (0), storeObjects (true)
+        {
+        }
+
+        virtual Aws::S3::Model::PutObjectOutcome PutObject (const Aws::S3::Model::PutObjectRequest& request) const
+        {
+          BeginUpload ();
+          Aws::String body = ReadBody (*request.GetBody ());
+          EndUpload ();
+          if (body.find ("refused") == 0)
+          {
+            return Aws::S3::Model::PutObjectOutcome (Aws::S3::S3Error (Aws::S3::S3Errors::ACCESS_DENIED, false));
+          }
+          {
+            std::lock_guard<std::mutex> lock (mutex);
+            ++putObjectCalls;
+            if (dynamic_cast<SQSPayloadStream*> (request.GetBody ().get ()))
+            {
+              ++inPlaceUploads;
+            }
+            if (storeObjects)
+            {
+              objects[request.GetBucket () + "/" + request.GetKey ()] = body;
+            }
+            lastModified[request.GetBucket () + "/" + request.GetKey ()] = Aws::Utils::DateTime::Now ();
+          }
+          return Aws::S3::Model::PutObjectOutcome (Aws::S3::Model::PutObjectResult ());
+        }
+
+        virtual Aws::S3::Model::GetObjectOutcome GetObject (const Aws::S3::Model::GetObjectRequest& request) const
+        {
+          Aws::String objectName = request.GetBucket () + "/" + request.GetKey ();
+          Aws::String object;
+          {
+            std::lock_guard<std::mutex> lock (mutex);
+            ++getObjectCalls;
+            getObjectRanges.push_back (request.GetRange ());
+            if (refusedRanges.count (request.GetRange ()) > 0)
+            {
+              return Aws::S3::Model::GetObjectOutcome (Aws::S3::S3Error (Aws::S3::S3Errors::ACCESS_DENIED, false));
+            }
+            auto rangeFailure = rangeFailures.find (request.GetRange ());
+            if (rangeFailure != rangeFailures.end () && rangeFailure->second > 0)
+            {
+              --rangeFailure->second;
+              return Aws::S3::Model::GetObjectOutcome (Aws::S3::S3Error (Aws::S3::S3Errors::INTERNAL_FAILURE, true));
+            }
+            maxActiveDownloads = std::max (maxActiveDownloads, ++activeDownloads);
+            auto stored = objects.find (objectName);
+            if (stored == objects.end ())
+            {
+              --activeDownloads;
+              return Aws::S3::Model::GetObjectOutcome (Aws::S3::S3Error (Aws::S3::S3Errors::NO_SUCH_KEY, false));
+            }
+            object = stored->second;
+          }
+          auto downloadDelay = downloadDelays.find (objectName);
+          if (downloadDelay != downloadDelays.end ())
+          {
+            std::this_thread::sleep_for (downloadDelay->second);
+          }
+
+          // ranges come as "bytes=first-last"
+          if (!request.GetRange ().empty ())
+          {
+            char* last = nullptr;
+            size_t first = std::strtoul (request.GetRange ().c_str () + 6, &last, 10);
+            size_t length = std::strtoul (last + 1, nullptr, 10) + 1 - first;
+            object = object.substr (first, length);
+
+            std::lock_guard<std::mutex> lock (mutex);
+            auto shortRange = shortRanges.find (request.GetRange ());
+            if (shortRange != shortRanges.end () && shortRange->second > 0)
+            {
+              --shortRange->second;
+              object.resize (object.size () / 2);
+            }
+          }
+
+          Aws::IOStream* body = request.GetResponseStreamFactory ()
+              ? request.GetResponseStreamFactory () ()
+              : Aws::New<Aws::StringStream> ("RecordingS3Client");
+          body->write (object.data (), static_cast<std::streamsize> (object.size ()));
+          Aws::S3::Model::GetObjectResult result;
+          result.ReplaceBody (body);
+
+          std::lock_guard<std::mutex> lock (mutex);
+          --activeDownloads;
+          return Aws::S3::Model::GetObjectOutcome (std::move (result));
+        }
+
+        virtual Aws::S3::Model::HeadObjectOutcome HeadObject (const Aws::S3::Model::HeadObjectRequest& request) const
+        {
+          std::lock_guard<std::mutex> lock (mutex);
+          ++headObjectCalls;
+          auto object = lastModified.find (request.GetBucket () + "/" + request.GetKey ());
+          if (object == lastModified.end ())
+          {
+            return Aws::S3::Model::HeadObjectOutcome (Aws::S3::S3Error (Aws::S3::S3Errors::NO_SUCH_KEY, false));
+          }
+
+          Aws::S3::Model::HeadObjectResult result;
+          result.SetLastModified (object->second);
+          return Aws::S3::Model::HeadObjectOutcome (result);
+        }
+
+        virtual Aws::S3::Model::DeleteObjectOutcome DeleteObject (const Aws::S3::Model::DeleteObjectRequest& request) const
+        {
+          std::lock_guard<std::mutex> lock (mutex);
+          deletedKeys.push_back (request.GetKey ());
+          objects.erase (request.GetBucket () + "/" + request.GetKey ());
+          lastModified.erase (request.GetBucket () + "/" + request.GetKey ());
+          return Aws::S3::Model::DeleteObjectOutcome (Aws::S3::Model::DeleteObjectResult ());
+        }
+
+        virtual Aws::S3::Model::DeleteObjectsOutcome DeleteObjects (const Aws::S3::Model::DeleteObjectsRequest& request) const
+        {
+          std::lock_guard<std::mutex> lock (mutex);
+          deleteObjectsRequests.push_back (request);
+          if (request.GetBucket () == "unreachable")
+          {
+            return Aws::S3::Model::DeleteObjectsOutcome (
+                Aws::S3::S3Error (Aws::S3::S3Errors::NETWORK_CONNECTION, "NetworkingError", "unreachable", true));
+          }
+
+          Aws::S3::Model::DeleteObjectsResult result;
+          for (auto& object : request.GetDelete ().GetObjects ())
+          {
+            if (object.GetKey ().find ("locked") == 0)
+            {
+              Aws::S3::Model::Error error;
+              error.SetKey (object.GetKey ());
+              error.SetCode ("AccessDenied");
+              error.SetMessage ("locked");
+              result.AddErrors (error);
+              continue;
+            }
+            deletedKeys.push_back (object.GetKey ());
+            objects.erase (request.GetBucket () + "/" + object.GetKey ());
+            lastModified.erase (request.GetBucket () + "/" + object.GetKey ());
+          }
+          return Aws::S3::Model::DeleteObjectsOutcome (result);
+        }
+
+        virtual Aws::S3::Model::CreateMultipartUploadOutcome CreateMultipartUpload (
+            const Aws::S3::Model::CreateMultipartUploadRequest& request) const
+        {
+          std::lock_guard<std::mutex> lock (mutex);
+          Aws::String uploadId = request.GetBucket () + "/" + request.GetKey ();
+          uploadedParts[uploadId].clear ();
+
+          Aws::S3::Model::CreateMultipartUploadResult result;
+          result.SetUploadId (uploadId);
+          return Aws::S3::Model::CreateMultipartUploadOutcome (result);
+        }
+
+        virtual Aws::S3::Model::UploadPartOutcome UploadPart (const Aws::S3::Model::UploadPartRequest& request) const
+        {
+          BeginUpload ();
+          Aws::String body = ReadBody (*request.GetBody ());
+          EndUpload ();
+
+          std::lock_guard<std::mutex> lock (mutex);
+          ++partAttempts[request.GetPartNumber ()];
+          auto partFailure = partFailures.find (request.GetPartNumber ());
+          if (partFailure != partFailures.end () && partFailure->second > 0)
+          {
+            --partFailure->second;
+            return Aws::S3::Model::UploadPartOutcome (Aws::S3::S3Error (Aws::S3::S3Errors::INTERNAL_FAILURE, true));
+          }
+          uploadedParts[request.GetUploadId ()][request.GetPartNumber ()] = body;
+
+          Aws::S3::Model::UploadPartResult result;
+          result.SetETag (std::to_string (request.GetPartNumber ()).c_str ());
+          return Aws::S3::Model::UploadPartOutcome (result);
+        }
+
+        virtual Aws::S3::Model::CompleteMultipartUploadOutcome CompleteMultipartUpload (
+            const Aws::S3::Model::CompleteMultipartUploadRequest& request) const
+        {
+          std::lock_guard<std::mutex> lock (mutex);
+          Aws::Map<int, Aws::String>& parts = uploadedParts[request.GetUploadId ()];
+          Aws::String object;
+          for (auto& part : request.GetMultipartUpload ().GetParts ())
+          {
+            object += parts[part.GetPartNumber ()];
+          }
+          objects[request.GetBucket () + "/" + request.GetKey ()] = object;
+          uploadedParts.erase (request.GetUploadId ());
+          return Aws::S3::Model::CompleteMultipartUploadOutcome (Aws::S3::Model::CompleteMultipartUploadResult ());
+        }
+
+        virtual Aws::S3::Model::AbortMultipartUploadOutcome AbortMultipartUpload (
+            const Aws::S3::Model::AbortMultipartUploadRequest& request) const
+        {
+          std::lock_guard<std::mutex> lock (mutex);
+          ++abortedUploads;
+          uploadedParts.erase (request.GetUploadId ());
+          return Aws::S3::Model::AbortMultipartUploadOutcome (Aws::S3::Model::AbortMultipartUploadResult ());
+        }
+
+      protected:
+        void BeginUpload () const
+        {
+          {
+            std::lock_guard<std::mutex> lock (mutex);
+            maxActiveUploads = std::max (maxActiveUploads, ++activeUploads);
+          }
+          std::this_thread::sleep_for (uploadDelay);
+          if (uploadGate.valid ())
+          {
+            uploadGate.wait ();
+          }
+        }
+
+        void EndUpload () const
+        {
+          std::lock_guard<std::mutex> lock (mutex);
+          --activeUploads;
+        }
+
+        Aws::String ReadBody (Aws::IOStream& body) const
+        {
+          Aws::String content;
+          char chunk[4096];
+          while (body.read (chunk, sizeof (chunk)) || body.gcount () > 0)
+          {
+            if (storeObjects)
+            {
+              content.append (chunk, static_cast<size_t> (body.gcount ()));
+            }
+            std::lock_guard<std::mutex> lock (mutex);
+            uploadedBytes += static_cast<size_t> (body.gcount ());
+          }
+          return content;
+        }
+
+      };
+
+      /**
+       * Queue standing in for sqs in unit tests, it records every request and answers every batch entry with
+       * success, except the ones whose body or receipt handle starts with "invalid". Sent batch entries get their
+       * body as message id. Receives hand back the single messages sent, in order, each once, with "handle-" and
+       * its index as receipt handle.
+       */
+      class RecordingQueueClient : public Aws::SQS::SQSClient
+      {
+
+      public:
+        mutable std::mutex mutex;
+        mutable Aws::Vector<Aws::SQS::Model::SendMessageRequest> messages;
+        mutable Aws::Vector<Aws::SQS::Model::SendMessageBatchRequest> sendBatches;
+        mutable Aws::Vector<Aws::SQS::Model::DeleteMessageBatchRequest> deleteBatches;
+        mutable Aws::Vector<Aws::SQS::Model::ChangeMessageVisibilityBatchRequest> visibilityBatches;
+        mutable Aws::Vector<Aws::String> deletedReceiptHandles;
+        mutable size_t receivedMessages;
+        // called ahead of every delete and visibility batch, outside the lock
+        std::function<void ()> beforeBatch;
+
+        RecordingQueueClient () :
+            receivedMessages (0)
+        {
+        }
+
+        virtual Aws::SQS::Model::SendMessageOutcome SendMessage (const Aws::SQS::Model::SendMessageRequest& request) const
+        {
+          std::lock_guard<std::mutex> lock (mutex);
+          messages.push_back (request);
+
+          Aws::SQS::Model::SendMessageResult result;
+          result.SetMessageId (std::to_string (messages.size ()).c_str ());
+          return Aws::SQS::Model::SendMessageOutcome (result);
+        }
+
+        virtual Aws::SQS::Model::ReceiveMessageOutcome ReceiveMessage (
+            const Aws::SQS::Model::ReceiveMessageRequest& request) const
+        {
+          std::lock_guard<std::mutex> lock (mutex);
+
+          Aws::SQS::Model::ReceiveMessageResult result;
+          for (int i = 0; i < request.GetMaxNumberOfMessages () && receivedMessages < messages.size (); ++i)
+          {
+            const Aws::SQS::Model::SendMessageRequest& sent = messages[receivedMessages];
+            Aws::SQS::Model::Message message;
+            message.SetMessageId (std::to_string (receivedMessages + 1).c_str ());
+            message.SetReceiptHandle (Aws::String ("handle-") + std::to_string (receivedMessages).c_str ());
+            message.SetBody (sent.GetMessageBody ());
+            message.SetMessageAttributes (sent.GetMessageAttributes ());
+            result.AddMessages (message);
+            ++receivedMessages;
+          }
+          return Aws::SQS::Model::ReceiveMessageOutcome (result);
+        }
+
+        virtual Aws::SQS::Model::DeleteMessageOutcome DeleteMessage (const Aws::SQS::Model::DeleteMessageRequest& request) const
+        {
+          std::lock_guard<std::mutex> lock (mutex);
+          deletedReceiptHandles.push_back (request.GetReceiptHandle ());
+
+          using namespace Aws::SQS::Model;
+          return DeleteMessageOutcome (NoResult ());
+        }
+
+        virtual Aws::SQS::Model::DeleteMessageBatchOutcome DeleteMessageBatch (
+            const Aws::SQS::Model::DeleteMessageBatchRequest& request) const
+        {
+          if (beforeBatch)
+          {
+            beforeBatch ();
+          }
+          std::lock_guard<std::mutex> lock (mutex);
+          deleteBatches.push_back (request);
+
+          Aws::SQS::Model::DeleteMessageBatchResult result;
+          for (auto& entry : request.GetEntries ())
+          {
+            if (entry.GetReceiptHandle ().find ("invalid") == 0)
+            {
+              Aws::SQS::Model::BatchResultErrorEntry errorEntry;
+              errorEntry.SetId (entry.GetId ());
+              errorEntry.SetCode ("ReceiptHandleIsInvalid");
+              errorEntry.SetSenderFault (true);
+              result.AddFailed (errorEntry);
+            }
+            else
+            {
+              deletedReceiptHandles.push_back (entry.GetReceiptHandle ());
+              Aws::SQS::Model::DeleteMessageBatchResultEntry resultEntry;
+              resultEntry.SetId (entry.GetId ());
+              result.AddSuccessful (resultEntry);
+            }
+          }
+          return Aws::SQS::Model::DeleteMessageBatchOutcome (result);
+        }
+
+        virtual Aws::SQS::Model::SendMessageBatchOutcome SendMessageBatch (
+            const Aws::SQS::Model::SendMessageBatchRequest& request) const
+        {
+          std::lock_guard<std::mutex> lock (mutex);
+          sendBatches.push_back (request);
+
+          Aws::SQS::Model::SendMessageBatchResult result;
+          for (auto& entry : request.GetEntries ())
+          {
+            if (entry.GetMessageBody ().find ("invalid") == 0)
+            {
+              Aws::SQS::Model::BatchResultErrorEntry errorEntry;
+              errorEntry.SetId (entry.GetId ());
+              errorEntry.SetCode ("InvalidMessageContents");
+              errorEntry.SetSenderFault (true);
+              result.AddFailed (errorEntry);
+            }
+            else
+            {
+              Aws::SQS::Model::SendMessageBatchResultEntry resultEntry;
+              resultEntry.SetId (entry.GetId ());
+              resultEntry.SetMessageId (entry.GetMessageBody ());
+              result.AddSuccessful (resultEntry);
+            }
+          }
+          return Aws::SQS::Model::SendMessageBatchOutcome (result);
+        }
+
+        virtual Aws::SQS::Model::ChangeMessageVisibilityBatchOutcome ChangeMessageVisibilityBatch (
+            const Aws::SQS::Model::ChangeMessageVisibilityBatchRequest& request) const
+        {
+          if (beforeBatch)
+          {
+            beforeBatch ();
+          }
+          std::lock_guard<std::mutex> lock (mutex);
+          visibilityBatches.push_back (request);
+
+          Aws::SQS::Model::ChangeMessageVisibilityBatchResult result;
+          for (auto& entry : request.GetEntries ())
+          {
+            if (entry.GetReceiptHandle ().find ("invalid") == 0)
+            {
+              Aws::SQS::Model::BatchResultErrorEntry errorEntry;
+              errorEntry.SetId (entry.GetId ());
+              errorEntry.SetCode ("ReceiptHandleIsInvalid");
+              errorEntry.SetSenderFault (true);
+              result.AddFailed (errorEntry);
+            }
+            else
+            {
+              Aws::SQS::Model::ChangeMessageVisibilityBatchResultEntry resultEntry;
+              resultEntry.SetId (entry.GetId ());
+              result.AddSuccessful (resultEntry);
+            }
+          }
+          return Aws::SQS::Model::ChangeMessageVisibilityBatchOutcome (result);
+        }
+
+        // batches sent by background threads are read through a copy
+        Aws::Vector<Aws::SQS::Model::ChangeMessageVisibilityBatchRequest> GetVisibilityBatches () const
+        {
+          std::lock_guard<std::mutex> lock (mutex);
+          return visibilityBatches;
+        }
+
+      };
+
+    } // namespace ExtendedLib
+  } // namespace SQS
+} // namespace Aws
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/external/gtest.h>
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <aws/sqs/SQSClient.h>
+#include <aws/sqs/model/ChangeMessageVisibilityBatchRequest.h>
+#include <aws/sqs/extendedlib/SQSVisibilityHeartbeat.h>
+#include "SQSTestClients.h"
+#include <future>
+#include <thread>
+
+using namespace Aws;
+using namespace Aws::SQS;
+using namespace Aws::SQS::Model;
+using namespace Aws::SQS::ExtendedLib;
+
+static const char* ALLOCATION_TAG = "SQSVisibilityHeartbeatTest";
+
+TEST(SQSVisibilityHeartbeatTest, TestExtendsMessagesBeforeTheyExpire)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSVisibilityHeartbeat heartbeat (sqsClient, std::chrono::seconds (2), std::chrono::seconds (1));
+
+  heartbeat.Track ("queue", "first");
+  heartbeat.Track ("queue", "second");
+  EXPECT_TRUE(sqsClient->GetVisibilityBatches ().empty ());
+
+  std::this_thread::sleep_for (std::chrono::milliseconds (1500));
+
+  auto batches = sqsClient->GetVisibilityBatches ();
+  ASSERT_EQ(1u, batches.size ());
+  ASSERT_EQ(2u, batches[0].GetEntries ().size ());
+  for (auto& entry : batches[0].GetEntries ())
+  {
+    EXPECT_EQ(2, entry.GetVisibilityTimeout ());
+  }
+  EXPECT_EQ(2u, heartbeat.GetTrackedCount ());
+}
+
+TEST(SQSVisibilityHeartbeatTest, TestCoalescesMessagesCloseToTheirTurn)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSVisibilityHeartbeat heartbeat (sqsClient, std::chrono::seconds (2), std::chrono::seconds (1));
+
+  heartbeat.Track ("queue", "first");
+  std::this_thread::sleep_for (std::chrono::milliseconds (200));
+  heartbeat.Track ("queue", "second");
+  heartbeat.Track ("other", "third");
+
+  std::this_thread::sleep_for (std::chrono::milliseconds (1100));
+
+  // the second message went along with the first one, each queue has its own batch
+  auto batches = sqsClient->GetVisibilityBatches ();
+  ASSERT_EQ(2u, batches.size ());
+  for (auto& batch : batches)
+  {
+    EXPECT_EQ(batch.GetQueueUrl () == "queue" ? 2u : 1u, batch.GetEntries ().size ());
+  }
+}
+
+TEST(SQSVisibilityHeartbeatTest, TestStopsTrackingMessagesSqsRefuses)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSVisibilityHeartbeat heartbeat (sqsClient, std::chrono::seconds (1), std::chrono::seconds (1));
+
+  heartbeat.Track ("queue", "valid");
+  heartbeat.Track ("queue", "invalid");
+  heartbeat.Track ("queue", "untracked");
+  heartbeat.Untrack ("queue", "untracked");
+
+  std::this_thread::sleep_for (std::chrono::milliseconds (200));
+
+  EXPECT_EQ(1u, heartbeat.GetTrackedCount ());
+  auto batches = sqsClient->GetVisibilityBatches ();
+  ASSERT_FALSE(batches.empty ());
+  EXPECT_EQ(2u, batches[0].GetEntries ().size ());
+}
+
+TEST(SQSVisibilityHeartbeatTest, TestNacksReleaseMessagesAtOnce)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSVisibilityHeartbeat heartbeat (sqsClient, std::chrono::seconds (30));
+
+  heartbeat.Track ("queue", "valid");
+  auto valid = heartbeat.Nack ("queue", "valid");
+  auto invalid = heartbeat.Nack ("queue", "invalid");
+
+  EXPECT_TRUE(valid.get ().IsSuccess ());
+  ChangeMessageVisibilityOutcome outcome = invalid.get ();
+  ASSERT_FALSE(outcome.IsSuccess ());
+  EXPECT_EQ("ReceiptHandleIsInvalid", outcome.GetError ().GetExceptionName ());
+
+  EXPECT_EQ(0u, heartbeat.GetTrackedCount ());
+  for (auto& batch : sqsClient->GetVisibilityBatches ())
+  {
+    for (auto& entry : batch.GetEntries ())
+    {
+      EXPECT_EQ(0, entry.GetVisibilityTimeout ());
+    }
+  }
+}
+
+TEST(SQSVisibilityHeartbeatTest, TestShutsDownFromItsOwnBatch)
+{
+  auto sqsClient = Aws::MakeShared<RecordingQueueClient> (ALLOCATION_TAG);
+  SQSVisibilityHeartbeat heartbeat (sqsClient, std::chrono::seconds (30));
+
+  // a nack queued while the heartbeat is busy is still sent once it shuts itself down
+  std::future<ChangeMessageVisibilityOutcome> queued;
+  sqsClient->beforeBatch = [&] ()
+  {
+    if (!queued.valid ())
+    {
+      queued = heartbeat.Nack ("queue", "queued");
+      heartbeat.Shutdown ();
+    }
+  };
+
+  auto first = heartbeat.Nack ("queue", "first");
+  ASSERT_EQ(std::future_status::ready, first.wait_for (std::chrono::seconds (5)));
+  EXPECT_TRUE(first.get ().IsSuccess ());
+  ASSERT_EQ(std::future_status::ready, queued.wait_for (std::chrono::seconds (5)));
+  EXPECT_TRUE(queued.get ().IsSuccess ());
+  EXPECT_EQ(2u, sqsClient->GetVisibilityBatches ().size ());
+}
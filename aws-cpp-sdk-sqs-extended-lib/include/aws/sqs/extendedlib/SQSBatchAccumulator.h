@@ -0,0 +1,272 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <aws/core/utils/memory/stl/AWSDeque.h>
+#include <aws/core/utils/memory/stl/AWSMap.h>
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/core/utils/memory/stl/AWSVector.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * Gathers entries per queue and hands them to sendBatch in batches, as soon as a queue fills its next batch or
+       * the deadline of its oldest entry is due. batchLength tells how many of the entries waiting for a queue go in
+       * its next batch, at most MAX_BATCH_ENTRIES. The batches are sent by the flusher threads, while no lock is held.
+       * Of the queues ready, the one whose oldest entry has waited the longest goes first.
+       *
+       * PendingT is movable and has a deadline member.
+       */
+      template<typename PendingT>
+      class SQSBatchAccumulator
+      {
+
+      public:
+        typedef std::chrono::steady_clock Clock;
+        typedef std::function<size_t (const Aws::Deque<PendingT>&)> BatchLength;
+        typedef std::function<void (const Aws::String&, Aws::Vector<PendingT>&)> BatchSender;
+
+        static const size_t MAX_BATCH_ENTRIES = 10;
+
+      private:
+        BatchSender m_sendBatch;
+        BatchLength m_batchLength;
+
+        Aws::Map<Aws::String, Aws::Deque<PendingT> > m_pending;
+        size_t m_flushing;
+        bool m_shutdown;
+        std::mutex m_mutex;
+        std::condition_variable m_batchReady;
+        std::condition_variable m_drained;
+        Aws::Vector<std::thread> m_flushers;
+        // set by a Shutdown running on the flusher itself, which then returns without touching the accumulator
+        Aws::Vector<std::shared_ptr<bool> > m_detached;
+
+      public:
+        SQSBatchAccumulator (const BatchSender& sendBatch, unsigned flushers, const BatchLength& batchLength = nullptr) :
+            m_sendBatch (sendBatch), m_batchLength (batchLength), m_flushing (0), m_shutdown (false)
+        {
+          if (!m_batchLength)
+          {
+            m_batchLength = [] (const Aws::Deque<PendingT>& queueEntries)
+            {
+              return std::min (queueEntries.size (), static_cast<size_t> (MAX_BATCH_ENTRIES));
+            };
+          }
+
+          for (unsigned i = 0; i < std::max (flushers, 1u); ++i)
+          {
+            m_detached.push_back (Aws::MakeShared<bool> ("SQSBatchAccumulator", false));
+            m_flushers.push_back (std::thread (&SQSBatchAccumulator::Accumulate, this, m_detached.back ()));
+          }
+        }
+
+        ~SQSBatchAccumulator ()
+        {
+          Shutdown ();
+        }
+
+        /**
+         * Queues the entry for its queue. Returns false after Shutdown, the entry is then left to the caller.
+         */
+        bool Add (const Aws::String& queueUrl, PendingT& pending)
+        {
+          std::lock_guard<std::mutex> lock (m_mutex);
+          if (m_shutdown)
+          {
+            return false;
+          }
+
+          Aws::Deque<PendingT>& queueEntries = m_pending[queueUrl];
+          queueEntries.push_back (std::move (pending));
+
+          // the flushers only need waking for a new deadline or a full batch
+          if (queueEntries.size () == 1 || IsFull (queueEntries))
+          {
+            m_batchReady.notify_one ();
+          }
+          return true;
+        }
+
+        /**
+         * Sends every entry queued so far without waiting for its deadline, and waits until they are sent.
+         */
+        void Flush ()
+        {
+          std::unique_lock<std::mutex> lock (m_mutex);
+          Clock::time_point now = Clock::now ();
+          for (auto& queueEntries : m_pending)
+          {
+            for (auto& pending : queueEntries.second)
+            {
+              pending.deadline = std::min (pending.deadline, now);
+            }
+          }
+          m_batchReady.notify_all ();
+
+          m_drained.wait (lock, [this] ()
+          {
+            return m_pending.empty () && m_flushing == 0;
+          });
+        }
+
+        /**
+         * Sends the entries still queued and waits for the flushers. Called from sendBatch, the flusher sending that
+         * batch is detached instead, it returns as soon as sendBatch does, and what the others leave is sent from here.
+         */
+        void Shutdown ()
+        {
+          bool isFlusher = false;
+          {
+            std::lock_guard<std::mutex> lock (m_mutex);
+            m_shutdown = true;
+            for (size_t i = 0; i < m_flushers.size (); ++i)
+            {
+              if (m_flushers[i].joinable () && m_flushers[i].get_id () == std::this_thread::get_id ())
+              {
+                *m_detached[i] = true;
+                m_flushers[i].detach ();
+                --m_flushing;
+                isFlusher = true;
+              }
+            }
+          }
+          m_batchReady.notify_all ();
+
+          for (auto& flusher : m_flushers)
+          {
+            if (flusher.joinable ())
+            {
+              flusher.join ();
+            }
+          }
+
+          std::unique_lock<std::mutex> lock (m_mutex);
+          while (isFlusher && !m_pending.empty ())
+          {
+            Aws::String queueUrl = m_pending.begin ()->first;
+            Aws::Vector<PendingT> batch = TakeBatch (m_pending.begin ());
+            lock.unlock ();
+            m_sendBatch (queueUrl, batch);
+            lock.lock ();
+          }
+          if (m_pending.empty () && m_flushing == 0)
+          {
+            m_drained.notify_all ();
+          }
+        }
+
+      private:
+        bool IsFull (const Aws::Deque<PendingT>& queueEntries) const
+        {
+          size_t batchLength = m_batchLength (queueEntries);
+          return batchLength < queueEntries.size () || batchLength == MAX_BATCH_ENTRIES;
+        }
+
+        Aws::Vector<PendingT> TakeBatch (typename Aws::Map<Aws::String, Aws::Deque<PendingT> >::iterator queueEntries)
+        {
+          Aws::Vector<PendingT> batch;
+          for (size_t batchLength = m_batchLength (queueEntries->second); batchLength > 0; --batchLength)
+          {
+            batch.push_back (std::move (queueEntries->second.front ()));
+            queueEntries->second.pop_front ();
+          }
+          if (queueEntries->second.empty ())
+          {
+            m_pending.erase (queueEntries);
+          }
+          return batch;
+        }
+
+        void Accumulate (std::shared_ptr<bool> detached)
+        {
+          std::unique_lock<std::mutex> lock (m_mutex);
+          while (true)
+          {
+            // a queue is sent once its next batch is full or its oldest entry is due, anything goes on shutdown,
+            // the earliest deadline first so that a busy queue does not starve the ones after it
+            Clock::time_point now = Clock::now ();
+            Clock::time_point wakeUp = Clock::time_point::max ();
+            auto ready = m_pending.end ();
+            for (auto queueEntries = m_pending.begin (); queueEntries != m_pending.end (); ++queueEntries)
+            {
+              const PendingT& oldest = queueEntries->second.front ();
+              if (m_shutdown || oldest.deadline <= now || IsFull (queueEntries->second))
+              {
+                if (ready == m_pending.end () || oldest.deadline < ready->second.front ().deadline)
+                {
+                  ready = queueEntries;
+                }
+                continue;
+              }
+              wakeUp = std::min (wakeUp, oldest.deadline);
+            }
+
+            if (ready == m_pending.end ())
+            {
+              if (m_shutdown)
+              {
+                return;
+              }
+              if (wakeUp == Clock::time_point::max ())
+              {
+                m_batchReady.wait (lock);
+              }
+              else
+              {
+                m_batchReady.wait_until (lock, wakeUp);
+              }
+              continue;
+            }
+
+            Aws::String queueUrl = ready->first;
+            Aws::Vector<PendingT> batch = TakeBatch (ready);
+            ++m_flushing;
+
+            lock.unlock ();
+            m_sendBatch (queueUrl, batch);
+            if (*detached)
+            {
+              return;
+            }
+            lock.lock ();
+
+            --m_flushing;
+            if (m_pending.empty () && m_flushing == 0)
+            {
+              m_drained.notify_all ();
+            }
+          }
+        }
+
+      };
+
+      template<typename PendingT>
+      const size_t SQSBatchAccumulator<PendingT>::MAX_BATCH_ENTRIES;
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
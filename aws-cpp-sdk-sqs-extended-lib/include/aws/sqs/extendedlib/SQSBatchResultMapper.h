@@ -0,0 +1,93 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/core/utils/memory/stl/AWSVector.h>
+#include <aws/sqs/SQSErrors.h>
+#include <cstdlib>
+#include <string>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * Gives every entry of a batch request its own outcome, the entries being identified by their position. A
+       * failed entry carries the code sqs reported for it, worth retrying unless the sender was at fault, and a
+       * batch failed as a whole hands its error to every entry.
+       */
+      class SQSBatchResultMapper
+      {
+
+      public:
+        static Aws::String GetEntryId (size_t position)
+        {
+          return std::to_string (position).c_str ();
+        }
+
+        /**
+         * toOutcome turns a successful result entry into the outcome of its entry.
+         */
+        template<typename OutcomeT, typename BatchOutcomeT, typename ToOutcomeT>
+        static Aws::Vector<OutcomeT> Map (const BatchOutcomeT& batchOutcome, size_t entryCount, const ToOutcomeT& toOutcome)
+        {
+          if (!batchOutcome.IsSuccess ())
+          {
+            return Aws::Vector<OutcomeT> (entryCount, OutcomeT (batchOutcome.GetError ()));
+          }
+
+          Aws::Vector<OutcomeT> outcomes (entryCount);
+          Aws::Vector<char> isSettled (entryCount, 0);
+          for (auto& entry : batchOutcome.GetResult ().GetSuccessful ())
+          {
+            size_t i = std::strtoul (entry.GetId ().c_str (), nullptr, 10);
+            if (i < entryCount && !isSettled[i])
+            {
+              outcomes[i] = toOutcome (entry);
+              isSettled[i] = 1;
+            }
+          }
+          for (auto& entry : batchOutcome.GetResult ().GetFailed ())
+          {
+            size_t i = std::strtoul (entry.GetId ().c_str (), nullptr, 10);
+            if (i < entryCount && !isSettled[i])
+            {
+              outcomes[i] = OutcomeT (Aws::Client::AWSError<SQSErrors> (SQSErrors::UNKNOWN, entry.GetCode (),
+                                                                        entry.GetMessage (), !entry.GetSenderFault ()));
+              isSettled[i] = 1;
+            }
+          }
+
+          // sqs accounts for every entry, this is only a safety net
+          for (size_t i = 0; i < entryCount; ++i)
+          {
+            if (!isSettled[i])
+            {
+              outcomes[i] = OutcomeT (Aws::Client::AWSError<SQSErrors> (SQSErrors::UNKNOWN, "MissingBatchResultEntry",
+                                                                        "The batch result has no entry for this message",
+                                                                        true));
+            }
+          }
+          return outcomes;
+        }
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/core/utils/memory/stl/AWSDeque.h>
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/core/utils/memory/stl/AWSVector.h>
+#include <aws/sqs/model/SendMessageRequest.h>
+#include <aws/sqs/model/SendMessageBatchRequestEntry.h>
+#include <aws/sqs/SQSClient.h>
+#include <aws/sqs/SQS_EXPORTS.h>
+#include <aws/sqs/extendedlib/SQSBatchAccumulator.h>
+#include <chrono>
+#include <functional>
+#include <future>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * Gathers single sends per queue and sends them as SendMessageBatch, as soon as ten are waiting for the same
+       * queue, when one more would take the batch over maxBatchSize bytes of bodies and attributes, or when the
+       * oldest one has lingered maxLinger. A message bigger than maxBatchSize goes in a batch of its own. Given an
+       * SQSExtendedClient, large bodies are still offloaded to s3 by its batch send.
+       *
+       * Every send gets its own outcome, failed entries carrying the code sqs reported for them. A zero delay leaves
+       * the delay of the queue in place unless overrideQueueDelay is given, since the request does not tell whether it
+       * was set.
+       */
+      class AWS_SQS_API SQSBatchingProducer
+      {
+
+      public:
+        typedef std::function<void (const Model::SendMessageOutcome&)> SendMessageCompletion;
+
+      private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct PendingSend
+        {
+          Model::SendMessageBatchRequestEntry entry;
+          size_t size;
+          Clock::time_point deadline;
+          SendMessageCompletion completion;
+        };
+
+        std::shared_ptr<SQSClient> m_sqsClient;
+        Clock::duration m_maxLinger;
+        size_t m_maxBatchSize;
+        SQSBatchAccumulator<PendingSend> m_accumulator;
+
+        size_t GetBatchLength (const Aws::Deque<PendingSend>& queueSends) const;
+        void SendBatch (const Aws::String& queueUrl, Aws::Vector<PendingSend>& pendingSends) const;
+
+      public:
+        SQSBatchingProducer (const std::shared_ptr<SQSClient>& sqsClient,
+                             std::chrono::milliseconds maxLinger = std::chrono::milliseconds (20),
+                             size_t maxBatchSize = 262144, unsigned flushers = 1);
+
+        virtual ~SQSBatchingProducer ();
+
+        /**
+         * Queues the message, the outcome is ready once its batch has been sent. After Shutdown the message is
+         * sent on its own, before returning.
+         */
+        virtual std::future<Model::SendMessageOutcome> SendMessage (const Model::SendMessageRequest& request,
+                                                                    bool overrideQueueDelay = false);
+
+        /**
+         * Queues the message without waiting on anything but the queue lock, completion gets the outcome on the
+         * flusher thread that sent its batch and should return quickly. After Shutdown the message is sent on its
+         * own and completion called before returning.
+         */
+        virtual void SendMessageAsync (const Model::SendMessageRequest& request, const SendMessageCompletion& completion,
+                                       bool overrideQueueDelay = false);
+
+        /**
+         * Sends every message queued so far without waiting for the linger to run out, and waits for their outcome.
+         */
+        virtual void Flush ();
+
+        /**
+         * Sends the messages still queued and waits for the flushers.
+         */
+        virtual void Shutdown ();
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
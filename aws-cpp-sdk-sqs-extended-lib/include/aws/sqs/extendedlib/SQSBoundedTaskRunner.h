@@ -0,0 +1,51 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/core/utils/threading/Executor.h>
+#include <aws/sqs/SQS_EXPORTS.h>
+#include <functional>
+#include <memory>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * Runs a fixed number of independent tasks on an executor, never more than maxConcurrency at a time,
+       * and returns once all of them have finished. The calling thread takes part in the work, so nested
+       * runs sharing the same executor cannot starve each other.
+       */
+      class AWS_SQS_API SQSBoundedTaskRunner
+      {
+
+      private:
+        std::shared_ptr<Aws::Utils::Threading::Executor> m_executor;
+        unsigned m_maxConcurrency;
+
+      public:
+        SQSBoundedTaskRunner (const std::shared_ptr<Aws::Utils::Threading::Executor>& executor, unsigned maxConcurrency);
+
+        virtual void Run (size_t taskCount, const std::function<void (size_t)>& task) const;
+
+        virtual unsigned GetMaxConcurrency () const;
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
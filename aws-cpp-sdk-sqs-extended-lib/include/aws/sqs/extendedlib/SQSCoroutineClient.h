@@ -0,0 +1,239 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+
+// awaitable operations need a c++20 compiler, the header is empty otherwise
+#if defined(__cpp_impl_coroutine)
+#include <aws/core/client/AsyncCallerContext.h>
+#include <aws/sqs/model/SendMessageRequest.h>
+#include <aws/sqs/model/SendMessageBatchRequest.h>
+#include <aws/sqs/model/ReceiveMessageRequest.h>
+#include <aws/sqs/model/DeleteMessageRequest.h>
+#include <aws/sqs/model/DeleteMessageBatchRequest.h>
+#include <aws/sqs/SQSClient.h>
+#include <aws/sqs/SQS_EXPORTS.h>
+#include <aws/sqs/extendedlib/SQSBatchingProducer.h>
+#include <aws/sqs/extendedlib/SQSDeleteAccumulator.h>
+#include <coroutine>
+#include <functional>
+#include <memory>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * Resumes the coroutines waiting on an operation, usually by posting them to the event loop they run on.
+       */
+      class SQSCoroutineScheduler
+      {
+
+      public:
+        virtual ~SQSCoroutineScheduler ()
+        {
+        }
+
+        virtual void Schedule (std::coroutine_handle<> handle) = 0;
+
+      };
+
+      /**
+       * Suspends the awaiting coroutine until the outcome of an operation started with its Async variant is known.
+       */
+      template<typename OutcomeT>
+      class SQSOutcomeAwaiter
+      {
+
+      public:
+        typedef std::function<void (const OutcomeT&)> Completion;
+        typedef std::function<void (const Completion&)> Starter;
+
+      private:
+        Starter m_starter;
+        std::shared_ptr<SQSCoroutineScheduler> m_scheduler;
+        OutcomeT m_outcome;
+
+      public:
+        SQSOutcomeAwaiter (const Starter& starter, const std::shared_ptr<SQSCoroutineScheduler>& scheduler) :
+            m_starter (starter), m_scheduler (scheduler)
+        {
+        }
+
+        bool await_ready () const noexcept
+        {
+          return false;
+        }
+
+        void await_suspend (std::coroutine_handle<> handle)
+        {
+          // the coroutine may be resumed, and this awaiter destroyed, before the starter returns
+          Starter starter = std::move (m_starter);
+          starter ([this, handle] (const OutcomeT& outcome)
+          {
+            m_outcome = outcome;
+            if (m_scheduler)
+            {
+              m_scheduler->Schedule (handle);
+            }
+            else
+            {
+              handle.resume ();
+            }
+          });
+        }
+
+        OutcomeT await_resume ()
+        {
+          return std::move (m_outcome);
+        }
+
+      };
+
+      /**
+       * Awaitable front of a client, co_await coClient.SendMessageCo (request) yields the outcome SendMessage would
+       * return. Suspending only hands the request over, the coroutine holds no thread while it waits.
+       *
+       * The sdk http client blocks, so the request itself holds a thread for its round trip: a thread of the Async
+       * thread pool of the client, or with a producer or a delete accumulator, a flusher sending the batch of up to
+       * ten coroutines it joined. The latter keeps far more sends and deletes in flight than there are threads.
+       *
+       * Awaiting coroutines are resumed by the scheduler, or without one on the thread that completed the operation.
+       */
+      class SQSCoroutineClient
+      {
+
+      private:
+        std::shared_ptr<SQSClient> m_sqsClient;
+        std::shared_ptr<SQSCoroutineScheduler> m_scheduler;
+        std::shared_ptr<SQSBatchingProducer> m_producer;
+        std::shared_ptr<SQSDeleteAccumulator> m_deleteAccumulator;
+
+      public:
+        /**
+         * Sends go through producer and deletes through deleteAccumulator when given, they should wrap sqsClient.
+         */
+        SQSCoroutineClient (const std::shared_ptr<SQSClient>& sqsClient,
+                            const std::shared_ptr<SQSCoroutineScheduler>& scheduler = nullptr,
+                            const std::shared_ptr<SQSBatchingProducer>& producer = nullptr,
+                            const std::shared_ptr<SQSDeleteAccumulator>& deleteAccumulator = nullptr) :
+            m_sqsClient (sqsClient), m_scheduler (scheduler), m_producer (producer), m_deleteAccumulator (deleteAccumulator)
+        {
+        }
+
+        SQSOutcomeAwaiter<Model::SendMessageOutcome> SendMessageCo (const Model::SendMessageRequest& request) const
+        {
+          if (m_producer)
+          {
+            std::shared_ptr<SQSBatchingProducer> producer = m_producer;
+            return SQSOutcomeAwaiter<Model::SendMessageOutcome> (
+                [producer, request] (const SQSOutcomeAwaiter<Model::SendMessageOutcome>::Completion& completion)
+                {
+                  producer->SendMessageAsync (request, completion);
+                }, m_scheduler);
+          }
+
+          std::shared_ptr<SQSClient> sqsClient = m_sqsClient;
+          return SQSOutcomeAwaiter<Model::SendMessageOutcome> (
+              [sqsClient, request] (const SQSOutcomeAwaiter<Model::SendMessageOutcome>::Completion& completion)
+              {
+                sqsClient->SendMessageAsync (request, [completion] (const SQSClient*, const Model::SendMessageRequest&,
+                                                                    const Model::SendMessageOutcome& outcome,
+                                                                    const std::shared_ptr<const Aws::Client::AsyncCallerContext>&)
+                {
+                  completion (outcome);
+                });
+              }, m_scheduler);
+        }
+
+        SQSOutcomeAwaiter<Model::ReceiveMessageOutcome> ReceiveMessageCo (const Model::ReceiveMessageRequest& request) const
+        {
+          std::shared_ptr<SQSClient> sqsClient = m_sqsClient;
+          return SQSOutcomeAwaiter<Model::ReceiveMessageOutcome> (
+              [sqsClient, request] (const SQSOutcomeAwaiter<Model::ReceiveMessageOutcome>::Completion& completion)
+              {
+                sqsClient->ReceiveMessageAsync (request, [completion] (const SQSClient*, const Model::ReceiveMessageRequest&,
+                                                                       const Model::ReceiveMessageOutcome& outcome,
+                                                                       const std::shared_ptr<const Aws::Client::AsyncCallerContext>&)
+                {
+                  completion (outcome);
+                });
+              }, m_scheduler);
+        }
+
+        SQSOutcomeAwaiter<Model::DeleteMessageOutcome> DeleteMessageCo (const Model::DeleteMessageRequest& request) const
+        {
+          if (m_deleteAccumulator)
+          {
+            std::shared_ptr<SQSDeleteAccumulator> deleteAccumulator = m_deleteAccumulator;
+            return SQSOutcomeAwaiter<Model::DeleteMessageOutcome> (
+                [deleteAccumulator, request] (const SQSOutcomeAwaiter<Model::DeleteMessageOutcome>::Completion& completion)
+                {
+                  deleteAccumulator->DeleteMessageAsync (request, completion);
+                }, m_scheduler);
+          }
+
+          std::shared_ptr<SQSClient> sqsClient = m_sqsClient;
+          return SQSOutcomeAwaiter<Model::DeleteMessageOutcome> (
+              [sqsClient, request] (const SQSOutcomeAwaiter<Model::DeleteMessageOutcome>::Completion& completion)
+              {
+                sqsClient->DeleteMessageAsync (request, [completion] (const SQSClient*, const Model::DeleteMessageRequest&,
+                                                                      const Model::DeleteMessageOutcome& outcome,
+                                                                      const std::shared_ptr<const Aws::Client::AsyncCallerContext>&)
+                {
+                  completion (outcome);
+                });
+              }, m_scheduler);
+        }
+
+        SQSOutcomeAwaiter<Model::SendMessageBatchOutcome> SendMessageBatchCo (const Model::SendMessageBatchRequest& request) const
+        {
+          std::shared_ptr<SQSClient> sqsClient = m_sqsClient;
+          return SQSOutcomeAwaiter<Model::SendMessageBatchOutcome> (
+              [sqsClient, request] (const SQSOutcomeAwaiter<Model::SendMessageBatchOutcome>::Completion& completion)
+              {
+                sqsClient->SendMessageBatchAsync (request, [completion] (const SQSClient*, const Model::SendMessageBatchRequest&,
+                                                                         const Model::SendMessageBatchOutcome& outcome,
+                                                                         const std::shared_ptr<const Aws::Client::AsyncCallerContext>&)
+                {
+                  completion (outcome);
+                });
+              }, m_scheduler);
+        }
+
+        SQSOutcomeAwaiter<Model::DeleteMessageBatchOutcome> DeleteMessageBatchCo (const Model::DeleteMessageBatchRequest& request) const
+        {
+          std::shared_ptr<SQSClient> sqsClient = m_sqsClient;
+          return SQSOutcomeAwaiter<Model::DeleteMessageBatchOutcome> (
+              [sqsClient, request] (const SQSOutcomeAwaiter<Model::DeleteMessageBatchOutcome>::Completion& completion)
+              {
+                sqsClient->DeleteMessageBatchAsync (request, [completion] (const SQSClient*, const Model::DeleteMessageBatchRequest&,
+                                                                           const Model::DeleteMessageBatchOutcome& outcome,
+                                                                           const std::shared_ptr<const Aws::Client::AsyncCallerContext>&)
+                {
+                  completion (outcome);
+                });
+              }, m_scheduler);
+        }
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
+
+#endif
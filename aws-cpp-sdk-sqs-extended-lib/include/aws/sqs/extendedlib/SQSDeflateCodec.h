@@ -0,0 +1,54 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/sqs/extendedlib/SQSPayloadCodec.h>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * zlib deflate codec. Level goes from 1 (fastest) to 9 (smallest), -1 is the zlib default.
+       */
+      class AWS_SQS_API SQSDeflateCodec : public SQSPayloadCodec
+      {
+
+      private:
+        int m_level;
+
+      public:
+        static const char* NAME;
+
+        SQSDeflateCodec (int level = -1);
+
+        virtual const char* GetName () const;
+        virtual bool Encode (const char* payload, size_t length, Aws::String& encoded) const;
+
+        /**
+         * Encodes only when the result takes at most maxLength bytes, giving up as soon as the output grows past it
+         * so the rest of the payload is never deflated.
+         */
+        virtual bool EncodeWithin (const char* payload, size_t length, size_t maxLength, Aws::String& encoded) const;
+        virtual bool Decode (Aws::IStream& encoded, Aws::String& payload) const;
+        virtual bool Decode (Aws::IStream& encoded, Aws::OStream& payload) const;
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/core/utils/memory/stl/AWSVector.h>
+#include <aws/sqs/model/DeleteMessageRequest.h>
+#include <aws/sqs/SQSClient.h>
+#include <aws/sqs/SQS_EXPORTS.h>
+#include <aws/sqs/extendedlib/SQSBatchAccumulator.h>
+#include <chrono>
+#include <functional>
+#include <future>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * Gathers single deletes per queue and sends them as DeleteMessageBatch, as soon as ten are waiting for the
+       * same queue or when the oldest one has waited maxLatency. Given an SQSExtendedClient, the payloads the
+       * messages point at are cleaned up by its batch delete.
+       *
+       * Every delete gets its own outcome, failed entries carrying the code sqs reported for them.
+       */
+      class AWS_SQS_API SQSDeleteAccumulator
+      {
+
+      public:
+        typedef std::function<void (const Model::DeleteMessageOutcome&)> DeleteMessageCompletion;
+
+      private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct PendingDelete
+        {
+          Aws::String receiptHandle;
+          Clock::time_point deadline;
+          DeleteMessageCompletion completion;
+        };
+
+        std::shared_ptr<SQSClient> m_sqsClient;
+        Clock::duration m_maxLatency;
+        SQSBatchAccumulator<PendingDelete> m_accumulator;
+
+        void SendBatch (const Aws::String& queueUrl, Aws::Vector<PendingDelete>& pendingDeletes) const;
+
+      public:
+        SQSDeleteAccumulator (const std::shared_ptr<SQSClient>& sqsClient,
+                              std::chrono::milliseconds maxLatency = std::chrono::milliseconds (100),
+                              unsigned flushers = 1);
+
+        virtual ~SQSDeleteAccumulator ();
+
+        /**
+         * Queues the delete, the outcome is ready once its batch has been sent. After Shutdown the message is
+         * deleted on its own, before returning.
+         */
+        virtual std::future<Model::DeleteMessageOutcome> DeleteMessage (const Model::DeleteMessageRequest& request);
+
+        /**
+         * Queues the delete without waiting on anything but the queue lock, completion gets the outcome on the
+         * flusher thread that sent its batch and should return quickly. After Shutdown the message is deleted on
+         * its own and completion called before returning.
+         */
+        virtual void DeleteMessageAsync (const Model::DeleteMessageRequest& request, const DeleteMessageCompletion& completion);
+
+        /**
+         * Sends every delete queued so far without waiting for the latency to run out, and waits for their outcome.
+         */
+        virtual void Flush ();
+
+        /**
+         * Sends the deletes still queued and waits for the flushers.
+         */
+        virtual void Shutdown ();
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
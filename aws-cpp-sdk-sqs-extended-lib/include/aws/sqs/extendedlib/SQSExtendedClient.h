@@ -14,6 +14,10 @@
  */
 #pragma once
 #include <aws/sqs/extendedlib/SQSExtendedClientConfiguration.h>
+#include <aws/sqs/extendedlib/SQSLargeMessageS3Pointer.h>
+#include <aws/sqs/extendedlib/SQSLazyPayload.h>
+#include <aws/sqs/extendedlib/SQSPayloadDigestCache.h>
+#include <aws/sqs/model/Message.h>
 #include <aws/sqs/model/MessageAttributeValue.h>
 #include <aws/sqs/model/SendMessageRequest.h>
 #include <aws/sqs/model/SendMessageBatchRequest.h>
@@ -21,8 +25,17 @@
 #include <aws/sqs/model/ReceiveMessageRequest.h>
 #include <aws/sqs/model/DeleteMessageRequest.h>
 #include <aws/sqs/model/DeleteMessageBatchRequest.h>
+#include <aws/sqs/model/ChangeMessageVisibilityRequest.h>
+#include <aws/sqs/model/ChangeMessageVisibilityBatchRequest.h>
 #include <aws/sqs/SQSClient.h>
+#include <aws/s3/S3Client.h>
+#include <aws/s3/model/Error.h>
 #include <aws/sqs/SQS_EXPORTS.h>
+#include <aws/core/client/AsyncCallerContext.h>
+#include <aws/core/utils/threading/Executor.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 
 namespace Aws
 {
@@ -37,24 +50,129 @@ namespace Aws
     private:
       std::shared_ptr<SQS::SQSClient> m_sqsclient;
       std::shared_ptr<SQSExtendedClientConfiguration> m_sqsconfig;
+      std::shared_ptr<Aws::Utils::Threading::Executor> m_s3Executor;
+      std::shared_ptr<SQSPayloadDigestCache> m_payloadDigestCache;
+      std::shared_ptr<Aws::Utils::Threading::Executor> m_asyncThreadPool;
+      mutable std::mutex m_asyncMutex;
+      mutable std::condition_variable m_asyncDrained;
+      mutable size_t m_pendingAsyncOperations;
+
+      virtual void SubmitAsync (const std::function<void ()>& operation) const;
 
       virtual Aws::String RandomizedS3Key() const;
       virtual unsigned GetMsgAttributesSize(const Aws::Map<Aws::String, Model::MessageAttributeValue>& messageAttributes) const;
-      virtual Aws::String GetFromReceiptHandleByMarker(const Aws::String receiptHandle, const Aws::String marker) const;
+      virtual Aws::String GetSQSReceiptHandle(const Aws::String& receiptHandle) const;
+      virtual Aws::String BuildReceiptHandle(const SQSLargeMessageS3Pointer& s3Pointer, const Aws::String& sqsReceiptHandle) const;
       virtual bool IsLargeMessage (const Model::SendMessageRequest& request) const;
       virtual bool IsLargeMessageBatch (const Model::SendMessageBatchRequestEntry& request) const;
-      virtual Model::SendMessageRequest StoreMessageInS3 (const Model::SendMessageRequest& request) const;
-      virtual Model::SendMessageBatchRequestEntry StoreMessageBatchInS3 (const Model::SendMessageBatchRequestEntry& request) const;
+      virtual bool StoreMessageInS3 (const Model::SendMessageRequest& request, Model::SendMessageRequest& reqWithS3Support) const;
+      virtual bool StoreMessageBatchInS3 (const Model::SendMessageBatchRequestEntry& request, Model::SendMessageBatchRequestEntry& reqWithS3Support) const;
+      virtual bool CompressMessageInline (const Model::SendMessageRequest& request, Model::SendMessageRequest& reqWithInlineSupport) const;
+      virtual bool CompressMessageBatchInline (const Model::SendMessageBatchRequestEntry& request, Model::SendMessageBatchRequestEntry& reqWithInlineSupport) const;
+      virtual bool EncodeMessageBodyInline (const Aws::String& body, const Aws::Map<Aws::String, Model::MessageAttributeValue>& messageAttributes, Aws::String& inlineBody) const;
+      virtual bool DecodeMessageBodyInline (const Aws::String& inlineBody, const Aws::String& codecName, Aws::String& body) const;
+      virtual Aws::Vector<size_t> PlanMessageBatchOffload (const Aws::Vector<Model::SendMessageBatchRequestEntry>& entries) const;
+      virtual Model::SendMessageBatchOutcome SendMessageBatchWithinLimit (const Model::SendMessageBatchRequest& request) const;
+      virtual Model::SendMessageBatchOutcome SendMessageBatchPipelined (const Model::SendMessageBatchRequest& request, const Aws::Vector<size_t>& largeEntries) const;
+      virtual bool StoreMessageBatchPackInS3 (const Aws::Vector<const Model::SendMessageBatchRequestEntry*>& requests, Aws::Vector<Model::SendMessageBatchRequestEntry>& reqsWithS3Support) const;
+      virtual bool StoreMessageBodyInS3 (const Aws::String& body, SQSLargeMessageS3Pointer& s3Pointer) const;
+      virtual Aws::String SerializeS3Pointer (const SQSLargeMessageS3Pointer& s3Pointer) const;
+      virtual void LoadPayloadsFromS3 (const Aws::Vector<SQSLargeMessageS3Pointer>& s3Pointers, Aws::Vector<Aws::String>& payloads, Aws::Vector<char>& isLoaded) const;
+      virtual bool LoadPayloadFromS3 (const SQSLargeMessageS3Pointer& s3Pointer, Aws::String& payload) const;
+      virtual bool LoadRangedPayloadFromS3 (const SQSLargeMessageS3Pointer& s3Pointer, Aws::String& payload) const;
+      virtual bool DownloadPayloadFromS3 (const SQSLargeMessageS3Pointer& s3Pointer, const Aws::IOStreamFactory& streamFactory) const;
+      virtual bool LoadPackedPayloadsFromS3 (const Aws::Vector<SQSLargeMessageS3Pointer>& s3Pointers, const Aws::Vector<size_t>& packed, Aws::Vector<Aws::String>& payloads) const;
+      virtual bool StoreSharedPayloadInS3 (const Aws::String& s3Key, const char* payload, size_t length) const;
+      virtual void DeletePayloadFromS3 (const Aws::String& s3BucketName, const Aws::String& s3Key) const;
+      virtual Aws::Vector<Aws::S3::Model::Error> DeletePayloadsFromS3 (const Aws::String& s3BucketName, const Aws::Vector<Aws::String>& s3Keys) const;
+      virtual bool StorePayloadInS3 (const Aws::String& s3Key, const char* payload, size_t length) const;
+      virtual bool StoreMultipartPayloadInS3 (const Aws::String& s3Key, const char* payload, size_t length) const;
 
     public:
+      /**
+       * Queue operations go through sqsclient, payloads through the s3 client of sqsconfig. The s3 and async thread
+       * pools are sized from sqsconfig here, later changes to their concurrency only bound how much of them is used.
+       */
       SQSExtendedClient (const std::shared_ptr<SQSClient>& sqsclient, const std::shared_ptr<SQSExtendedClientConfiguration>& sqsconfig);
 
+      /**
+       * Waits for every Async and Callable operation already submitted, queued ones included, so that each handler
+       * is called and each future gets its outcome. Must not be reached from one of those handlers.
+       */
+      virtual ~SQSExtendedClient ();
+
       virtual Model::SendMessageOutcome SendMessage (const Model::SendMessageRequest& request) const;
       virtual Model::ReceiveMessageOutcome ReceiveMessage(const Model::ReceiveMessageRequest& request) const;
       virtual Model::DeleteMessageOutcome DeleteMessage(const Model::DeleteMessageRequest& request) const;
       virtual Model::SendMessageBatchOutcome SendMessageBatch(const Model::SendMessageBatchRequest& request) const;
       virtual Model::DeleteMessageBatchOutcome DeleteMessageBatch(const Model::DeleteMessageBatchRequest& request) const;
 
+      /**
+       * Take the receipt handles returned by ReceiveMessage, payload pointers included, and pass sqs its own handle.
+       */
+      virtual Model::ChangeMessageVisibilityOutcome ChangeMessageVisibility(const Model::ChangeMessageVisibilityRequest& request) const;
+      virtual Model::ChangeMessageVisibilityBatchOutcome ChangeMessageVisibilityBatch(const Model::ChangeMessageVisibilityBatchRequest& request) const;
+
+      /**
+       * Take any number of entries, sent as batches of ten through SendMessageBatch or DeleteMessageBatch, up to
+       * SQSExtendedClientConfiguration::GetAsyncThreadPoolSize batches at a time. Entry ids must be unique across the
+       * request, the results of every batch are merged in one outcome, which is an error only when no batch went
+       * through.
+       */
+      virtual Model::SendMessageBatchOutcome SendMessageBulk (const Model::SendMessageBatchRequest& request) const;
+      virtual Model::DeleteMessageBatchOutcome DeleteMessageBulk (const Model::DeleteMessageBatchRequest& request) const;
+
+      /**
+       * Asynchronous variants of the operations above, with the same s3 handling. Each one runs the blocking
+       * operation on a bounded pool of SQSExtendedClientConfiguration::GetAsyncThreadPoolSize threads owned by the
+       * client: a request in flight holds one thread for its whole s3 and sqs round trip, and requests beyond the
+       * pool size wait in its queue. The sdk http client blocks its caller, so there is no callback to chain the
+       * s3 and sqs steps on.
+       */
+      virtual void SendMessageAsync (const Model::SendMessageRequest& request, const SendMessageResponseReceivedHandler& handler,
+                                     const std::shared_ptr<const Aws::Client::AsyncCallerContext>& context = nullptr) const;
+      virtual Model::SendMessageOutcomeCallable SendMessageCallable (const Model::SendMessageRequest& request) const;
+
+      virtual void ReceiveMessageAsync (const Model::ReceiveMessageRequest& request, const ReceiveMessageResponseReceivedHandler& handler,
+                                        const std::shared_ptr<const Aws::Client::AsyncCallerContext>& context = nullptr) const;
+      virtual Model::ReceiveMessageOutcomeCallable ReceiveMessageCallable (const Model::ReceiveMessageRequest& request) const;
+
+      virtual void DeleteMessageAsync (const Model::DeleteMessageRequest& request, const DeleteMessageResponseReceivedHandler& handler,
+                                       const std::shared_ptr<const Aws::Client::AsyncCallerContext>& context = nullptr) const;
+      virtual Model::DeleteMessageOutcomeCallable DeleteMessageCallable (const Model::DeleteMessageRequest& request) const;
+
+      virtual void SendMessageBatchAsync (const Model::SendMessageBatchRequest& request, const SendMessageBatchResponseReceivedHandler& handler,
+                                          const std::shared_ptr<const Aws::Client::AsyncCallerContext>& context = nullptr) const;
+      virtual Model::SendMessageBatchOutcomeCallable SendMessageBatchCallable (const Model::SendMessageBatchRequest& request) const;
+
+      virtual void DeleteMessageBatchAsync (const Model::DeleteMessageBatchRequest& request, const DeleteMessageBatchResponseReceivedHandler& handler,
+                                            const std::shared_ptr<const Aws::Client::AsyncCallerContext>& context = nullptr) const;
+      virtual Model::DeleteMessageBatchOutcomeCallable DeleteMessageBatchCallable (const Model::DeleteMessageBatchRequest& request) const;
+
+      virtual void ChangeMessageVisibilityAsync (const Model::ChangeMessageVisibilityRequest& request, const ChangeMessageVisibilityResponseReceivedHandler& handler,
+                                                 const std::shared_ptr<const Aws::Client::AsyncCallerContext>& context = nullptr) const;
+      virtual Model::ChangeMessageVisibilityOutcomeCallable ChangeMessageVisibilityCallable (const Model::ChangeMessageVisibilityRequest& request) const;
+
+      virtual void ChangeMessageVisibilityBatchAsync (const Model::ChangeMessageVisibilityBatchRequest& request, const ChangeMessageVisibilityBatchResponseReceivedHandler& handler,
+                                                      const std::shared_ptr<const Aws::Client::AsyncCallerContext>& context = nullptr) const;
+      virtual Model::ChangeMessageVisibilityBatchOutcomeCallable ChangeMessageVisibilityBatchCallable (const Model::ChangeMessageVisibilityBatchRequest& request) const;
+
+      /**
+       * Body handle of a message received with lazy payload loading, which fetches from s3 only when read. The
+       * handle uses this client and must not outlive it.
+       */
+      virtual std::shared_ptr<SQSLazyPayload> GetLazyPayload (const Model::Message& message) const;
+
+      /**
+       * Replaces the pointer left in a lazily received message by its payload, as an eager receive would have.
+       */
+      virtual bool HydrateMessage (Model::Message& message) const;
+
+      /**
+       * Size of the payload a lazily received message still has in s3, 0 when its body is already complete.
+       */
+      virtual size_t GetPendingPayloadSize (const Model::Message& message) const;
+
     };
 
     } // namespace extendedLib
@@ -14,6 +14,10 @@
  */
 #pragma once
 #include <aws/s3/S3Client.h>
+#include <aws/core/utils/memory/stl/AWSMap.h>
+#include <aws/sqs/extendedlib/SQSPayloadCodec.h>
+#include <aws/sqs/extendedlib/SQSS3KeyGenerator.h>
+#include <aws/sqs/extendedlib/SQSS3PayloadReaper.h>
 
 namespace Aws
 {
@@ -31,6 +35,27 @@ namespace Aws
         unsigned m_messageSizeThreshold;
         bool m_largePayloadSupport;
         bool m_alwaysThroughS3;
+        bool m_inlineCompression;
+        bool m_payloadDeduplication;
+        bool m_batchPacking;
+        bool m_lazyPayloadLoading;
+        bool m_batchPipelining;
+        bool m_compactS3Pointer;
+        bool m_receiptHandleEnvelope;
+        unsigned m_payloadDeduplicationCacheSize;
+        unsigned m_payloadDeduplicationMaxAge;
+        unsigned m_payloadDeduplicationSafetyMargin;
+        unsigned m_s3MaxConcurrency;
+        unsigned m_asyncThreadPoolSize;
+        unsigned m_multipartUploadThreshold;
+        unsigned m_multipartUploadPartSize;
+        unsigned m_s3MaxRetries;
+        unsigned m_rangedDownloadThreshold;
+        unsigned m_rangedDownloadPartSize;
+        std::shared_ptr<SQSPayloadCodec> m_payloadCodec;
+        Aws::Map<Aws::String, std::shared_ptr<SQSPayloadCodec> > m_payloadCodecs;
+        std::shared_ptr<SQSS3KeyGenerator> m_s3KeyGenerator;
+        std::shared_ptr<SQSS3PayloadReaper> m_s3PayloadReaper;
 
       public:
         SQSExtendedClientConfiguration ();
@@ -44,10 +69,107 @@ namespace Aws
         virtual void SetAlwaysThroughS3Disabled ();
         virtual bool IsAlwaysThroughS3 () const;
 
+        // Large bodies that compress under the threshold are sent inline, deflated and base64 encoded
+        virtual void SetInlineCompressionEnabled ();
+        virtual void SetInlineCompressionDisabled ();
+        virtual bool IsInlineCompressionEnabled () const;
+
+        // Payloads are keyed by their SHA-256 and uploaded once. Shared objects are never deleted by the
+        // client, a lifecycle rule on the bucket has to expire them
+        virtual void SetPayloadDeduplicationEnabled ();
+        virtual void SetPayloadDeduplicationDisabled ();
+        virtual bool IsPayloadDeduplicationEnabled () const;
+
+        // Payloads offloaded by one SendMessageBatch go to a single object, each message pointing at its range.
+        // Like deduplicated ones, packed objects are left to a lifecycle rule on the bucket. Ignored when
+        // payload deduplication is enabled
+        virtual void SetBatchPackingEnabled ();
+        virtual void SetBatchPackingDisabled ();
+        virtual bool IsBatchPackingEnabled () const;
+
+        // ReceiveMessage leaves payloads in s3, they are read through SQSExtendedClient::GetLazyPayload
+        // or SQSExtendedClient::HydrateMessage
+        virtual void SetLazyPayloadLoadingEnabled ();
+        virtual void SetLazyPayloadLoadingDisabled ();
+        virtual bool IsLazyPayloadLoadingEnabled () const;
+
+        // SendMessageBatch sends the entries kept inline right away, offloaded ones follow in further batches as
+        // their uploads complete and all results come back in one outcome. Ignored when batch packing is in effect
+        virtual void SetBatchPipeliningEnabled ();
+        virtual void SetBatchPipeliningDisabled ();
+        virtual bool IsBatchPipeliningEnabled () const;
+
+        // Offloaded messages carry their s3 pointer in the compact form instead of json. Receivers read both, but
+        // consumers running an older release only read json, so it should be enabled once all of them are upgraded
+        virtual void SetCompactS3PointerEnabled ();
+        virtual void SetCompactS3PointerDisabled ();
+        virtual bool IsCompactS3PointerEnabled () const;
+
+        // Received large messages get their receipt handle in the length prefixed envelope instead of between
+        // markers. Deletes read both, but consumers running an older release only read markers
+        virtual void SetReceiptHandleEnvelopeEnabled ();
+        virtual void SetReceiptHandleEnvelopeDisabled ();
+        virtual bool IsReceiptHandleEnvelopeEnabled () const;
+
+        virtual void SetPayloadDeduplicationCacheSize (unsigned payloadDeduplicationCacheSize);
+        virtual unsigned GetPayloadDeduplicationCacheSize () const;
+
+        // Age in seconds past which a stored payload is uploaded again, must stay under the lifecycle expiry
+        virtual void SetPayloadDeduplicationMaxAge (unsigned payloadDeduplicationMaxAge);
+        virtual unsigned GetPayloadDeduplicationMaxAge () const;
+
+        // Seconds of max age a stored payload must have left to be reused, so that a message sent right before the
+        // max age still has this long to be received before its payload is uploaded again or expires
+        virtual void SetPayloadDeduplicationSafetyMargin (unsigned payloadDeduplicationSafetyMargin);
+        virtual unsigned GetPayloadDeduplicationSafetyMargin () const;
+
         virtual std::shared_ptr<Aws::S3::S3Client> GetS3Client () const;
         virtual Aws::String GetS3BucketName () const;
         virtual unsigned GetMessageSizeThreshold () const;
 
+        // S3 requests a client runs at once. Its thread pool is sized when the client is created, raising this
+        // afterwards does not add threads
+        virtual void SetS3MaxConcurrency (unsigned s3MaxConcurrency);
+        virtual unsigned GetS3MaxConcurrency () const;
+
+        // Size of the thread pool running the Async and Callable operations of a client, each request holds one of
+        // its threads until done and further requests wait in its queue. Read when the client is created
+        virtual void SetAsyncThreadPoolSize (unsigned asyncThreadPoolSize);
+        virtual unsigned GetAsyncThreadPoolSize () const;
+
+        virtual void SetMultipartUploadThreshold (unsigned multipartUploadThreshold);
+        virtual unsigned GetMultipartUploadThreshold () const;
+
+        virtual void SetMultipartUploadPartSize (unsigned multipartUploadPartSize);
+        virtual unsigned GetMultipartUploadPartSize () const;
+
+        virtual void SetS3MaxRetries (unsigned s3MaxRetries);
+        virtual unsigned GetS3MaxRetries () const;
+
+        // Raw payloads from this size on are downloaded as concurrent ranged gets, each retried on its own
+        virtual void SetRangedDownloadThreshold (unsigned rangedDownloadThreshold);
+        virtual unsigned GetRangedDownloadThreshold () const;
+
+        virtual void SetRangedDownloadPartSize (unsigned rangedDownloadPartSize);
+        virtual unsigned GetRangedDownloadPartSize () const;
+
+        // Codec applied to payloads stored in s3, nullptr (the default) stores them raw
+        virtual void SetPayloadCodec (const std::shared_ptr<SQSPayloadCodec>& payloadCodec);
+        virtual std::shared_ptr<SQSPayloadCodec> GetPayloadCodec () const;
+
+        // Codecs able to decode received payloads, deflate is always known
+        virtual void AddPayloadCodec (const std::shared_ptr<SQSPayloadCodec>& payloadCodec);
+        virtual std::shared_ptr<SQSPayloadCodec> GetPayloadCodec (const Aws::String& name) const;
+
+        // Names the payload objects, uuid v4 keys without prefix by default
+        virtual void SetS3KeyGenerator (const std::shared_ptr<SQSS3KeyGenerator>& s3KeyGenerator);
+        virtual std::shared_ptr<SQSS3KeyGenerator> GetS3KeyGenerator () const;
+
+        // Deletes acknowledge the messages to sqs first and leave their payload to the reaper, nullptr (the default)
+        // deletes payloads before the message
+        virtual void SetS3PayloadReaper (const std::shared_ptr<SQSS3PayloadReaper>& s3PayloadReaper);
+        virtual std::shared_ptr<SQSS3PayloadReaper> GetS3PayloadReaper () const;
+
       };
 
     } // namespace extendedLib
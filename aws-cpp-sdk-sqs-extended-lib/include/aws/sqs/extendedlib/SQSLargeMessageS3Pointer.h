@@ -40,6 +40,12 @@ namespace Aws
         bool m_s3BucketNameHasBeenSet;
         Aws::String m_s3Key;
         bool m_s3KeyHasBeenSet;
+        Aws::String m_codec;
+        bool m_codecHasBeenSet;
+        long long m_s3Offset;
+        bool m_s3OffsetHasBeenSet;
+        long long m_s3Length;
+        bool m_s3LengthHasBeenSet;
 
       public:
         SQSLargeMessageS3Pointer ();
@@ -47,6 +53,9 @@ namespace Aws
         SQSLargeMessageS3Pointer& operator= (const Aws::Utils::Json::JsonValue& jsonValue);
         Aws::Utils::Json::JsonValue Jsonize () const;
 
+        // The compact form read by SQSLargeMessageS3PointerView, much cheaper than the json one on both ends
+        Aws::String Serialize () const;
+
         inline const Aws::String& GetS3BucketName () const
         {
           return m_s3BucketName;
@@ -123,6 +132,85 @@ namespace Aws
           return *this;
         }
 
+        inline const Aws::String& GetCodec () const
+        {
+          return m_codec;
+        }
+
+        inline void SetCodec (const Aws::String& codec)
+        {
+          m_codecHasBeenSet = true;
+          m_codec = codec;
+        }
+        inline void SetCodec (Aws::String&& codec)
+        {
+          m_codecHasBeenSet = true;
+          m_codec = codec;
+        }
+        inline void SetCodec (const char* codec)
+        {
+          m_codecHasBeenSet = true;
+          m_codec.assign (codec);
+        }
+
+        inline SQSLargeMessageS3Pointer& WithCodec (const Aws::String& codec)
+        {
+          SetCodec (codec);
+          return *this;
+        }
+
+        inline SQSLargeMessageS3Pointer& WithCodec (Aws::String&& codec)
+        {
+          SetCodec (codec);
+          return *this;
+        }
+
+        inline SQSLargeMessageS3Pointer& WithCodec (const char* codec)
+        {
+          SetCodec (codec);
+          return *this;
+        }
+
+        // Position of the payload inside an object shared by a whole batch, unset when it owns the object
+        inline long long GetS3Offset () const
+        {
+          return m_s3Offset;
+        }
+
+        inline void SetS3Offset (long long s3Offset)
+        {
+          m_s3OffsetHasBeenSet = true;
+          m_s3Offset = s3Offset;
+        }
+
+        inline SQSLargeMessageS3Pointer& WithS3Offset (long long s3Offset)
+        {
+          SetS3Offset (s3Offset);
+          return *this;
+        }
+
+        inline long long GetS3Length () const
+        {
+          return m_s3Length;
+        }
+
+        inline bool S3LengthHasBeenSet () const
+        {
+          return m_s3LengthHasBeenSet;
+        }
+
+        inline void SetS3Length (long long s3Length)
+        {
+          m_s3LengthHasBeenSet = true;
+          m_s3Length = s3Length;
+        }
+
+        inline SQSLargeMessageS3Pointer& WithS3Length (long long s3Length)
+        {
+          SetS3Length (s3Length);
+          return *this;
+        }
+
       };
 
     } // namespace Model
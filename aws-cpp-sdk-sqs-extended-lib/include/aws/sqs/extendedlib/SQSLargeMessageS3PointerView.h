@@ -0,0 +1,103 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/sqs/extendedlib/SQSLargeMessageS3Pointer.h>
+#include <aws/sqs/extendedlib/SQSStringView.h>
+#include <aws/sqs/SQS_EXPORTS.h>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * The fields of an s3 pointer read in place from a message body, without allocating. Two forms are read:
+       *
+       *   the compact one, SQSLargeMessageS3Pointer::Serialize, a version tag followed by length prefixed strings
+       *     "SQSS3P/1 <n>:<bucket> <n>:<key> <n>:<codec> <offset> <length>", "-" standing for an unset offset or length
+       *   the json one written by SQSLargeMessageS3Pointer::Jsonize, as long as none of its strings is escaped
+       *
+       * Anything else fails to parse, json bodies then have to go through a JsonValue.
+       */
+      class AWS_SQS_API SQSLargeMessageS3PointerView
+      {
+
+      private:
+        SQSStringView m_s3BucketName;
+        SQSStringView m_s3Key;
+        SQSStringView m_codec;
+        long long m_s3Offset;
+        bool m_s3OffsetHasBeenSet;
+        long long m_s3Length;
+        bool m_s3LengthHasBeenSet;
+
+        bool ParseCompact (const SQSStringView& body);
+        bool ParseJson (const SQSStringView& body);
+
+      public:
+        // Starts the compact form, a new version of it gets a new tag
+        static const char* COMPACT_FORM_TAG;
+
+        SQSLargeMessageS3PointerView ();
+
+        /**
+         * Reads the pointer held by body, which the view borrows from and must outlive it.
+         */
+        bool Parse (const SQSStringView& body);
+
+        inline const SQSStringView& GetS3BucketName () const
+        {
+          return m_s3BucketName;
+        }
+
+        inline const SQSStringView& GetS3Key () const
+        {
+          return m_s3Key;
+        }
+
+        inline const SQSStringView& GetCodec () const
+        {
+          return m_codec;
+        }
+
+        inline long long GetS3Offset () const
+        {
+          return m_s3Offset;
+        }
+
+        inline bool S3OffsetHasBeenSet () const
+        {
+          return m_s3OffsetHasBeenSet;
+        }
+
+        inline long long GetS3Length () const
+        {
+          return m_s3Length;
+        }
+
+        inline bool S3LengthHasBeenSet () const
+        {
+          return m_s3LengthHasBeenSet;
+        }
+
+        SQSLargeMessageS3Pointer ToS3Pointer () const;
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/core/AmazonWebServiceRequest.h>
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/sqs/extendedlib/SQSLargeMessageS3Pointer.h>
+#include <aws/sqs/SQS_EXPORTS.h>
+#include <functional>
+#include <mutex>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * Body of a message received without its payload. Nothing is fetched from s3 until the body or a
+       * range of it is asked for, and the whole body is fetched at most once.
+       */
+      class AWS_SQS_API SQSLazyPayload
+      {
+
+      public:
+        // fills payload with what the pointer designates, a range when it carries a length
+        typedef std::function<bool (const SQSLargeMessageS3Pointer& s3Pointer, Aws::String& payload)> Loader;
+        // writes the payload the pointer designates to a stream made by the factory
+        typedef std::function<bool (const SQSLargeMessageS3Pointer& s3Pointer,
+                                    const Aws::IOStreamFactory& streamFactory)> StreamLoader;
+
+      private:
+        SQSLargeMessageS3Pointer m_s3Pointer;
+        long long m_size;
+        bool m_isOffloaded;
+        Loader m_loader;
+        StreamLoader m_streamLoader;
+        Aws::String m_body;
+        bool m_isLoaded;
+        std::mutex m_mutex;
+
+      public:
+        // a payload that was sent inline, already at hand
+        SQSLazyPayload (const Aws::String& body);
+        // a payload of size bytes stored in s3
+        SQSLazyPayload (const SQSLargeMessageS3Pointer& s3Pointer, long long size, const Loader& loader,
+                        const StreamLoader& streamLoader = StreamLoader ());
+
+        virtual bool IsOffloaded () const;
+        virtual long long GetSize () const;
+        virtual const SQSLargeMessageS3Pointer& GetS3Pointer () const;
+
+        virtual bool IsLoaded ();
+
+        /**
+         * Fetches the whole payload unless already done. Returns false when it could not be fetched.
+         */
+        virtual bool Load ();
+
+        /**
+         * The whole payload, fetched on first access. Empty when it could not be fetched.
+         */
+        virtual const Aws::String& GetBody ();
+
+        /**
+         * Reads up to length bytes from offset. Payloads stored raw are read with a ranged get unless already
+         * loaded, encoded ones have to be loaded as a whole first.
+         */
+        virtual bool Read (long long offset, long long length, Aws::String& payload);
+
+        /**
+         * Writes the whole payload to a stream made by streamFactory, a file or a pre-sized buffer, without
+         * keeping it in memory. The stream is deleted once written, which closes a file. Encoded payloads only
+         * hold their encoded bytes in memory while decoding.
+         */
+        virtual bool Download (const Aws::IOStreamFactory& streamFactory);
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/core/utils/memory/stl/AWSStreamFwd.h>
+#include <ostream>
+#include <aws/sqs/SQS_EXPORTS.h>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * Transforms a payload before it is stored in s3 and back when it is received. The name is
+       * recorded in the s3 pointer of every message it encoded, so it must never change.
+       */
+      class AWS_SQS_API SQSPayloadCodec
+      {
+
+      public:
+        virtual ~SQSPayloadCodec ()
+        {
+        }
+
+        virtual const char* GetName () const = 0;
+
+        /**
+         * Encodes length bytes of payload into encoded. Returns false when the payload is better
+         * stored as is, for instance when it does not shrink.
+         */
+        virtual bool Encode (const char* payload, size_t length, Aws::String& encoded) const = 0;
+
+        /**
+         * Decodes the whole encoded stream, appending to payload as it reads.
+         */
+        virtual bool Decode (Aws::IStream& encoded, Aws::String& payload) const = 0;
+
+        /**
+         * Decodes the whole encoded stream into payload. Codecs able to decode chunk by chunk should
+         * override it, by default the payload is decoded in memory and written at once.
+         */
+        virtual bool Decode (Aws::IStream& encoded, Aws::OStream& payload) const
+        {
+          Aws::String decoded;
+          if (!Decode (encoded, decoded))
+          {
+            return false;
+          }
+          payload.write (decoded.c_str (), static_cast<std::streamsize> (decoded.size ()));
+          return payload.good ();
+        }
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
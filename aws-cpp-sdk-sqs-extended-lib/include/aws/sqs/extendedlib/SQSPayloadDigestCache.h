@@ -0,0 +1,64 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/core/utils/memory/stl/AWSList.h>
+#include <aws/core/utils/memory/stl/AWSMap.h>
+#include <aws/sqs/SQS_EXPORTS.h>
+#include <chrono>
+#include <mutex>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * Thread-safe, bounded LRU set of payload objects known to be stored in s3. The least recently
+       * seen entry is dropped once the capacity is reached, and entries whose object is older than maxAge
+       * are ignored so that objects close to their lifecycle expiry get stored again.
+       */
+      class AWS_SQS_API SQSPayloadDigestCache
+      {
+
+      private:
+        typedef std::chrono::steady_clock Clock;
+        typedef std::pair<Aws::String, Clock::time_point> Entry;
+        typedef Aws::List<Entry> RecencyList;
+
+        size_t m_capacity;
+        Clock::duration m_maxAge;
+        RecencyList m_recency;
+        Aws::Map<Aws::String, RecencyList::iterator> m_entries;
+        std::mutex m_mutex;
+
+      public:
+        SQSPayloadDigestCache (size_t capacity, std::chrono::seconds maxAge);
+
+        virtual bool Contains (const Aws::String& s3Key);
+        virtual void Add (const Aws::String& s3Key);
+
+        /**
+         * Adds an object stored age ago, as found in s3, so it is not kept past maxAge from when it was stored.
+         */
+        virtual void Add (const Aws::String& s3Key, std::chrono::milliseconds age);
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
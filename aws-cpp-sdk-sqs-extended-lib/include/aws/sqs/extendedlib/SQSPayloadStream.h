@@ -0,0 +1,92 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/core/utils/memory/stl/AWSStreamFwd.h>
+#include <aws/sqs/SQS_EXPORTS.h>
+#include <streambuf>
+#include <iostream>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * Read-only, seekable stream buffer over memory owned by someone else. Nothing is copied, the
+       * buffer must outlive every stream reading from it.
+       */
+      class AWS_SQS_API SQSPayloadStreamBuf : public std::streambuf
+      {
+
+      public:
+        SQSPayloadStreamBuf (const char* payload, size_t length);
+
+      protected:
+        virtual pos_type seekoff (off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which =
+                                      std::ios_base::in | std::ios_base::out);
+        virtual pos_type seekpos (pos_type pos, std::ios_base::openmode which = std::ios_base::in | std::ios_base::out);
+
+      };
+
+      /**
+       * IOStream view of a payload, suitable as the body of an s3 request without duplicating the bytes.
+       */
+      class AWS_SQS_API SQSPayloadStream : public Aws::IOStream
+      {
+
+      private:
+        SQSPayloadStreamBuf m_streamBuf;
+
+      public:
+        SQSPayloadStream (const char* payload, size_t length);
+
+      };
+
+      /**
+       * Write-only stream buffer over a fixed region owned by someone else, such as one slot of a pre-sized
+       * buffer. Writing past the end of the region fails.
+       */
+      class AWS_SQS_API SQSPayloadRegionBuf : public std::streambuf
+      {
+
+      public:
+        SQSPayloadRegionBuf (char* region, size_t length);
+
+      protected:
+        virtual pos_type seekoff (off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which =
+                                      std::ios_base::in | std::ios_base::out);
+        virtual pos_type seekpos (pos_type pos, std::ios_base::openmode which = std::ios_base::in | std::ios_base::out);
+
+      };
+
+      /**
+       * IOStream writing in place into a region, suitable as the response stream of an s3 request.
+       */
+      class AWS_SQS_API SQSPayloadRegionStream : public Aws::IOStream
+      {
+
+      private:
+        SQSPayloadRegionBuf m_streamBuf;
+
+      public:
+        SQSPayloadRegionStream (char* region, size_t length);
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
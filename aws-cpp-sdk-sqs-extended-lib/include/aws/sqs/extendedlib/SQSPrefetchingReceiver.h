@@ -0,0 +1,109 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/core/utils/memory/stl/AWSDeque.h>
+#include <aws/core/utils/memory/stl/AWSVector.h>
+#include <aws/sqs/model/ReceiveMessageRequest.h>
+#include <aws/sqs/model/Message.h>
+#include <aws/sqs/SQSClient.h>
+#include <aws/sqs/SQS_EXPORTS.h>
+#include <aws/sqs/extendedlib/SQSExtendedClient.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * Keeps long polling a queue in the background, payloads already fetched from s3 by the extended client,
+       * so that Next usually returns straight from memory. Every poller takes its share of maxBufferedMessages
+       * before receiving, and receiving stops while the buffer holds maxBufferedBytes of bodies.
+       *
+       * Payloads fetched by an eager receive count once fetched, so one receive can go past maxBufferedBytes. Given
+       * an extended client with lazy payload loading, the receiver fetches them itself, only once their bytes fit.
+       *
+       * A message is only handed out while its visibility timeout still has visibilityMargin seconds to run,
+       * older ones are dropped and become visible again on the queue. The timeout is the one of the request,
+       * or visibilityTimeout when the request leaves it to the queue.
+       */
+      class AWS_SQS_API SQSPrefetchingReceiver
+      {
+
+      private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct BufferedMessage
+        {
+          Model::Message message;
+          Clock::time_point deadline;
+        };
+
+        std::shared_ptr<SQSClient> m_sqsClient;
+        std::shared_ptr<SQSExtendedClient> m_extendedClient;
+        Model::ReceiveMessageRequest m_request;
+        unsigned m_maxBufferedMessages;
+        size_t m_maxBufferedBytes;
+        Clock::duration m_visibleFor;
+
+        Aws::Deque<BufferedMessage> m_buffer;
+        size_t m_bufferedBytes;
+        size_t m_reservedMessages;
+        size_t m_reservedBytes;
+        size_t m_droppedMessages;
+        bool m_shutdown;
+        std::mutex m_mutex;
+        std::condition_variable m_messageAvailable;
+        std::condition_variable m_roomAvailable;
+        Aws::Vector<std::thread> m_pollers;
+
+        void Poll ();
+        size_t GetReceiveSize () const;
+        bool HasRoom () const;
+        bool HasRoomFor (size_t payloadBytes) const;
+        bool Hydrate (Aws::Vector<Model::Message>& messages, Clock::time_point deadline, size_t& payloadBytes);
+        void DropExpired (Clock::time_point now);
+
+      public:
+        SQSPrefetchingReceiver (const std::shared_ptr<SQSClient>& sqsClient, const Model::ReceiveMessageRequest& request,
+                                unsigned maxBufferedMessages = 100, size_t maxBufferedBytes = 64 * 1024 * 1024,
+                                unsigned pollers = 1, unsigned visibilityTimeout = 30, unsigned visibilityMargin = 5);
+
+        virtual ~SQSPrefetchingReceiver ();
+
+        /**
+         * Waits up to timeout for a message. Returns false when none arrived in time or after Shutdown.
+         */
+        virtual bool Next (Model::Message& message, std::chrono::milliseconds timeout);
+
+        /**
+         * Stops polling and waits for the pollers, which may take as long as an outstanding long poll. Buffered
+         * messages are not handed out anymore and become visible again once their timeout runs out.
+         */
+        virtual void Shutdown ();
+
+        virtual size_t GetBufferedMessages ();
+        virtual size_t GetDroppedMessages ();
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/sqs/extendedlib/SQSStringView.h>
+#include <aws/sqs/SQS_EXPORTS.h>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * The parts of a receipt handle handed out for a large message, read in place in a single pass. Two forms
+       * are read:
+       *
+       *   the envelope, a version tag followed by length prefixed strings and the handle sqs issued
+       *     "SQSRH/1 <n>:<bucket> <n>:<key> <receipt handle>"
+       *   the marker one, "-..s3BucketName..-<bucket>-..s3BucketName..--..s3Key..-<key>-..s3Key..-<receipt handle>",
+       *     which breaks when the bucket or the key holds a marker
+       *
+       * Any other handle, a malformed envelope included, is taken as issued by sqs.
+       */
+      class AWS_SQS_API SQSReceiptHandleView
+      {
+
+      private:
+        SQSStringView m_s3BucketName;
+        SQSStringView m_s3Key;
+        SQSStringView m_sqsReceiptHandle;
+        bool m_isExtended;
+
+        bool ParseEnvelope (const SQSStringView& receiptHandle);
+        bool ParseMarkers (const SQSStringView& receiptHandle);
+
+      public:
+        // Starts the envelope, a new version of it gets a new tag
+        static const char* ENVELOPE_TAG;
+        static const char* S3_BUCKET_NAME_MARKER;
+        static const char* S3_KEY_MARKER;
+
+        /**
+         * Wraps the handle sqs issued for a message along with where its payload is.
+         */
+        static Aws::String Envelope (const Aws::String& s3BucketName, const Aws::String& s3Key,
+                                     const Aws::String& sqsReceiptHandle);
+
+        /**
+         * Same in the marker form, for consumers running an older release.
+         */
+        static Aws::String EmbedWithMarkers (const Aws::String& s3BucketName, const Aws::String& s3Key,
+                                             const Aws::String& sqsReceiptHandle);
+
+        SQSReceiptHandleView ();
+
+        /**
+         * Reads receiptHandle, which the view borrows from and must outlive it. Returns whether it points at a
+         * payload, the handle to pass sqs is set either way.
+         */
+        bool Parse (const SQSStringView& receiptHandle);
+
+        inline bool IsExtended () const
+        {
+          return m_isExtended;
+        }
+
+        inline const SQSStringView& GetS3BucketName () const
+        {
+          return m_s3BucketName;
+        }
+
+        inline const SQSStringView& GetS3Key () const
+        {
+          return m_s3Key;
+        }
+
+        inline const SQSStringView& GetSQSReceiptHandle () const
+        {
+          return m_sqsReceiptHandle;
+        }
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
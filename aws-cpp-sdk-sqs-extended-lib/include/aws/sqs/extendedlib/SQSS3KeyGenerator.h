@@ -0,0 +1,53 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/sqs/SQS_EXPORTS.h>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * Names the s3 objects holding offloaded payloads. Implementations are called concurrently
+       * from every sending thread.
+       */
+      class AWS_SQS_API SQSS3KeyGenerator
+      {
+
+      public:
+        virtual ~SQSS3KeyGenerator ()
+        {
+        }
+
+        /**
+         * Returns a key no other call, on any thread or process, will return.
+         */
+        virtual Aws::String GenerateKey () const = 0;
+
+        /**
+         * Returns the key for an object whose name is already unique, such as a content hash. The
+         * same name must always give the same key.
+         */
+        virtual Aws::String GenerateKey (const Aws::String& name) const = 0;
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/core/utils/memory/stl/AWSDeque.h>
+#include <aws/core/utils/memory/stl/AWSStreamFwd.h>
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/core/utils/memory/stl/AWSVector.h>
+#include <aws/s3/S3Client.h>
+#include <aws/sqs/SQS_EXPORTS.h>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * Deletes payloads of acknowledged messages in the background, so that s3 stays off the delete path.
+       * Enqueued keys are removed by up to maxConcurrency reapers, each sending multi-object deletes of one bucket,
+       * and keys s3 refused are tried again up to maxRetries times before being given up. A shutdown cuts the
+       * retries short.
+       *
+       * With a log path, every enqueued key is appended to that file and marked once reaped. Keys still pending
+       * when the process stops, and keys given up, are enqueued again by the next reaper opened on the same log.
+       * The log is rewritten with the pending keys alone once the reaped ones outnumber them, so it stays about
+       * as large as the backlog.
+       */
+      class AWS_SQS_API SQSS3PayloadReaper
+      {
+
+      private:
+        struct PendingDelete
+        {
+          Aws::String s3BucketName;
+          Aws::String s3Key;
+        };
+
+        struct Reaper
+        {
+          // what the reaper is deleting, still pending as far as the log goes
+          Aws::Vector<PendingDelete> pendingDeletes;
+          // set by a Shutdown running on the reaper itself, which then returns without touching the reaper
+          bool detached;
+        };
+
+        std::shared_ptr<Aws::S3::S3Client> m_s3Client;
+        unsigned m_maxRetries;
+
+        Aws::Deque<PendingDelete> m_pending;
+        size_t m_reaping;
+        size_t m_reapedDeletes;
+        size_t m_failedDeletes;
+        bool m_shutdown;
+        std::mutex m_mutex;
+        std::condition_variable m_workAvailable;
+        std::condition_variable m_drained;
+        std::condition_variable m_shutdownRequested;
+        Aws::Vector<std::thread> m_reapers;
+        Aws::Vector<std::shared_ptr<Reaper> > m_reaperStates;
+
+        Aws::String m_logPath;
+        Aws::OFStream m_log;
+        Aws::Vector<PendingDelete> m_givenUp;
+        size_t m_reapedLines;
+
+        void Reap (std::shared_ptr<Reaper> reaper);
+        void TakeBatch (Aws::Vector<PendingDelete>& pendingDeletes);
+        void MarkReaped (Aws::Vector<PendingDelete>& pendingDeletes, const Aws::Vector<PendingDelete>& failedDeletes);
+        Aws::Vector<PendingDelete> DeleteFromS3 (const Aws::Vector<PendingDelete>& pendingDeletes) const;
+        void RecoverLog ();
+        void RewriteLog ();
+        void CompactLog ();
+        void WriteLog (char operation, const PendingDelete& pendingDelete);
+
+      public:
+        SQSS3PayloadReaper (const std::shared_ptr<Aws::S3::S3Client>& s3Client, unsigned maxConcurrency = 2,
+                            unsigned maxRetries = 3, const Aws::String& logPath = "");
+
+        virtual ~SQSS3PayloadReaper ();
+
+        /**
+         * Queues the payload for deletion. Returns false after Shutdown, the payload is then left in s3.
+         */
+        virtual bool Enqueue (const Aws::String& s3BucketName, const Aws::String& s3Key);
+
+        /**
+         * Waits until every key enqueued so far has been reaped or given up.
+         */
+        virtual void Flush ();
+
+        /**
+         * Stops accepting keys, drains the ones already queued and waits for the reapers. Called from the s3 client on
+         * a reaper thread, that reaper is detached instead, its keys are left in the log and what the others leave is
+         * deleted from here.
+         */
+        virtual void Shutdown ();
+
+        virtual size_t GetPendingDeletes ();
+        virtual size_t GetReapedDeletes ();
+        virtual size_t GetFailedDeletes ();
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * Characters borrowed from a string that must outlive the view, what the parsers hand out instead of copies.
+       */
+      class SQSStringView
+      {
+
+      private:
+        const char* m_data;
+        size_t m_size;
+
+      public:
+        static const size_t NPOS = static_cast<size_t> (-1);
+
+        SQSStringView () :
+            m_data (""), m_size (0)
+        {
+        }
+
+        SQSStringView (const char* data, size_t size) :
+            m_data (data), m_size (size)
+        {
+        }
+
+        SQSStringView (const char* str) :
+            m_data (str), m_size (std::strlen (str))
+        {
+        }
+
+        SQSStringView (const Aws::String& str) :
+            m_data (str.data ()), m_size (str.size ())
+        {
+        }
+
+        inline const char* GetData () const
+        {
+          return m_data;
+        }
+
+        inline size_t GetSize () const
+        {
+          return m_size;
+        }
+
+        inline bool IsEmpty () const
+        {
+          return m_size == 0;
+        }
+
+        inline char operator[] (size_t pos) const
+        {
+          return m_data[pos];
+        }
+
+        // Characters from pos on, at most count of them, pos past the end gives an empty view
+        inline SQSStringView Substr (size_t pos, size_t count = NPOS) const
+        {
+          if (pos >= m_size)
+          {
+            return SQSStringView (m_data + m_size, 0);
+          }
+          return SQSStringView (m_data + pos, count < m_size - pos ? count : m_size - pos);
+        }
+
+        // Position of the first needle from pos on, NPOS when there is none
+        inline size_t Find (const SQSStringView& needle, size_t pos = 0) const
+        {
+          if (pos > m_size)
+          {
+            return NPOS;
+          }
+          const char* found = std::search (m_data + pos, m_data + m_size, needle.m_data, needle.m_data + needle.m_size);
+          return found == m_data + m_size && needle.m_size > 0 ? NPOS : static_cast<size_t> (found - m_data);
+        }
+
+        inline bool StartsWith (const SQSStringView& prefix) const
+        {
+          return prefix.m_size <= m_size && std::memcmp (m_data, prefix.m_data, prefix.m_size) == 0;
+        }
+
+        inline bool operator== (const SQSStringView& other) const
+        {
+          return m_size == other.m_size && std::memcmp (m_data, other.m_data, m_size) == 0;
+        }
+
+        inline bool operator!= (const SQSStringView& other) const
+        {
+          return !(*this == other);
+        }
+
+        inline Aws::String ToString () const
+        {
+          return Aws::String (m_data, m_size);
+        }
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/sqs/extendedlib/SQSS3KeyGenerator.h>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      enum class SQSS3KeyFormat
+      {
+        UUID_V4,  // fully random
+        UUID_V7   // time ordered, random after the millisecond timestamp
+      };
+
+      enum class SQSS3KeyPrefix
+      {
+        NONE,     // key is used as is
+        HASHED,   // hex digits hashed from the key lead the key, stable for a given name
+        RANDOM    // random hex digits lead generated keys, named keys fall back to HASHED
+      };
+
+      /**
+       * Generates uuid keys from a per thread random generator, so no lock is taken while sending.
+       * A leading prefix spreads time ordered keys across s3 partitions, e.g. "3fa/<uuid>".
+       */
+      class AWS_SQS_API SQSUuidS3KeyGenerator : public SQSS3KeyGenerator
+      {
+
+      private:
+        SQSS3KeyFormat m_format;
+        SQSS3KeyPrefix m_prefix;
+        unsigned m_prefixLength;
+
+        Aws::String PrefixKey (const Aws::String& key, bool isNamed) const;
+
+      public:
+        SQSUuidS3KeyGenerator (SQSS3KeyFormat format = SQSS3KeyFormat::UUID_V4,
+                               SQSS3KeyPrefix prefix = SQSS3KeyPrefix::NONE, unsigned prefixLength = 4);
+
+        virtual Aws::String GenerateKey () const;
+        virtual Aws::String GenerateKey (const Aws::String& name) const;
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#pragma once
+#include <aws/core/utils/memory/stl/AWSDeque.h>
+#include <aws/core/utils/memory/stl/AWSMap.h>
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/core/utils/memory/stl/AWSVector.h>
+#include <aws/sqs/model/ChangeMessageVisibilityRequest.h>
+#include <aws/sqs/model/ChangeMessageVisibilityBatchRequest.h>
+#include <aws/sqs/SQSClient.h>
+#include <aws/sqs/SQS_EXPORTS.h>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace Aws
+{
+  namespace SQS
+  {
+    namespace ExtendedLib
+    {
+
+      /**
+       * Keeps received messages invisible while they are being worked on. A tracked message has its visibility
+       * set back to visibilityTimeout once less than extensionMargin of it is left, the messages of a queue close
+       * to their turn going along in the same ChangeMessageVisibilityBatch. Given an SQSExtendedClient, the receipt
+       * handles of large messages can be tracked as received.
+       *
+       * Messages sqs refuses to extend, deleted or expired ones, are no longer tracked.
+       */
+      class AWS_SQS_API SQSVisibilityHeartbeat
+      {
+
+      private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct TrackedMessage
+        {
+          Clock::time_point nextExtension;
+          bool isExtending;
+        };
+
+        struct PendingNack
+        {
+          Aws::String receiptHandle;
+          std::promise<Model::ChangeMessageVisibilityOutcome> outcome;
+        };
+
+        std::shared_ptr<SQSClient> m_sqsClient;
+        std::chrono::seconds m_visibilityTimeout;
+        Clock::duration m_extensionMargin;
+
+        Aws::Map<Aws::String, Aws::Map<Aws::String, TrackedMessage> > m_tracked;
+        Aws::Map<Aws::String, Aws::Deque<PendingNack> > m_nacks;
+        bool m_shutdown;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_wakeUp;
+        std::thread m_heartbeat;
+        // set by a Shutdown running on the heartbeat itself, which then returns without touching the heartbeat
+        std::shared_ptr<bool> m_detached;
+
+        void Beat (std::shared_ptr<bool> detached);
+        Aws::Vector<PendingNack> TakeNackBatch (Aws::String& queueUrl);
+        void ExtendBatch (const Aws::String& queueUrl, const Aws::Vector<Aws::String>& receiptHandles,
+                          Aws::Vector<Clock::time_point>& nextExtensions) const;
+        void NackBatch (const Aws::String& queueUrl, Aws::Vector<PendingNack>& pendingNacks) const;
+        Aws::Vector<Model::ChangeMessageVisibilityOutcome> ChangeVisibilityBatch (
+            const Model::ChangeMessageVisibilityBatchRequest& request) const;
+
+      public:
+        SQSVisibilityHeartbeat (const std::shared_ptr<SQSClient>& sqsClient,
+                                std::chrono::seconds visibilityTimeout = std::chrono::seconds (30),
+                                std::chrono::seconds extensionMargin = std::chrono::seconds (10));
+
+        virtual ~SQSVisibilityHeartbeat ();
+
+        /**
+         * Starts extending a message just received, whose visibility timeout is expected to be visibilityTimeout.
+         */
+        virtual void Track (const Aws::String& queueUrl, const Aws::String& receiptHandle);
+
+        /**
+         * Stops extending a message, to be called once it is deleted or given up on.
+         */
+        virtual void Untrack (const Aws::String& queueUrl, const Aws::String& receiptHandle);
+
+        /**
+         * Stops extending a message and makes it visible again at once, for another consumer to retry it. Nacks
+         * are sent ahead of any extension, batched per queue. After Shutdown the message is released on its own,
+         * before returning.
+         */
+        virtual std::future<Model::ChangeMessageVisibilityOutcome> Nack (const Aws::String& queueUrl,
+                                                                         const Aws::String& receiptHandle);
+
+        virtual size_t GetTrackedCount () const;
+
+        /**
+         * Sends the nacks still queued and stops the heartbeat, tracked messages are left to their visibility
+         * timeout. Called from the sqs client on the heartbeat thread, that thread is detached instead of joined and the
+         * nacks it has not taken yet are sent before returning.
+         */
+        virtual void Shutdown ();
+
+      };
+
+    } // namespace extendedLib
+  } // namespace SQS
+} // namespace Aws
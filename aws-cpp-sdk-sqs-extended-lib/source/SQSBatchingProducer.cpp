@@ -0,0 +1,154 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <aws/sqs/extendedlib/SQSBatchingProducer.h>
+#include <aws/sqs/model/SendMessageBatchRequest.h>
+#include <aws/sqs/extendedlib/SQSBatchResultMapper.h>
+
+using namespace Aws;
+using namespace Aws::SQS;
+using namespace Aws::SQS::Model;
+using namespace Aws::SQS::ExtendedLib;
+
+static const char* ALLOCATION_TAG = "SQSBatchingProducer";
+
+namespace
+{
+  // what the message counts towards the batch limit, its body and attributes
+  size_t GetMessageSize (const SendMessageRequest& request)
+  {
+    size_t size = request.GetMessageBody ().size ();
+    for (auto& attribute : request.GetMessageAttributes ())
+    {
+      size += attribute.first.size ();
+      size += attribute.second.GetDataType ().size ();
+      size += attribute.second.GetStringValue ().size ();
+      size += attribute.second.GetBinaryValue ().GetLength ();
+    }
+    return size;
+  }
+
+  // the entry carries every field sqs takes for a single send, a zero delay only when asked to override the delay
+  // of the queue
+  SendMessageBatchRequestEntry BuildBatchEntry (const SendMessageRequest& request, bool overrideQueueDelay)
+  {
+    SendMessageBatchRequestEntry entry;
+    entry.SetMessageBody (request.GetMessageBody ());
+    entry.SetMessageAttributes (request.GetMessageAttributes ());
+    if (overrideQueueDelay || request.GetDelaySeconds () != 0)
+    {
+      entry.SetDelaySeconds (request.GetDelaySeconds ());
+    }
+    return entry;
+  }
+}
+
+SQSBatchingProducer::SQSBatchingProducer (const std::shared_ptr<SQSClient>& sqsClient,
+                                          std::chrono::milliseconds maxLinger, size_t maxBatchSize, unsigned flushers) :
+    m_sqsClient (sqsClient), m_maxLinger (maxLinger), m_maxBatchSize (maxBatchSize),
+    m_accumulator ([this] (const Aws::String& queueUrl, Aws::Vector<PendingSend>& pendingSends)
+    {
+      SQSBatchingProducer::SendBatch (queueUrl, pendingSends);
+    }, flushers, [this] (const Aws::Deque<PendingSend>& queueSends)
+    {
+      return SQSBatchingProducer::GetBatchLength (queueSends);
+    })
+{
+}
+
+SQSBatchingProducer::~SQSBatchingProducer ()
+{
+  Shutdown ();
+}
+
+std::future<SendMessageOutcome> SQSBatchingProducer::SendMessage (const SendMessageRequest& request,
+                                                                  bool overrideQueueDelay)
+{
+  auto outcome = Aws::MakeShared<std::promise<SendMessageOutcome> > (ALLOCATION_TAG);
+  SQSBatchingProducer::SendMessageAsync (request, [outcome] (const SendMessageOutcome& sendOutcome)
+  {
+    outcome->set_value (sendOutcome);
+  }, overrideQueueDelay);
+  return outcome->get_future ();
+}
+
+void SQSBatchingProducer::SendMessageAsync (const SendMessageRequest& request, const SendMessageCompletion& completion,
+                                            bool overrideQueueDelay)
+{
+  PendingSend pendingSend;
+  pendingSend.entry = BuildBatchEntry (request, overrideQueueDelay);
+  pendingSend.size = GetMessageSize (request);
+  pendingSend.deadline = Clock::now () + m_maxLinger;
+  pendingSend.completion = completion;
+
+  if (!m_accumulator.Add (request.GetQueueUrl (), pendingSend))
+  {
+    completion (m_sqsClient->SendMessage (request));
+  }
+}
+
+void SQSBatchingProducer::Flush ()
+{
+  m_accumulator.Flush ();
+}
+
+void SQSBatchingProducer::Shutdown ()
+{
+  m_accumulator.Shutdown ();
+}
+
+size_t SQSBatchingProducer::GetBatchLength (const Aws::Deque<PendingSend>& queueSends) const
+{
+  // the first message always goes, even when it is over the limit on its own
+  size_t batchLength = 0;
+  size_t batchSize = 0;
+  for (auto& pendingSend : queueSends)
+  {
+    if (batchLength == SQSBatchAccumulator<PendingSend>::MAX_BATCH_ENTRIES
+        || (batchLength > 0 && batchSize + pendingSend.size > m_maxBatchSize))
+    {
+      break;
+    }
+    ++batchLength;
+    batchSize += pendingSend.size;
+  }
+  return batchLength;
+}
+
+void SQSBatchingProducer::SendBatch (const Aws::String& queueUrl, Aws::Vector<PendingSend>& pendingSends) const
+{
+  SendMessageBatchRequest request;
+  request.SetQueueUrl (queueUrl);
+  for (size_t i = 0; i < pendingSends.size (); ++i)
+  {
+    pendingSends[i].entry.SetId (SQSBatchResultMapper::GetEntryId (i));
+    request.AddEntries (pendingSends[i].entry);
+  }
+
+  SendMessageBatchOutcome outcome = m_sqsClient->SendMessageBatch (request);
+  Aws::Vector<SendMessageOutcome> outcomes = SQSBatchResultMapper::Map<SendMessageOutcome> (
+      outcome, pendingSends.size (), [] (const SendMessageBatchResultEntry& entry)
+  {
+    SendMessageResult result;
+    result.SetMessageId (entry.GetMessageId ());
+    result.SetMD5OfMessageBody (entry.GetMD5OfMessageBody ());
+    result.SetMD5OfMessageAttributes (entry.GetMD5OfMessageAttributes ());
+    return SendMessageOutcome (result);
+  });
+  for (size_t i = 0; i < pendingSends.size (); ++i)
+  {
+    pendingSends[i].completion (outcomes[i]);
+  }
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <aws/sqs/extendedlib/SQSBoundedTaskRunner.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+using namespace Aws::Utils::Threading;
+using namespace Aws::SQS::ExtendedLib;
+
+static const char* ALLOCATION_TAG = "SQSBoundedTaskRunner";
+
+namespace
+{
+  // Shared between the caller and the helper tasks, helpers may still be queued after Run returns
+  struct TaskRunState
+  {
+    TaskRunState (size_t count, const std::function<void (size_t)>& fn) :
+        taskCount (count), task (fn), nextTask (0), finishedTasks (0)
+    {
+    }
+
+    // Pull tasks until none are left, returns once this worker has nothing more to do
+    void Work ()
+    {
+      for (size_t index = nextTask++; index < taskCount; index = nextTask++)
+      {
+        task (index);
+
+        std::lock_guard<std::mutex> lock (mutex);
+        if (++finishedTasks == taskCount)
+        {
+          finished.notify_all ();
+        }
+      }
+    }
+
+    const size_t taskCount;
+    const std::function<void (size_t)> task;
+    std::atomic<size_t> nextTask;
+    size_t finishedTasks;
+    std::mutex mutex;
+    std::condition_variable finished;
+  };
+}
+
+SQSBoundedTaskRunner::SQSBoundedTaskRunner (const std::shared_ptr<Executor>& executor, unsigned maxConcurrency) :
+    m_executor (executor), m_maxConcurrency (std::max (maxConcurrency, 1u))
+{
+}
+
+void SQSBoundedTaskRunner::Run (size_t taskCount, const std::function<void (size_t)>& task) const
+{
+  if (taskCount == 0)
+  {
+    return;
+  }
+
+  if (!m_executor || m_maxConcurrency == 1 || taskCount == 1)
+  {
+    for (size_t index = 0; index < taskCount; ++index)
+    {
+      task (index);
+    }
+    return;
+  }
+
+  auto state = Aws::MakeShared<TaskRunState> (ALLOCATION_TAG, taskCount, task);
+
+  // the calling thread is one of the workers
+  size_t helpers = std::min (static_cast<size_t> (m_maxConcurrency), taskCount) - 1;
+  for (size_t i = 0; i < helpers; ++i)
+  {
+    m_executor->Submit ([state] ()
+    {
+      state->Work ();
+    });
+  }
+
+  state->Work ();
+
+  std::unique_lock<std::mutex> lock (state->mutex);
+  state->finished.wait (lock, [&state] ()
+  {
+    return state->finishedTasks == state->taskCount;
+  });
+}
+
+unsigned SQSBoundedTaskRunner::GetMaxConcurrency () const
+{
+  return m_maxConcurrency;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/sqs/extendedlib/SQSDeflateCodec.h>
+#include <algorithm>
+#include <iostream>
+#include <zlib.h>
+
+using namespace Aws::SQS::ExtendedLib;
+
+static const size_t ENCODE_CHUNK_SIZE = 64 * 1024;
+static const size_t DECODE_CHUNK_SIZE = 64 * 1024;
+
+const char* SQSDeflateCodec::NAME = "deflate";
+
+SQSDeflateCodec::SQSDeflateCodec (int level) :
+    m_level (level)
+{
+}
+
+const char* SQSDeflateCodec::GetName () const
+{
+  return NAME;
+}
+
+bool SQSDeflateCodec::Encode (const char* payload, size_t length, Aws::String& encoded) const
+{
+  // never grow past the payload itself, a payload that does not shrink is stored raw
+  return EncodeWithin (payload, length, length, encoded);
+}
+
+bool SQSDeflateCodec::EncodeWithin (const char* payload, size_t length, size_t maxLength, Aws::String& encoded) const
+{
+  z_stream stream = z_stream ();
+  if (deflateInit (&stream, m_level) != Z_OK)
+  {
+    return false;
+  }
+
+  // the output grows as deflate fills it, doubling from one chunk, so a payload that shrinks well never gets a
+  // buffer of its own size
+  encoded.clear ();
+  stream.next_in = reinterpret_cast<Bytef*> (const_cast<char*> (payload));
+  stream.avail_in = static_cast<uInt> (length);
+
+  int result = Z_OK;
+  while (result == Z_OK && encoded.size () < maxLength)
+  {
+    size_t encodedLength = encoded.size ();
+    size_t growth = std::min (std::max (encodedLength, ENCODE_CHUNK_SIZE), maxLength - encodedLength);
+    encoded.resize (encodedLength + growth);
+    stream.next_out = reinterpret_cast<Bytef*> (&encoded[encodedLength]);
+    stream.avail_out = static_cast<uInt> (growth);
+
+    result = deflate (&stream, Z_FINISH);
+    encoded.resize (encoded.size () - stream.avail_out);
+  }
+  deflateEnd (&stream);
+
+  if (result != Z_STREAM_END)
+  {
+    encoded.clear ();
+    return false;
+  }
+  return true;
+}
+
+bool SQSDeflateCodec::Decode (Aws::IStream& encoded, Aws::String& payload) const
+{
+  z_stream stream = z_stream ();
+  if (inflateInit (&stream) != Z_OK)
+  {
+    return false;
+  }
+
+  char chunk[DECODE_CHUNK_SIZE];
+  int result = Z_OK;
+  while (result != Z_STREAM_END)
+  {
+    encoded.read (chunk, sizeof (chunk));
+    stream.next_in = reinterpret_cast<Bytef*> (chunk);
+    stream.avail_in = static_cast<uInt> (encoded.gcount ());
+    if (stream.avail_in == 0)
+    {
+      break;
+    }
+
+    // inflate straight into the payload, using up whatever the caller reserved before growing it. A full
+    // output means inflate may hold more, so it is called again until it leaves room
+    do
+    {
+      size_t decodedLength = payload.size ();
+      size_t reserved = payload.capacity () - decodedLength;
+      payload.resize (decodedLength + (reserved > 0 ? reserved : DECODE_CHUNK_SIZE));
+      stream.next_out = reinterpret_cast<Bytef*> (&payload[decodedLength]);
+      stream.avail_out = static_cast<uInt> (payload.size () - decodedLength);
+
+      result = inflate (&stream, Z_NO_FLUSH);
+      payload.resize (payload.size () - stream.avail_out);
+      if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR)
+      {
+        inflateEnd (&stream);
+        return false;
+      }
+    }
+    while (stream.avail_out == 0 && result != Z_STREAM_END);
+  }
+
+  inflateEnd (&stream);
+  return result == Z_STREAM_END;
+}
+
+bool SQSDeflateCodec::Decode (Aws::IStream& encoded, Aws::OStream& payload) const
+{
+  z_stream stream = z_stream ();
+  if (inflateInit (&stream) != Z_OK)
+  {
+    return false;
+  }
+
+  // only one chunk each way is ever held, whatever the payload size
+  char chunk[DECODE_CHUNK_SIZE];
+  char decodedChunk[DECODE_CHUNK_SIZE];
+  int result = Z_OK;
+  while (result != Z_STREAM_END && payload.good ())
+  {
+    encoded.read (chunk, sizeof (chunk));
+    stream.next_in = reinterpret_cast<Bytef*> (chunk);
+    stream.avail_in = static_cast<uInt> (encoded.gcount ());
+    if (stream.avail_in == 0)
+    {
+      break;
+    }
+
+    do
+    {
+      stream.next_out = reinterpret_cast<Bytef*> (decodedChunk);
+      stream.avail_out = static_cast<uInt> (sizeof (decodedChunk));
+
+      result = inflate (&stream, Z_NO_FLUSH);
+      if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR)
+      {
+        inflateEnd (&stream);
+        return false;
+      }
+      payload.write (decodedChunk, static_cast<std::streamsize> (sizeof (decodedChunk) - stream.avail_out));
+    }
+    while (stream.avail_out == 0 && result != Z_STREAM_END);
+  }
+
+  inflateEnd (&stream);
+  return result == Z_STREAM_END && payload.good ();
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <aws/sqs/extendedlib/SQSDeleteAccumulator.h>
+#include <aws/sqs/model/DeleteMessageBatchRequest.h>
+#include <aws/sqs/extendedlib/SQSBatchResultMapper.h>
+
+using namespace Aws;
+using namespace Aws::SQS;
+using namespace Aws::SQS::Model;
+using namespace Aws::SQS::ExtendedLib;
+
+static const char* ALLOCATION_TAG = "SQSDeleteAccumulator";
+
+SQSDeleteAccumulator::SQSDeleteAccumulator (const std::shared_ptr<SQSClient>& sqsClient,
+                                            std::chrono::milliseconds maxLatency, unsigned flushers) :
+    m_sqsClient (sqsClient), m_maxLatency (maxLatency),
+    m_accumulator ([this] (const Aws::String& queueUrl, Aws::Vector<PendingDelete>& pendingDeletes)
+    {
+      SQSDeleteAccumulator::SendBatch (queueUrl, pendingDeletes);
+    }, flushers)
+{
+}
+
+SQSDeleteAccumulator::~SQSDeleteAccumulator ()
+{
+  Shutdown ();
+}
+
+std::future<DeleteMessageOutcome> SQSDeleteAccumulator::DeleteMessage (const DeleteMessageRequest& request)
+{
+  auto outcome = Aws::MakeShared<std::promise<DeleteMessageOutcome> > (ALLOCATION_TAG);
+  SQSDeleteAccumulator::DeleteMessageAsync (request, [outcome] (const DeleteMessageOutcome& deleteOutcome)
+  {
+    outcome->set_value (deleteOutcome);
+  });
+  return outcome->get_future ();
+}
+
+void SQSDeleteAccumulator::DeleteMessageAsync (const DeleteMessageRequest& request, const DeleteMessageCompletion& completion)
+{
+  PendingDelete pendingDelete;
+  pendingDelete.receiptHandle = request.GetReceiptHandle ();
+  pendingDelete.deadline = Clock::now () + m_maxLatency;
+  pendingDelete.completion = completion;
+
+  if (!m_accumulator.Add (request.GetQueueUrl (), pendingDelete))
+  {
+    completion (m_sqsClient->DeleteMessage (request));
+  }
+}
+
+void SQSDeleteAccumulator::Flush ()
+{
+  m_accumulator.Flush ();
+}
+
+void SQSDeleteAccumulator::Shutdown ()
+{
+  m_accumulator.Shutdown ();
+}
+
+void SQSDeleteAccumulator::SendBatch (const Aws::String& queueUrl, Aws::Vector<PendingDelete>& pendingDeletes) const
+{
+  DeleteMessageBatchRequest request;
+  request.SetQueueUrl (queueUrl);
+  for (size_t i = 0; i < pendingDeletes.size (); ++i)
+  {
+    DeleteMessageBatchRequestEntry entry;
+    entry.SetId (SQSBatchResultMapper::GetEntryId (i));
+    entry.SetReceiptHandle (pendingDeletes[i].receiptHandle);
+    request.AddEntries (entry);
+  }
+
+  DeleteMessageBatchOutcome outcome = m_sqsClient->DeleteMessageBatch (request);
+  Aws::Vector<DeleteMessageOutcome> outcomes = SQSBatchResultMapper::Map<DeleteMessageOutcome> (
+      outcome, pendingDeletes.size (), [] (const DeleteMessageBatchResultEntry&)
+  {
+    return DeleteMessageOutcome (NoResult ());
+  });
+  for (size_t i = 0; i < pendingDeletes.size (); ++i)
+  {
+    pendingDeletes[i].completion (outcomes[i]);
+  }
+}
@@ -12,99 +12,346 @@
  * express or implied. See the License for the specific language governing
  * permissions and limitations under the License.
  */
+#include <aws/core/AmazonWebServiceRequest.h>
+#include <aws/core/client/AsyncCallerContext.h>
 #include <aws/core/utils/memory/stl/AWSStringStream.h>
 #include <aws/core/utils/json/JsonSerializer.h>
+#include <aws/core/utils/HashingUtils.h>
+#include <aws/core/utils/DateTime.h>
+#include <aws/sqs/extendedlib/SQSBoundedTaskRunner.h>
+#include <aws/sqs/extendedlib/SQSDeflateCodec.h>
 #include <aws/sqs/extendedlib/SQSExtendedClient.h>
 #include <aws/sqs/extendedlib/SQSExtendedClientConfiguration.h>
 #include <aws/sqs/extendedlib/SQSLargeMessageS3Pointer.h>
+#include <aws/sqs/extendedlib/SQSLargeMessageS3PointerView.h>
+#include <aws/sqs/extendedlib/SQSPayloadStream.h>
+#include <aws/sqs/extendedlib/SQSReceiptHandleView.h>
+#include <aws/sqs/extendedlib/SQSUuidS3KeyGenerator.h>
 #include <aws/s3/model/PutObjectRequest.h>
 #include <aws/s3/model/GetObjectRequest.h>
 #include <aws/s3/model/DeleteObjectRequest.h>
+#include <aws/s3/model/DeleteObjectsRequest.h>
+#include <aws/s3/model/Delete.h>
+#include <aws/s3/model/ObjectIdentifier.h>
+#include <aws/s3/model/HeadObjectRequest.h>
+#include <aws/s3/model/CreateMultipartUploadRequest.h>
+#include <aws/s3/model/UploadPartRequest.h>
+#include <aws/s3/model/CompleteMultipartUploadRequest.h>
+#include <aws/s3/model/AbortMultipartUploadRequest.h>
+#include <aws/s3/model/CompletedMultipartUpload.h>
+#include <aws/s3/model/CompletedPart.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <mutex>
 
 using namespace Aws;
+using namespace Aws::Client;
 using namespace Aws::S3::Model;
 using namespace Aws::SQS::Model;
 using namespace Aws::SQS::ExtendedLib;
+using namespace Aws::Utils;
 using namespace Aws::Utils::Json;
+using namespace Aws::Utils::Threading;
 
 static const char* ALLOCATION_TAG = "SQSExtendedClient";
 static const char* RESERVED_ATTRIBUTE_NAME = "SQSLargePayloadSize";
-static const char* S3_BUCKET_NAME_MARKER = "-..s3BucketName..-";
-static const char* S3_KEY_MARKER = "-..s3Key..-";
+static const char* INLINE_CODEC_ATTRIBUTE_NAME = "SQSInlinePayloadCodec";
+static const char* CONTENT_ADDRESSED_KEY_PREFIX = "SQSLargePayloadSha256-";
+static const char* PACKED_KEY_PREFIX = "SQSLargePayloadBatch-";
+static const char* PAYLOAD_NOT_STORED_ERROR = "SQSLargePayloadNotStored";
+static const char* PAYLOAD_NOT_STORED_MESSAGE = "The message payload could not be stored in S3";
+static const size_t MULTIPART_UPLOAD_MAX_PARTS = 10000;
+static const size_t DELETE_OBJECTS_MAX_KEYS = 1000;
+static const size_t BATCH_MAX_ENTRIES = 10;
+// sqs refuses batches whose bodies and attributes add up to more than this
+static const size_t SEND_MESSAGE_BATCH_MAX_SIZE = 262144;
+// what an offloaded entry is counted for, over the bucket name: pointer key and formatting, and the size attribute
+static const size_t S3_POINTER_SIZE_ALLOWANCE = 256;
+static const size_t S3_READ_CHUNK_SIZE = 64 * 1024;
+// the fastest deflate level seldom shrinks a payload more than this, larger bodies are not worth trying inline
+static const size_t MAX_INLINE_COMPRESSION_RATIO = 32;
+// packed payloads closer than this are fetched with a single ranged get
+static const long long MAX_MERGED_READ_GAP = 1024 * 1024;
+
+namespace
+{
+  // content addressed and packed objects may back other messages, they are left to the bucket lifecycle
+  bool IsSharedPayloadKey (const Aws::String& s3Key)
+  {
+    return s3Key.find (CONTENT_ADDRESSED_KEY_PREFIX) != std::string::npos
+        || s3Key.find (PACKED_KEY_PREFIX) != std::string::npos;
+  }
+
+  // Adds the entries of one batch to results merged from several, a batch sqs refused as a whole reports each of
+  // its entries as failed with its error
+  template<typename ResultT, typename OutcomeT, typename EntryT>
+  void MergeBatchOutcome (ResultT& result, const OutcomeT& outcome, const Aws::Vector<EntryT>& entries)
+  {
+    if (outcome.IsSuccess ())
+    {
+      for (auto& entry : outcome.GetResult ().GetSuccessful ())
+      {
+        result.AddSuccessful (entry);
+      }
+      for (auto& entry : outcome.GetResult ().GetFailed ())
+      {
+        result.AddFailed (entry);
+      }
+      return;
+    }
+
+    for (auto& entry : entries)
+    {
+      BatchResultErrorEntry errorEntry;
+      errorEntry.SetId (entry.GetId ());
+      errorEntry.SetSenderFault (!outcome.GetError ().ShouldRetry ());
+      errorEntry.SetCode (outcome.GetError ().GetExceptionName ());
+      errorEntry.SetMessage (outcome.GetError ().GetMessage ());
+      result.AddFailed (errorEntry);
+    }
+  }
+
+  // What an entry whose payload could not be stored is reported as, it never reaches the queue
+  BatchResultErrorEntry PayloadNotStoredEntry (const Aws::String& id)
+  {
+    BatchResultErrorEntry errorEntry;
+    errorEntry.SetId (id);
+    errorEntry.SetSenderFault (false);
+    errorEntry.SetCode (PAYLOAD_NOT_STORED_ERROR);
+    errorEntry.SetMessage (PAYLOAD_NOT_STORED_MESSAGE);
+    return errorEntry;
+  }
+
+  // How long a stored payload is reused for, keeping the safety margin clear of its max age
+  std::chrono::seconds PayloadReuseWindow (const SQSExtendedClientConfiguration& sqsconfig)
+  {
+    unsigned maxAge = sqsconfig.GetPayloadDeduplicationMaxAge ();
+    return std::chrono::seconds (maxAge - std::min (maxAge, sqsconfig.GetPayloadDeduplicationSafetyMargin ()));
+  }
+
+  // Runs a request with any number of entries as batches of ten, at most maxConcurrency at a time, merging their
+  // results
+  template<typename RequestT, typename ResultT, typename OutcomeT>
+  OutcomeT RunInBatches (const RequestT& request, const SQSBoundedTaskRunner& taskRunner,
+                         const std::function<OutcomeT (const RequestT&)>& runBatch)
+  {
+    const auto& entries = request.GetEntries ();
+    size_t batches = (entries.size () + BATCH_MAX_ENTRIES - 1) / BATCH_MAX_ENTRIES;
+    if (batches <= 1)
+    {
+      return runBatch (request);
+    }
+
+    Aws::Vector<RequestT> batchRequests (batches);
+    Aws::Vector<OutcomeT> outcomes (batches);
+    for (size_t batch = 0; batch < batches; ++batch)
+    {
+      static_cast<AmazonWebServiceRequest&> (batchRequests[batch]) = request;
+      batchRequests[batch].SetQueueUrl (request.GetQueueUrl ());
+      size_t end = std::min ((batch + 1) * BATCH_MAX_ENTRIES, entries.size ());
+      for (size_t i = batch * BATCH_MAX_ENTRIES; i < end; ++i)
+      {
+        batchRequests[batch].AddEntries (entries[i]);
+      }
+    }
+    taskRunner.Run (batches, [&batchRequests, &outcomes, &runBatch] (size_t batch)
+    {
+      outcomes[batch] = runBatch (batchRequests[batch]);
+    });
+
+    ResultT result;
+    bool anySent = false;
+    for (size_t batch = 0; batch < batches; ++batch)
+    {
+      MergeBatchOutcome (result, outcomes[batch], batchRequests[batch].GetEntries ());
+      anySent = anySent || outcomes[batch].IsSuccess ();
+    }
+    return anySent ? OutcomeT (result) : outcomes[0];
+  }
+
+  // Copies the whole request and drops its body, which the caller replaces. Only a full copy keeps every field as
+  // it was set, an explicit zero delay included, since the model does not tell whether a field has been set
+  template<typename RequestT>
+  RequestT CopyWithoutBody (const RequestT& request)
+  {
+    RequestT copy (request);
+    copy.SetMessageBody (Aws::String ());
+    return copy;
+  }
+
+  // Replaces the body by the serialized s3 pointer, flagging the message with the size of the original body
+  template<typename RequestT>
+  RequestT PointToS3 (const RequestT& request, const Aws::String& s3PointerBody)
+  {
+    RequestT reqWithS3Support = CopyWithoutBody (request);
+
+    // Add message attribute as a flag
+    MessageAttributeValue messageAttributeValue;
+    messageAttributeValue.SetDataType ("Number");
+    messageAttributeValue.SetStringValue (std::to_string (request.GetMessageBody ().size ()).c_str ());
+    reqWithS3Support.AddMessageAttributes (RESERVED_ATTRIBUTE_NAME, messageAttributeValue);
+
+    reqWithS3Support.SetMessageBody (s3PointerBody);
+
+    return reqWithS3Support;
+  }
+
+  // The pointer of an offloaded message, in either form, json with escaped strings going through a JsonValue. A raw
+  // payload is stored at its original size, recording it as the range of the payload lets large ones be downloaded
+  // in parts
+  SQSLargeMessageS3Pointer ParseS3Pointer (const Message& message, long long size)
+  {
+    SQSLargeMessageS3PointerView s3PointerView;
+    SQSLargeMessageS3Pointer s3Pointer = s3PointerView.Parse (message.GetBody ())
+        ? s3PointerView.ToS3Pointer () : SQSLargeMessageS3Pointer (JsonValue (message.GetBody ()));
+    if (s3Pointer.GetCodec ().empty () && !s3Pointer.S3LengthHasBeenSet ())
+    {
+      s3Pointer.SetS3Offset (0);
+      s3Pointer.SetS3Length (size);
+    }
+    return s3Pointer;
+  }
+
+  Aws::String ByteRange (long long offset, long long length)
+  {
+    Aws::String range = "bytes=";
+    range += std::to_string (offset).c_str ();
+    range += "-";
+    range += std::to_string (offset + length - 1).c_str ();
+    return range;
+  }
+}
 
 SQSExtendedClient::SQSExtendedClient (const std::shared_ptr<SQSClient>& sqsclient,
                                       const std::shared_ptr<SQSExtendedClientConfiguration>& sqsconfig) :
-    m_sqsclient (sqsclient), m_sqsconfig (sqsconfig)
+    m_sqsclient (sqsclient), m_sqsconfig (sqsconfig),
+    m_s3Executor (Aws::MakeShared<PooledThreadExecutor> (ALLOCATION_TAG, sqsconfig->GetS3MaxConcurrency ())),
+    m_payloadDigestCache (Aws::MakeShared<SQSPayloadDigestCache> (
+        ALLOCATION_TAG, sqsconfig->GetPayloadDeduplicationCacheSize (), PayloadReuseWindow (*sqsconfig))),
+    m_asyncThreadPool (Aws::MakeShared<PooledThreadExecutor> (ALLOCATION_TAG, sqsconfig->GetAsyncThreadPoolSize ())),
+    m_pendingAsyncOperations (0)
 {
 }
 
+SQSExtendedClient::~SQSExtendedClient ()
+{
+  // the pool drops what it still has queued when destroyed, which would leave handlers uncalled and futures broken
+  std::unique_lock<std::mutex> lock (m_asyncMutex);
+  m_asyncDrained.wait (lock, [this] ()
+  {
+    return m_pendingAsyncOperations == 0;
+  });
+}
+
 SendMessageOutcome SQSExtendedClient::SendMessage (const SendMessageRequest& request) const
 {
   if (!m_sqsconfig->IsLargePayloadSupportEnabled ())
   {
-    return SQSClient::SendMessage (request);
+    return m_sqsclient->SendMessage (request);
   }
 
   if (m_sqsconfig->IsAlwaysThroughS3 () || SQSExtendedClient::IsLargeMessage (request))
   {
-    SendMessageRequest reqWithS3Support = SQSExtendedClient::StoreMessageInS3 (request);
-    return SQSClient::SendMessage (reqWithS3Support);
+    SendMessageRequest reqWithInlineSupport;
+    if (SQSExtendedClient::CompressMessageInline (request, reqWithInlineSupport))
+    {
+      return m_sqsclient->SendMessage (reqWithInlineSupport);
+    }
+
+    SendMessageRequest reqWithS3Support;
+    if (!SQSExtendedClient::StoreMessageInS3 (request, reqWithS3Support))
+    {
+      return SendMessageOutcome (Aws::Client::AWSError<SQSErrors> (SQSErrors::UNKNOWN, PAYLOAD_NOT_STORED_ERROR,
+                                                                   PAYLOAD_NOT_STORED_MESSAGE, false));
+    }
+    return m_sqsclient->SendMessage (reqWithS3Support);
   }
 
-  return SQSClient::SendMessage (request);
+  return m_sqsclient->SendMessage (request);
 }
 
 ReceiveMessageOutcome SQSExtendedClient::ReceiveMessage (const ReceiveMessageRequest& request) const
 {
   if (!m_sqsconfig->IsLargePayloadSupportEnabled ())
   {
-    return SQSClient::ReceiveMessage (request);
+    return m_sqsclient->ReceiveMessage (request);
   }
 
   ReceiveMessageRequest reqWithS3Support = request;
   reqWithS3Support.AddMessageAttributeNames (RESERVED_ATTRIBUTE_NAME);
+  reqWithS3Support.AddMessageAttributeNames (INLINE_CODEC_ATTRIBUTE_NAME);
 
-  ReceiveMessageOutcome outcome = SQSClient::ReceiveMessage (reqWithS3Support);
+  ReceiveMessageOutcome outcome = m_sqsclient->ReceiveMessage (reqWithS3Support);
   ReceiveMessageResult result = outcome.GetResult ();
 
-  Aws::Vector<Message> rebuildedMessages;
-  for (Message message : result.GetMessages ())
+  Aws::Vector<Message> rebuildedMessages = result.GetMessages ();
+  Aws::Vector<size_t> s3Messages;
+  Aws::Vector<SQSLargeMessageS3Pointer> s3Pointers;
+  for (size_t i = 0; i < rebuildedMessages.size (); ++i)
   {
+    Message& message = rebuildedMessages[i];
 
     Aws::Map<Aws::String, MessageAttributeValue> messageAttributes = message.GetMessageAttributes ();
     if (messageAttributes.find (RESERVED_ATTRIBUTE_NAME) != messageAttributes.end ())
     {
-      Aws::String messageBody = message.GetBody ();
+      // unjsonize object, payloads are fetched together once every pointer is known
+      s3Messages.push_back (i);
+      long long size = std::strtoll (messageAttributes[RESERVED_ATTRIBUTE_NAME].GetStringValue ().c_str (), nullptr, 10);
+      s3Pointers.push_back (ParseS3Pointer (message, size));
+    }
+    else if (messageAttributes.find (INLINE_CODEC_ATTRIBUTE_NAME) != messageAttributes.end ())
+    {
+      Aws::String originalBody;
+      if (SQSExtendedClient::DecodeMessageBodyInline (message.GetBody (),
+                                                      messageAttributes[INLINE_CODEC_ATTRIBUTE_NAME].GetStringValue (),
+                                                      originalBody))
+      {
+        message.SetBody (originalBody);
+        messageAttributes.erase (INLINE_CODEC_ATTRIBUTE_NAME);
+        message.SetMessageAttributes (messageAttributes);
+      }
+    }
+  }
 
-      // unjsonize object
-      SQSLargeMessageS3Pointer s3Pointer = JsonValue (messageBody);
-      Aws::String s3BucketName = s3Pointer.GetS3BucketName ();
-      Aws::String s3Key = s3Pointer.GetS3Key ();
+  // lazy receives keep the pointer and the size attribute as they are, GetLazyPayload fetches on demand
+  bool isLazy = m_sqsconfig->IsLazyPayloadLoadingEnabled ();
+  Aws::Vector<Aws::String> originalBodies (isLazy ? 0 : s3Messages.size ());
+  Aws::Vector<char> isLoaded (s3Messages.size (), isLazy ? 1 : 0);
+  if (!isLazy)
+  {
+    // get payloads from s3, the size attribute tells how much room each original body needs
+    for (size_t i = 0; i < s3Messages.size (); ++i)
+    {
+      const Message& message = rebuildedMessages[s3Messages[i]];
+      auto sizeAttribute = message.GetMessageAttributes ().find (RESERVED_ATTRIBUTE_NAME);
+      originalBodies[i].reserve (std::strtoul (sizeAttribute->second.GetStringValue ().c_str (), nullptr, 10));
+    }
+    SQSExtendedClient::LoadPayloadsFromS3 (s3Pointers, originalBodies, isLoaded);
+  }
 
-      // get payload from s3
-      GetObjectRequest getObjectRequest;
-      getObjectRequest.SetBucket (s3BucketName);
-      getObjectRequest.SetKey (s3Key);
-      GetObjectOutcome getObjectOutcome = m_sqsconfig->GetS3Client ()->GetObject (getObjectRequest);
+  for (size_t i = 0; i < s3Messages.size (); ++i)
+  {
+    if (!isLoaded[i])
+    {
+      continue;
+    }
 
-      // set original body to message
-      Aws::StringStream originalBody;
-      originalBody << getObjectOutcome.GetResult ().GetBody ().rdbuf ();
-      message.SetBody (originalBody.str ());
+    Message& message = rebuildedMessages[s3Messages[i]];
+    if (!isLazy)
+    {
+      message.SetBody (originalBodies[i]);
 
       // remove largepayload attribute from message
+      Aws::Map<Aws::String, MessageAttributeValue> messageAttributes = message.GetMessageAttributes ();
       messageAttributes.erase (RESERVED_ATTRIBUTE_NAME);
       message.SetMessageAttributes (messageAttributes);
-
-      // Embed s3 object pointer in the receipt handle.
-      Aws::String receiptHandle = S3_BUCKET_NAME_MARKER + s3BucketName + S3_BUCKET_NAME_MARKER + S3_KEY_MARKER + s3Key
-          + S3_KEY_MARKER + message.GetReceiptHandle ();
-
-      message.SetReceiptHandle (receiptHandle);
     }
 
-    rebuildedMessages.push_back (message);
-
+    // Embed s3 object pointer in the receipt handle.
+    message.SetReceiptHandle (SQSExtendedClient::BuildReceiptHandle (s3Pointers[i], message.GetReceiptHandle ()));
   }
   result.SetMessages (rebuildedMessages);
 
@@ -114,85 +361,401 @@ ReceiveMessageOutcome SQSExtendedClient::ReceiveMessage (const ReceiveMessageReq
 DeleteMessageOutcome SQSExtendedClient::DeleteMessage (const DeleteMessageRequest& request) const
 {
   if (!m_sqsconfig->IsLargePayloadSupportEnabled ()) {
-    return SQSClient::DeleteMessage (request);
+    return m_sqsclient->DeleteMessage (request);
   }
 
-  Aws::String receiptHandle = request.GetReceiptHandle ();
-  if (receiptHandle.find (S3_BUCKET_NAME_MARKER) != std::string::npos
-      && receiptHandle.find (S3_KEY_MARKER) != std::string::npos)
+  SQSReceiptHandleView receiptHandleView;
+  if (receiptHandleView.Parse (request.GetReceiptHandle ()))
   {
-    Aws::String s3BucketName = SQSExtendedClient::GetFromReceiptHandleByMarker (receiptHandle, S3_BUCKET_NAME_MARKER);
-    Aws::String s3Key = SQSExtendedClient::GetFromReceiptHandleByMarker (receiptHandle, S3_KEY_MARKER);
+    Aws::String s3BucketName = receiptHandleView.GetS3BucketName ().ToString ();
+    Aws::String s3Key = receiptHandleView.GetS3Key ().ToString ();
 
-    DeleteObjectRequest deleteObjectRequest;
-    deleteObjectRequest.SetBucket (s3BucketName);
-    deleteObjectRequest.SetKey (s3Key);
-    m_sqsconfig->GetS3Client ()->DeleteObject (deleteObjectRequest);
+    DeleteMessageRequest reqWithS3Support = request;
+    reqWithS3Support.SetReceiptHandle (receiptHandleView.GetSQSReceiptHandle ().ToString ());
 
-    int lastOccurence = receiptHandle.rfind (S3_KEY_MARKER);
-    Aws::String cleannedReceiptHandle = receiptHandle.substr (lastOccurence + std::string (S3_KEY_MARKER).length ());
+    // with a reaper the message is acknowledged first, its payload is deleted in the background
+    std::shared_ptr<SQSS3PayloadReaper> s3PayloadReaper = m_sqsconfig->GetS3PayloadReaper ();
+    if (s3PayloadReaper)
+    {
+      DeleteMessageOutcome outcome = m_sqsclient->DeleteMessage (reqWithS3Support);
+      if (outcome.IsSuccess () && !IsSharedPayloadKey (s3Key))
+      {
+        s3PayloadReaper->Enqueue (s3BucketName, s3Key);
+      }
+      return outcome;
+    }
 
-    DeleteMessageRequest reqWithS3Support = request;
-    reqWithS3Support.SetReceiptHandle (cleannedReceiptHandle);
+    SQSExtendedClient::DeletePayloadFromS3 (s3BucketName, s3Key);
 
-    return SQSClient::DeleteMessage (reqWithS3Support);
+    return m_sqsclient->DeleteMessage (reqWithS3Support);
   }
 
-  return SQSClient::DeleteMessage (request);
+  return m_sqsclient->DeleteMessage (request);
 }
 
 SendMessageBatchOutcome SQSExtendedClient::SendMessageBatch (const SendMessageBatchRequest& request) const
 {
   if (!m_sqsconfig->IsLargePayloadSupportEnabled ()) {
-    return SQSClient::SendMessageBatch (request);
+    return m_sqsclient->SendMessageBatch (request);
   }
 
-  SendMessageBatchRequest reqWithS3Support = request;
+  const Aws::Vector<SendMessageBatchRequestEntry>& entries = request.GetEntries ();
+
+  Aws::Vector<size_t> largeEntries = SQSExtendedClient::PlanMessageBatchOffload (entries);
+
+  // upload large payloads to s3 concurrently, each entry keeps its position in the batch
+  bool packPayloads = m_sqsconfig->IsBatchPackingEnabled () && !m_sqsconfig->IsPayloadDeduplicationEnabled ();
+  if (m_sqsconfig->IsBatchPipeliningEnabled () && !packPayloads
+      && !largeEntries.empty () && largeEntries.size () < entries.size ())
+  {
+    return SQSExtendedClient::SendMessageBatchPipelined (request, largeEntries);
+  }
 
-  Aws::Vector<SendMessageBatchRequestEntry> batchEntries;
-  for (SendMessageBatchRequestEntry entry : reqWithS3Support.GetEntries ())
+  Aws::Vector<SendMessageBatchRequestEntry> entriesWithS3Support (largeEntries.size ());
+  Aws::Vector<char> isPacked (largeEntries.size (), 0);
+  Aws::Vector<char> isStored (largeEntries.size (), 1);
+  SQSBoundedTaskRunner taskRunner (m_s3Executor, m_sqsconfig->GetS3MaxConcurrency ());
+  taskRunner.Run (largeEntries.size (), [this, packPayloads, &entries, &largeEntries, &entriesWithS3Support, &isPacked,
+                                         &isStored] (size_t i)
   {
-    if (m_sqsconfig->IsAlwaysThroughS3 () || SQSExtendedClient::IsLargeMessageBatch (entry))
+    const SendMessageBatchRequestEntry& entry = entries[largeEntries[i]];
+    if (SQSExtendedClient::CompressMessageBatchInline (entry, entriesWithS3Support[i]))
     {
-      SendMessageBatchRequestEntry entryWithS3Support = SQSExtendedClient::StoreMessageBatchInS3 (entry);
-      batchEntries.push_back (entryWithS3Support);
+      return;
+    }
+
+    if (packPayloads)
+    {
+      isPacked[i] = 1;
     }
     else
     {
-      batchEntries.push_back (entry);
+      isStored[i] = SQSExtendedClient::StoreMessageBatchInS3 (entry, entriesWithS3Support[i]);
+    }
+  });
+
+  // payloads left for s3 share a single object, a lone one is stored as usual
+  Aws::Vector<size_t> packedEntries;
+  Aws::Vector<const SendMessageBatchRequestEntry*> packedRequests;
+  for (size_t i = 0; i < largeEntries.size (); ++i)
+  {
+    if (isPacked[i])
+    {
+      packedEntries.push_back (i);
+      packedRequests.push_back (&entries[largeEntries[i]]);
     }
   }
-  reqWithS3Support.SetEntries (batchEntries);
+  if (packedEntries.size () == 1)
+  {
+    isStored[packedEntries[0]] = SQSExtendedClient::StoreMessageBatchInS3 (*packedRequests[0],
+                                                                           entriesWithS3Support[packedEntries[0]]);
+  }
+  else if (packedEntries.size () > 1)
+  {
+    Aws::Vector<SendMessageBatchRequestEntry> packedEntriesWithS3Support;
+    bool isPackStored = SQSExtendedClient::StoreMessageBatchPackInS3 (packedRequests, packedEntriesWithS3Support);
+    for (size_t i = 0; i < packedEntries.size (); ++i)
+    {
+      isStored[packedEntries[i]] = isPackStored;
+      if (isPackStored)
+      {
+        entriesWithS3Support[packedEntries[i]] = packedEntriesWithS3Support[i];
+      }
+    }
+  }
+
+  // build the outgoing batch without copying the large bodies, those are replaced by their s3 pointer. An entry
+  // whose payload is not in s3 is reported as failed instead
+  SendMessageBatchRequest reqWithS3Support;
+  static_cast<AmazonWebServiceRequest&> (reqWithS3Support) = request;
+  reqWithS3Support.SetQueueUrl (request.GetQueueUrl ());
+  Aws::Vector<BatchResultErrorEntry> notStoredEntries;
+  size_t nextLargeEntry = 0;
+  for (size_t i = 0; i < entries.size (); ++i)
+  {
+    if (nextLargeEntry < largeEntries.size () && largeEntries[nextLargeEntry] == i)
+    {
+      if (isStored[nextLargeEntry])
+      {
+        reqWithS3Support.AddEntries (entriesWithS3Support[nextLargeEntry]);
+      }
+      else
+      {
+        notStoredEntries.push_back (PayloadNotStoredEntry (entries[i].GetId ()));
+      }
+      ++nextLargeEntry;
+    }
+    else
+    {
+      reqWithS3Support.AddEntries (entries[i]);
+    }
+  }
+
+  if (notStoredEntries.empty ())
+  {
+    return SQSExtendedClient::SendMessageBatchWithinLimit (reqWithS3Support);
+  }
+
+  SendMessageBatchResult result;
+  if (!reqWithS3Support.GetEntries ().empty ())
+  {
+    // an error only when nothing went through
+    SendMessageBatchOutcome outcome = SQSExtendedClient::SendMessageBatchWithinLimit (reqWithS3Support);
+    if (!outcome.IsSuccess ())
+    {
+      return outcome;
+    }
+    result = outcome.GetResult ();
+  }
+  for (auto& entry : notStoredEntries)
+  {
+    result.AddFailed (entry);
+  }
+  return SendMessageBatchOutcome (result);
+}
+
+Aws::Vector<size_t> SQSExtendedClient::PlanMessageBatchOffload (const Aws::Vector<SendMessageBatchRequestEntry>& entries) const
+{
+  size_t s3PointerSize = m_sqsconfig->GetS3BucketName ().size () + S3_POINTER_SIZE_ALLOWANCE;
+
+  // entries over the threshold are offloaded anyway
+  Aws::Vector<size_t> largeEntries;
+  Aws::Vector<std::pair<size_t, size_t> > inlineEntries;
+  size_t batchSize = 0;
+  for (size_t i = 0; i < entries.size (); ++i)
+  {
+    if (m_sqsconfig->IsAlwaysThroughS3 () || SQSExtendedClient::IsLargeMessageBatch (entries[i]))
+    {
+      largeEntries.push_back (i);
+      batchSize += s3PointerSize;
+    }
+    else
+    {
+      size_t entrySize = SQSExtendedClient::GetMsgAttributesSize (entries[i].GetMessageAttributes ())
+          + entries[i].GetMessageBody ().size ();
+      inlineEntries.push_back (std::make_pair (entrySize, i));
+      batchSize += entrySize;
+    }
+  }
+
+  // then the biggest of the others until the batch fits, which takes the fewest uploads
+  std::sort (inlineEntries.begin (), inlineEntries.end (), [] (const std::pair<size_t, size_t>& a,
+                                                               const std::pair<size_t, size_t>& b)
+  {
+    return a.first > b.first;
+  });
+  for (size_t i = 0; i < inlineEntries.size () && batchSize > SEND_MESSAGE_BATCH_MAX_SIZE; ++i)
+  {
+    if (inlineEntries[i].first <= s3PointerSize)
+    {
+      break;
+    }
+    largeEntries.push_back (inlineEntries[i].second);
+    batchSize -= inlineEntries[i].first - s3PointerSize;
+  }
+
+  std::sort (largeEntries.begin (), largeEntries.end ());
+  return largeEntries;
+}
+
+SendMessageBatchOutcome SQSExtendedClient::SendMessageBatchWithinLimit (const SendMessageBatchRequest& request) const
+{
+  // consecutive entries are grouped while they fit, a single entry over the limit is left for sqs to refuse
+  const Aws::Vector<SendMessageBatchRequestEntry>& entries = request.GetEntries ();
+  Aws::Vector<size_t> batchStarts;
+  size_t batchSize = 0;
+  for (size_t i = 0; i < entries.size (); ++i)
+  {
+    size_t entrySize = SQSExtendedClient::GetMsgAttributesSize (entries[i].GetMessageAttributes ())
+        + entries[i].GetMessageBody ().size ();
+    if (batchStarts.empty () || batchSize + entrySize > SEND_MESSAGE_BATCH_MAX_SIZE)
+    {
+      batchStarts.push_back (i);
+      batchSize = 0;
+    }
+    batchSize += entrySize;
+  }
+
+  if (batchStarts.size () <= 1)
+  {
+    return m_sqsclient->SendMessageBatch (request);
+  }
+
+  // the batches go one after the other, their results merged as if sqs had taken them at once
+  SendMessageBatchResult result;
+  SendMessageBatchOutcome firstOutcome;
+  bool anySent = false;
+  for (size_t batch = 0; batch < batchStarts.size (); ++batch)
+  {
+    size_t end = batch + 1 < batchStarts.size () ? batchStarts[batch + 1] : entries.size ();
+    SendMessageBatchRequest batchRequest;
+    static_cast<AmazonWebServiceRequest&> (batchRequest) = request;
+    batchRequest.SetQueueUrl (request.GetQueueUrl ());
+    for (size_t i = batchStarts[batch]; i < end; ++i)
+    {
+      batchRequest.AddEntries (entries[i]);
+    }
+
+    SendMessageBatchOutcome outcome = m_sqsclient->SendMessageBatch (batchRequest);
+    MergeBatchOutcome (result, outcome, batchRequest.GetEntries ());
+    anySent = anySent || outcome.IsSuccess ();
+    if (batch == 0)
+    {
+      firstOutcome = outcome;
+    }
+  }
+
+  // an error only when nothing went through
+  return anySent ? SendMessageBatchOutcome (result) : firstOutcome;
+}
+
+SendMessageBatchOutcome SQSExtendedClient::SendMessageBatchPipelined (const SendMessageBatchRequest& request,
+                                                                     const Aws::Vector<size_t>& largeEntries) const
+{
+  const Aws::Vector<SendMessageBatchRequestEntry>& entries = request.GetEntries ();
+
+  SendMessageBatchRequest inlineRequest;
+  static_cast<AmazonWebServiceRequest&> (inlineRequest) = request;
+  inlineRequest.SetQueueUrl (request.GetQueueUrl ());
+  size_t nextLargeEntry = 0;
+  for (size_t i = 0; i < entries.size (); ++i)
+  {
+    if (nextLargeEntry < largeEntries.size () && largeEntries[nextLargeEntry] == i)
+    {
+      ++nextLargeEntry;
+    }
+    else
+    {
+      inlineRequest.AddEntries (entries[i]);
+    }
+  }
+
+  // results of every batch, and the offloaded entries whose upload is done but that are not sent yet
+  std::mutex mutex;
+  SendMessageBatchResult result;
+  SendMessageBatchOutcome firstOutcome;
+  bool anyOutcome = false;
+  bool anySent = false;
+  bool isSending = false;
+  Aws::Vector<SendMessageBatchRequestEntry> readyEntries;
+
+  auto mergeOutcome = [&result, &firstOutcome, &anyOutcome, &anySent] (const SendMessageBatchOutcome& outcome,
+                                                                       const Aws::Vector<SendMessageBatchRequestEntry>& batchEntries)
+  {
+    MergeBatchOutcome (result, outcome, batchEntries);
+    anySent = anySent || outcome.IsSuccess ();
+    if (!anyOutcome)
+    {
+      firstOutcome = outcome;
+      anyOutcome = true;
+    }
+  };
+
+  // the first task sends the inline entries at once, the others upload a payload each. Whichever upload finishes
+  // while no offloaded batch is in flight sends every entry ready by then, so later uploads are coalesced
+  SQSBoundedTaskRunner taskRunner (m_s3Executor, m_sqsconfig->GetS3MaxConcurrency ());
+  taskRunner.Run (largeEntries.size () + 1, [&] (size_t task)
+  {
+    if (task == 0)
+    {
+      SendMessageBatchOutcome outcome = SQSExtendedClient::SendMessageBatchWithinLimit (inlineRequest);
+      std::lock_guard<std::mutex> lock (mutex);
+      mergeOutcome (outcome, inlineRequest.GetEntries ());
+      return;
+    }
+
+    const SendMessageBatchRequestEntry& entry = entries[largeEntries[task - 1]];
+    SendMessageBatchRequestEntry entryWithS3Support;
+    if (!SQSExtendedClient::CompressMessageBatchInline (entry, entryWithS3Support)
+        && !SQSExtendedClient::StoreMessageBatchInS3 (entry, entryWithS3Support))
+    {
+      std::lock_guard<std::mutex> lock (mutex);
+      result.AddFailed (PayloadNotStoredEntry (entry.GetId ()));
+      return;
+    }
 
-  return SQSClient::SendMessageBatch (reqWithS3Support);
+    std::unique_lock<std::mutex> lock (mutex);
+    readyEntries.push_back (entryWithS3Support);
+    if (isSending)
+    {
+      return;
+    }
+    isSending = true;
+    while (!readyEntries.empty ())
+    {
+      SendMessageBatchRequest batchRequest;
+      static_cast<AmazonWebServiceRequest&> (batchRequest) = request;
+      batchRequest.SetQueueUrl (request.GetQueueUrl ());
+      batchRequest.SetEntries (std::move (readyEntries));
+      readyEntries.clear ();
+
+      lock.unlock ();
+      SendMessageBatchOutcome outcome = SQSExtendedClient::SendMessageBatchWithinLimit (batchRequest);
+      lock.lock ();
+      mergeOutcome (outcome, batchRequest.GetEntries ());
+    }
+    isSending = false;
+  });
+
+  // an error only when nothing went through
+  return anySent ? SendMessageBatchOutcome (result) : firstOutcome;
+}
+
+SendMessageBatchOutcome SQSExtendedClient::SendMessageBulk (const SendMessageBatchRequest& request) const
+{
+  SQSBoundedTaskRunner taskRunner (m_asyncThreadPool, m_sqsconfig->GetAsyncThreadPoolSize ());
+  return RunInBatches<SendMessageBatchRequest, SendMessageBatchResult, SendMessageBatchOutcome> (
+      request, taskRunner, [this] (const SendMessageBatchRequest& batchRequest)
+  {
+    return SQSExtendedClient::SendMessageBatch (batchRequest);
+  });
+}
+
+DeleteMessageBatchOutcome SQSExtendedClient::DeleteMessageBulk (const DeleteMessageBatchRequest& request) const
+{
+  SQSBoundedTaskRunner taskRunner (m_asyncThreadPool, m_sqsconfig->GetAsyncThreadPoolSize ());
+  return RunInBatches<DeleteMessageBatchRequest, DeleteMessageBatchResult, DeleteMessageBatchOutcome> (
+      request, taskRunner, [this] (const DeleteMessageBatchRequest& batchRequest)
+  {
+    return SQSExtendedClient::DeleteMessageBatch (batchRequest);
+  });
 }
 
 DeleteMessageBatchOutcome SQSExtendedClient::DeleteMessageBatch (const DeleteMessageBatchRequest& request) const
 {
   if (!m_sqsconfig->IsLargePayloadSupportEnabled ()) {
-    return SQSClient::DeleteMessageBatch (request);
+    return m_sqsclient->DeleteMessageBatch (request);
   }
 
+  // s3 keys to delete grouped per bucket, along with the id of the entry each one belongs to
+  Aws::Vector<Aws::String> s3BucketNames;
+  Aws::Vector<Aws::Vector<Aws::String> > s3Keys;
+  Aws::Vector<Aws::Vector<Aws::String> > s3KeyEntryIds;
+
   Aws::Vector<DeleteMessageBatchRequestEntry> batchEntries;
-  for (auto entry : request.GetEntries ())
+  for (auto& entry : request.GetEntries ())
   {
-    Aws::String receiptHandle = entry.GetReceiptHandle ();
-    if (receiptHandle.find (S3_BUCKET_NAME_MARKER) != std::string::npos
-        && receiptHandle.find (S3_KEY_MARKER) != std::string::npos)
+    SQSReceiptHandleView receiptHandleView;
+    if (receiptHandleView.Parse (entry.GetReceiptHandle ()))
     {
-      Aws::String s3BucketName = SQSExtendedClient::GetFromReceiptHandleByMarker (receiptHandle, S3_BUCKET_NAME_MARKER);
-      Aws::String s3Key = SQSExtendedClient::GetFromReceiptHandleByMarker (receiptHandle, S3_KEY_MARKER);
-
-      DeleteObjectRequest deleteObjectRequest;
-      deleteObjectRequest.SetBucket (s3BucketName);
-      deleteObjectRequest.SetKey (s3Key);
-      m_sqsconfig->GetS3Client ()->DeleteObject (deleteObjectRequest);
+      Aws::String s3BucketName = receiptHandleView.GetS3BucketName ().ToString ();
+      Aws::String s3Key = receiptHandleView.GetS3Key ().ToString ();
 
-      int lastOccurence = receiptHandle.rfind (S3_KEY_MARKER);
-      Aws::String cleannedReceiptHandle = receiptHandle.substr (lastOccurence + std::string (S3_KEY_MARKER).length ());
+      if (!IsSharedPayloadKey (s3Key))
+      {
+        size_t bucket = std::find (s3BucketNames.begin (), s3BucketNames.end (), s3BucketName) - s3BucketNames.begin ();
+        if (bucket == s3BucketNames.size ())
+        {
+          s3BucketNames.push_back (s3BucketName);
+          s3Keys.resize (bucket + 1);
+          s3KeyEntryIds.resize (bucket + 1);
+        }
+        s3Keys[bucket].push_back (s3Key);
+        s3KeyEntryIds[bucket].push_back (entry.GetId ());
+      }
 
       DeleteMessageBatchRequestEntry entryWithS3Support = entry;
-      entryWithS3Support.SetReceiptHandle (cleannedReceiptHandle);
+      entryWithS3Support.SetReceiptHandle (receiptHandleView.GetSQSReceiptHandle ().ToString ());
 
       batchEntries.push_back (entryWithS3Support);
     }
@@ -204,135 +767,1069 @@ DeleteMessageBatchOutcome SQSExtendedClient::DeleteMessageBatch (const DeleteMes
   DeleteMessageBatchRequest reqWithS3Support = request;
   reqWithS3Support.SetEntries (batchEntries);
 
-  return SQSClient::DeleteMessageBatch (reqWithS3Support);
-
-}
+  // with a reaper the payloads of the entries sqs deleted are left to it
+  std::shared_ptr<SQSS3PayloadReaper> s3PayloadReaper = m_sqsconfig->GetS3PayloadReaper ();
+  if (s3PayloadReaper)
+  {
+    DeleteMessageBatchOutcome outcome = m_sqsclient->DeleteMessageBatch (reqWithS3Support);
+    if (!outcome.IsSuccess ())
+    {
+      return outcome;
+    }
 
-// ---
+    for (auto& entry : outcome.GetResult ().GetSuccessful ())
+    {
+      for (size_t bucket = 0; bucket < s3BucketNames.size (); ++bucket)
+      {
+        for (size_t i = 0; i < s3Keys[bucket].size (); ++i)
+        {
+          if (s3KeyEntryIds[bucket][i] == entry.GetId ())
+          {
+            s3PayloadReaper->Enqueue (s3BucketNames[bucket], s3Keys[bucket][i]);
+          }
+        }
+      }
+    }
+    return outcome;
+  }
 
-// TODO: Need to find a good UUID, but until there, simple randomize it with rand()
-Aws::String SQSExtendedClient::RandomizedS3Key () const
-{
-  srand (time (NULL));
+  // the sqs batch delete runs alongside a single multi-object delete per bucket
+  DeleteMessageBatchOutcome outcome;
+  Aws::Vector<Aws::Vector<Error> > s3Errors (s3BucketNames.size ());
+  SQSBoundedTaskRunner taskRunner (m_s3Executor, m_sqsconfig->GetS3MaxConcurrency ());
+  taskRunner.Run (s3BucketNames.size () + 1, [this, &reqWithS3Support, &outcome, &s3BucketNames, &s3Keys, &s3Errors] (size_t i)
+  {
+    if (i == 0)
+    {
+      outcome = m_sqsclient->DeleteMessageBatch (reqWithS3Support);
+    }
+    else
+    {
+      s3Errors[i - 1] = SQSExtendedClient::DeletePayloadsFromS3 (s3BucketNames[i - 1], s3Keys[i - 1]);
+    }
+  });
 
-  Aws::String randomizedS3Key = RESERVED_ATTRIBUTE_NAME;
-  for (int i = 0; i < 20; ++i)
+  if (!outcome.IsSuccess ())
   {
-    randomizedS3Key += static_cast<char>('a' + rand() % 26);
+    return outcome;
   }
-  return randomizedS3Key.c_str();
-  //return RESERVED_ATTRIBUTE_NAME + Utils::DateTime::Now().CalculateLocalTimestampAsString("%Y%m%dt%H%M%Sz");
-}
 
-unsigned SQSExtendedClient::GetMsgAttributesSize (
-    const Aws::Map<Aws::String, Model::MessageAttributeValue>& messageAttributes) const
-{
-  unsigned size = 0;
+  // entries deleted from sqs whose payload is still in s3 are reported as failed, deleting them again is safe
+  Aws::Map<Aws::String, Error> failedEntries;
+  for (size_t bucket = 0; bucket < s3BucketNames.size (); ++bucket)
+  {
+    for (auto& s3Error : s3Errors[bucket])
+    {
+      for (size_t i = 0; i < s3Keys[bucket].size (); ++i)
+      {
+        if (s3Keys[bucket][i] == s3Error.GetKey ())
+        {
+          failedEntries[s3KeyEntryIds[bucket][i]] = s3Error;
+        }
+      }
+    }
+  }
+  if (failedEntries.empty ())
+  {
+    return outcome;
+  }
 
-  for (auto attribute : messageAttributes)
+  DeleteMessageBatchResult result = outcome.GetResult ();
+  Aws::Vector<DeleteMessageBatchResultEntry> successful;
+  for (auto& entry : outcome.GetResult ().GetSuccessful ())
   {
-    Aws::String key = attribute.first;
-    Model::MessageAttributeValue value = attribute.second;
+    auto failedEntry = failedEntries.find (entry.GetId ());
+    if (failedEntry == failedEntries.end ())
+    {
+      successful.push_back (entry);
+      continue;
+    }
 
-    size += key.size ();
-    size += value.GetDataType ().size ();
-    size += value.GetStringValue ().size ();
-    size += value.GetBinaryValue ().GetLength ();
+    BatchResultErrorEntry errorEntry;
+    errorEntry.SetId (entry.GetId ());
+    errorEntry.SetSenderFault (false);
+    errorEntry.SetCode (failedEntry->second.GetCode ());
+    errorEntry.SetMessage (failedEntry->second.GetMessage ());
+    result.AddFailed (errorEntry);
   }
+  result.SetSuccessful (successful);
 
-  return size;
+  return DeleteMessageBatchOutcome (result);
 }
 
-Aws::String SQSExtendedClient::GetFromReceiptHandleByMarker (const Aws::String receiptHandle, const Aws::String marker) const
+ChangeMessageVisibilityOutcome SQSExtendedClient::ChangeMessageVisibility (const ChangeMessageVisibilityRequest& request) const
 {
-  int firstOccurence = receiptHandle.find (marker);
-  int secondOccurence = receiptHandle.find (marker, firstOccurence + 1);
-  int receiptHandleLenght = secondOccurence - firstOccurence - marker.length ();
-  return receiptHandle.substr (firstOccurence + marker.length (), receiptHandleLenght);
+  if (!m_sqsconfig->IsLargePayloadSupportEnabled ()) {
+    return m_sqsclient->ChangeMessageVisibility (request);
+  }
+
+  ChangeMessageVisibilityRequest reqWithS3Support = request;
+  reqWithS3Support.SetReceiptHandle (SQSExtendedClient::GetSQSReceiptHandle (request.GetReceiptHandle ()));
+  return m_sqsclient->ChangeMessageVisibility (reqWithS3Support);
 }
 
-bool SQSExtendedClient::IsLargeMessage (const SendMessageRequest& request) const
+ChangeMessageVisibilityBatchOutcome SQSExtendedClient::ChangeMessageVisibilityBatch (const ChangeMessageVisibilityBatchRequest& request) const
 {
-  unsigned msgAttributesSize = SQSExtendedClient::GetMsgAttributesSize (request.GetMessageAttributes ());
-  unsigned msgBodySize = request.GetMessageBody ().size ();
-  unsigned totalMsgSize = msgAttributesSize + msgBodySize;
-  return (totalMsgSize > m_sqsconfig->GetMessageSizeThreshold ());
+  if (!m_sqsconfig->IsLargePayloadSupportEnabled ()) {
+    return m_sqsclient->ChangeMessageVisibilityBatch (request);
+  }
+
+  Aws::Vector<ChangeMessageVisibilityBatchRequestEntry> batchEntries = request.GetEntries ();
+  for (auto& entry : batchEntries)
+  {
+    entry.SetReceiptHandle (SQSExtendedClient::GetSQSReceiptHandle (entry.GetReceiptHandle ()));
+  }
+  ChangeMessageVisibilityBatchRequest reqWithS3Support = request;
+  reqWithS3Support.SetEntries (batchEntries);
+  return m_sqsclient->ChangeMessageVisibilityBatch (reqWithS3Support);
 }
 
-bool SQSExtendedClient::IsLargeMessageBatch (const SendMessageBatchRequestEntry& request) const
+void SQSExtendedClient::SendMessageAsync (const SendMessageRequest& request, const SendMessageResponseReceivedHandler& handler,
+                                          const std::shared_ptr<const AsyncCallerContext>& context) const
 {
-  unsigned msgAttributesSize = SQSExtendedClient::GetMsgAttributesSize (request.GetMessageAttributes ());
-  unsigned msgBodySize = request.GetMessageBody ().size ();
-  unsigned totalMsgSize = msgAttributesSize + msgBodySize;
-  return (totalMsgSize > m_sqsconfig->GetMessageSizeThreshold ());
+  SQSExtendedClient::SubmitAsync ([this, request, handler, context] ()
+  {
+    handler (this, request, SQSExtendedClient::SendMessage (request), context);
+  });
 }
 
-SendMessageRequest SQSExtendedClient::StoreMessageInS3 (const SendMessageRequest& request) const
+SendMessageOutcomeCallable SQSExtendedClient::SendMessageCallable (const SendMessageRequest& request) const
 {
-  SendMessageRequest reqWithS3Support = request;
+  auto task = Aws::MakeShared<std::packaged_task<SendMessageOutcome ()> > (ALLOCATION_TAG, [this, request] ()
+  {
+    return SQSExtendedClient::SendMessage (request);
+  });
+  SQSExtendedClient::SubmitAsync ([task] ()
+  {
+    (*task) ();
+  });
+  return task->get_future ();
+}
 
-  Aws::String s3Key = SQSExtendedClient::RandomizedS3Key ();
-  Aws::String body = reqWithS3Support.GetMessageBody ();
-  unsigned size = body.size ();
-  std::shared_ptr<Aws::IOStream> bodyAsStream = Aws::MakeShared<Aws::StringStream> (ALLOCATION_TAG);
-  *bodyAsStream << body;
-  bodyAsStream->flush ();
+void SQSExtendedClient::ReceiveMessageAsync (const ReceiveMessageRequest& request, const ReceiveMessageResponseReceivedHandler& handler,
+                                             const std::shared_ptr<const AsyncCallerContext>& context) const
+{
+  SQSExtendedClient::SubmitAsync ([this, request, handler, context] ()
+  {
+    handler (this, request, SQSExtendedClient::ReceiveMessage (request), context);
+  });
+}
 
-  // Add message attribute as a flag
-  MessageAttributeValue messageAttributeValue;
-  messageAttributeValue.SetDataType ("Number");
-  messageAttributeValue.SetStringValue (std::to_string (size).c_str ());
-  reqWithS3Support.AddMessageAttributes (RESERVED_ATTRIBUTE_NAME, messageAttributeValue);
+ReceiveMessageOutcomeCallable SQSExtendedClient::ReceiveMessageCallable (const ReceiveMessageRequest& request) const
+{
+  auto task = Aws::MakeShared<std::packaged_task<ReceiveMessageOutcome ()> > (ALLOCATION_TAG, [this, request] ()
+  {
+    return SQSExtendedClient::ReceiveMessage (request);
+  });
+  SQSExtendedClient::SubmitAsync ([task] ()
+  {
+    (*task) ();
+  });
+  return task->get_future ();
+}
 
-  // Upload payload to S3
-  PutObjectRequest putObjectRequest;
-  putObjectRequest.SetBucket (m_sqsconfig->GetS3BucketName ());
-  putObjectRequest.SetKey (s3Key);
-  putObjectRequest.SetBody (bodyAsStream);
-  putObjectRequest.SetContentLength (static_cast<long> (putObjectRequest.GetBody ()->tellp ()));
-  PutObjectOutcome putObjectOutcome = m_sqsconfig->GetS3Client ()->PutObject (putObjectRequest);
+void SQSExtendedClient::DeleteMessageAsync (const DeleteMessageRequest& request, const DeleteMessageResponseReceivedHandler& handler,
+                                            const std::shared_ptr<const AsyncCallerContext>& context) const
+{
+  SQSExtendedClient::SubmitAsync ([this, request, handler, context] ()
+  {
+    handler (this, request, SQSExtendedClient::DeleteMessage (request), context);
+  });
+}
+
+DeleteMessageOutcomeCallable SQSExtendedClient::DeleteMessageCallable (const DeleteMessageRequest& request) const
+{
+  auto task = Aws::MakeShared<std::packaged_task<DeleteMessageOutcome ()> > (ALLOCATION_TAG, [this, request] ()
+  {
+    return SQSExtendedClient::DeleteMessage (request);
+  });
+  SQSExtendedClient::SubmitAsync ([task] ()
+  {
+    (*task) ();
+  });
+  return task->get_future ();
+}
+
+void SQSExtendedClient::SendMessageBatchAsync (const SendMessageBatchRequest& request, const SendMessageBatchResponseReceivedHandler& handler,
+                                               const std::shared_ptr<const AsyncCallerContext>& context) const
+{
+  SQSExtendedClient::SubmitAsync ([this, request, handler, context] ()
+  {
+    handler (this, request, SQSExtendedClient::SendMessageBatch (request), context);
+  });
+}
+
+SendMessageBatchOutcomeCallable SQSExtendedClient::SendMessageBatchCallable (const SendMessageBatchRequest& request) const
+{
+  auto task = Aws::MakeShared<std::packaged_task<SendMessageBatchOutcome ()> > (ALLOCATION_TAG, [this, request] ()
+  {
+    return SQSExtendedClient::SendMessageBatch (request);
+  });
+  SQSExtendedClient::SubmitAsync ([task] ()
+  {
+    (*task) ();
+  });
+  return task->get_future ();
+}
+
+void SQSExtendedClient::DeleteMessageBatchAsync (const DeleteMessageBatchRequest& request, const DeleteMessageBatchResponseReceivedHandler& handler,
+                                                 const std::shared_ptr<const AsyncCallerContext>& context) const
+{
+  SQSExtendedClient::SubmitAsync ([this, request, handler, context] ()
+  {
+    handler (this, request, SQSExtendedClient::DeleteMessageBatch (request), context);
+  });
+}
+
+DeleteMessageBatchOutcomeCallable SQSExtendedClient::DeleteMessageBatchCallable (const DeleteMessageBatchRequest& request) const
+{
+  auto task = Aws::MakeShared<std::packaged_task<DeleteMessageBatchOutcome ()> > (ALLOCATION_TAG, [this, request] ()
+  {
+    return SQSExtendedClient::DeleteMessageBatch (request);
+  });
+  SQSExtendedClient::SubmitAsync ([task] ()
+  {
+    (*task) ();
+  });
+  return task->get_future ();
+}
+
+void SQSExtendedClient::ChangeMessageVisibilityAsync (const ChangeMessageVisibilityRequest& request, const ChangeMessageVisibilityResponseReceivedHandler& handler,
+                                                      const std::shared_ptr<const AsyncCallerContext>& context) const
+{
+  SQSExtendedClient::SubmitAsync ([this, request, handler, context] ()
+  {
+    handler (this, request, SQSExtendedClient::ChangeMessageVisibility (request), context);
+  });
+}
+
+ChangeMessageVisibilityOutcomeCallable SQSExtendedClient::ChangeMessageVisibilityCallable (const ChangeMessageVisibilityRequest& request) const
+{
+  auto task = Aws::MakeShared<std::packaged_task<ChangeMessageVisibilityOutcome ()> > (ALLOCATION_TAG, [this, request] ()
+  {
+    return SQSExtendedClient::ChangeMessageVisibility (request);
+  });
+  SQSExtendedClient::SubmitAsync ([task] ()
+  {
+    (*task) ();
+  });
+  return task->get_future ();
+}
+
+void SQSExtendedClient::ChangeMessageVisibilityBatchAsync (const ChangeMessageVisibilityBatchRequest& request, const ChangeMessageVisibilityBatchResponseReceivedHandler& handler,
+                                                           const std::shared_ptr<const AsyncCallerContext>& context) const
+{
+  SQSExtendedClient::SubmitAsync ([this, request, handler, context] ()
+  {
+    handler (this, request, SQSExtendedClient::ChangeMessageVisibilityBatch (request), context);
+  });
+}
+
+ChangeMessageVisibilityBatchOutcomeCallable SQSExtendedClient::ChangeMessageVisibilityBatchCallable (const ChangeMessageVisibilityBatchRequest& request) const
+{
+  auto task = Aws::MakeShared<std::packaged_task<ChangeMessageVisibilityBatchOutcome ()> > (ALLOCATION_TAG, [this, request] ()
+  {
+    return SQSExtendedClient::ChangeMessageVisibilityBatch (request);
+  });
+  SQSExtendedClient::SubmitAsync ([task] ()
+  {
+    (*task) ();
+  });
+  return task->get_future ();
+}
+
+void SQSExtendedClient::SubmitAsync (const std::function<void ()>& operation) const
+{
+  {
+    std::lock_guard<std::mutex> lock (m_asyncMutex);
+    ++m_pendingAsyncOperations;
+  }
+  m_asyncThreadPool->Submit ([this, operation] ()
+  {
+    operation ();
+    std::lock_guard<std::mutex> lock (m_asyncMutex);
+    if (--m_pendingAsyncOperations == 0)
+    {
+      m_asyncDrained.notify_all ();
+    }
+  });
+}
+
+std::shared_ptr<SQSLazyPayload> SQSExtendedClient::GetLazyPayload (const Message& message) const
+{
+  const Aws::Map<Aws::String, MessageAttributeValue>& messageAttributes = message.GetMessageAttributes ();
+  auto sizeAttribute = messageAttributes.find (RESERVED_ATTRIBUTE_NAME);
+  if (sizeAttribute == messageAttributes.end ())
+  {
+    return Aws::MakeShared<SQSLazyPayload> (ALLOCATION_TAG, message.GetBody ());
+  }
+
+  long long size = std::strtoll (sizeAttribute->second.GetStringValue ().c_str (), nullptr, 10);
+  SQSLargeMessageS3Pointer s3Pointer = ParseS3Pointer (message, size);
+  SQSLazyPayload::Loader loader = [this] (const SQSLargeMessageS3Pointer& pointer, Aws::String& payload)
+  {
+    return SQSExtendedClient::LoadPayloadFromS3 (pointer, payload);
+  };
+  SQSLazyPayload::StreamLoader streamLoader = [this] (const SQSLargeMessageS3Pointer& pointer,
+                                                      const Aws::IOStreamFactory& streamFactory)
+  {
+    return SQSExtendedClient::DownloadPayloadFromS3 (pointer, streamFactory);
+  };
+  return Aws::MakeShared<SQSLazyPayload> (ALLOCATION_TAG, s3Pointer, size, loader, streamLoader);
+}
+
+bool SQSExtendedClient::HydrateMessage (Message& message) const
+{
+  Aws::Map<Aws::String, MessageAttributeValue> messageAttributes = message.GetMessageAttributes ();
+  if (messageAttributes.find (RESERVED_ATTRIBUTE_NAME) == messageAttributes.end ())
+  {
+    return true;
+  }
+
+  std::shared_ptr<SQSLazyPayload> payload = SQSExtendedClient::GetLazyPayload (message);
+  if (!payload->Load ())
+  {
+    return false;
+  }
+  message.SetBody (payload->GetBody ());
+
+  // remove largepayload attribute from message
+  messageAttributes.erase (RESERVED_ATTRIBUTE_NAME);
+  message.SetMessageAttributes (messageAttributes);
+  return true;
+}
+
+size_t SQSExtendedClient::GetPendingPayloadSize (const Message& message) const
+{
+  const Aws::Map<Aws::String, MessageAttributeValue>& messageAttributes = message.GetMessageAttributes ();
+  auto sizeAttribute = messageAttributes.find (RESERVED_ATTRIBUTE_NAME);
+  if (sizeAttribute == messageAttributes.end ())
+  {
+    return 0;
+  }
+  return std::strtoul (sizeAttribute->second.GetStringValue ().c_str (), nullptr, 10);
+}
+
+// ---
+
+Aws::String SQSExtendedClient::RandomizedS3Key () const
+{
+  return m_sqsconfig->GetS3KeyGenerator ()->GenerateKey ();
+}
+
+unsigned SQSExtendedClient::GetMsgAttributesSize (
+    const Aws::Map<Aws::String, Model::MessageAttributeValue>& messageAttributes) const
+{
+  unsigned size = 0;
+
+  for (auto attribute : messageAttributes)
+  {
+    Aws::String key = attribute.first;
+    Model::MessageAttributeValue value = attribute.second;
+
+    size += key.size ();
+    size += value.GetDataType ().size ();
+    size += value.GetStringValue ().size ();
+    size += value.GetBinaryValue ().GetLength ();
+    for (auto& stringValue : value.GetStringListValues ())
+    {
+      size += stringValue.size ();
+    }
+    for (auto& binaryValue : value.GetBinaryListValues ())
+    {
+      size += binaryValue.GetLength ();
+    }
+  }
+
+  return size;
+}
+
+Aws::String SQSExtendedClient::GetSQSReceiptHandle (const Aws::String& receiptHandle) const
+{
+  SQSReceiptHandleView receiptHandleView;
+  receiptHandleView.Parse (receiptHandle);
+  return receiptHandleView.GetSQSReceiptHandle ().ToString ();
+}
 
-  // Get S3 Handler/Pointer
+Aws::String SQSExtendedClient::BuildReceiptHandle (const SQSLargeMessageS3Pointer& s3Pointer,
+                                                   const Aws::String& sqsReceiptHandle) const
+{
+  if (m_sqsconfig->IsReceiptHandleEnvelopeEnabled ())
+  {
+    return SQSReceiptHandleView::Envelope (s3Pointer.GetS3BucketName (), s3Pointer.GetS3Key (), sqsReceiptHandle);
+  }
+  return SQSReceiptHandleView::EmbedWithMarkers (s3Pointer.GetS3BucketName (), s3Pointer.GetS3Key (), sqsReceiptHandle);
+}
+
+bool SQSExtendedClient::IsLargeMessage (const SendMessageRequest& request) const
+{
+  unsigned msgAttributesSize = SQSExtendedClient::GetMsgAttributesSize (request.GetMessageAttributes ());
+  unsigned msgBodySize = request.GetMessageBody ().size ();
+  unsigned totalMsgSize = msgAttributesSize + msgBodySize;
+  return (totalMsgSize > m_sqsconfig->GetMessageSizeThreshold ());
+}
+
+bool SQSExtendedClient::IsLargeMessageBatch (const SendMessageBatchRequestEntry& request) const
+{
+  unsigned msgAttributesSize = SQSExtendedClient::GetMsgAttributesSize (request.GetMessageAttributes ());
+  unsigned msgBodySize = request.GetMessageBody ().size ();
+  unsigned totalMsgSize = msgAttributesSize + msgBodySize;
+  return (totalMsgSize > m_sqsconfig->GetMessageSizeThreshold ());
+}
+
+bool SQSExtendedClient::StoreMessageInS3 (const SendMessageRequest& request, SendMessageRequest& reqWithS3Support) const
+{
   SQSLargeMessageS3Pointer s3Pointer;
-  s3Pointer.SetS3BucketName (m_sqsconfig->GetS3BucketName ());
-  s3Pointer.SetS3Key (s3Key);
-  JsonValue json = s3Pointer.Jsonize ();
-  reqWithS3Support.SetMessageBody (json.WriteReadable ());
+  if (!SQSExtendedClient::StoreMessageBodyInS3 (request.GetMessageBody (), s3Pointer))
+  {
+    return false;
+  }
+  reqWithS3Support = PointToS3 (request, SQSExtendedClient::SerializeS3Pointer (s3Pointer));
+  return true;
+}
+
+bool SQSExtendedClient::StoreMessageBatchInS3 (const SendMessageBatchRequestEntry& request,
+                                               SendMessageBatchRequestEntry& reqWithS3Support) const
+{
+  SQSLargeMessageS3Pointer s3Pointer;
+  if (!SQSExtendedClient::StoreMessageBodyInS3 (request.GetMessageBody (), s3Pointer))
+  {
+    return false;
+  }
+  reqWithS3Support = PointToS3 (request, SQSExtendedClient::SerializeS3Pointer (s3Pointer));
+  return true;
+}
+
+Aws::String SQSExtendedClient::SerializeS3Pointer (const SQSLargeMessageS3Pointer& s3Pointer) const
+{
+  if (m_sqsconfig->IsCompactS3PointerEnabled ())
+  {
+    return s3Pointer.Serialize ();
+  }
+  return s3Pointer.Jsonize ().WriteCompact ();
+}
+
+bool SQSExtendedClient::StoreMessageBatchPackInS3 (const Aws::Vector<const SendMessageBatchRequestEntry*>& requests,
+                                                   Aws::Vector<SendMessageBatchRequestEntry>& reqsWithS3Support) const
+{
+  // encode every payload on its own, so each one can be decoded from its range alone
+  std::shared_ptr<SQSPayloadCodec> payloadCodec = m_sqsconfig->GetPayloadCodec ();
+  Aws::Vector<Aws::String> encodedBodies (requests.size ());
+  Aws::Vector<char> isEncoded (requests.size (), 0);
+  if (payloadCodec)
+  {
+    SQSBoundedTaskRunner taskRunner (m_s3Executor, m_sqsconfig->GetS3MaxConcurrency ());
+    taskRunner.Run (requests.size (), [&payloadCodec, &requests, &encodedBodies, &isEncoded] (size_t i)
+    {
+      const Aws::String& body = requests[i]->GetMessageBody ();
+      isEncoded[i] = payloadCodec->Encode (body.c_str (), body.size (), encodedBodies[i]);
+    });
+  }
+
+  // the pack key carries its own marker, so deletes can tell it is shared by the whole batch
+  SQSLargeMessageS3Pointer packPointer;
+  packPointer.SetS3BucketName (m_sqsconfig->GetS3BucketName ());
+  packPointer.SetS3Key (m_sqsconfig->GetS3KeyGenerator ()->GenerateKey (
+      PACKED_KEY_PREFIX + SQSUuidS3KeyGenerator ().GenerateKey ()));
+
+  size_t packLength = 0;
+  for (size_t i = 0; i < requests.size (); ++i)
+  {
+    packLength += isEncoded[i] ? encodedBodies[i].size () : requests[i]->GetMessageBody ().size ();
+  }
+
+  Aws::String pack;
+  pack.reserve (packLength);
+  Aws::Vector<SQSLargeMessageS3Pointer> s3Pointers (requests.size (), packPointer);
+  for (size_t i = 0; i < requests.size (); ++i)
+  {
+    const Aws::String& storedBody = isEncoded[i] ? encodedBodies[i] : requests[i]->GetMessageBody ();
+    if (isEncoded[i])
+    {
+      s3Pointers[i].SetCodec (payloadCodec->GetName ());
+    }
+    s3Pointers[i].SetS3Offset (static_cast<long long> (pack.size ()));
+    s3Pointers[i].SetS3Length (static_cast<long long> (storedBody.size ()));
+    pack.append (storedBody);
+  }
+
+  if (!SQSExtendedClient::StorePayloadInS3 (packPointer.GetS3Key (), pack.c_str (), pack.size ()))
+  {
+    return false;
+  }
 
-  return reqWithS3Support;
+  reqsWithS3Support.reserve (requests.size ());
+  for (size_t i = 0; i < requests.size (); ++i)
+  {
+    reqsWithS3Support.push_back (PointToS3 (*requests[i], SQSExtendedClient::SerializeS3Pointer (s3Pointers[i])));
+  }
+  return true;
 }
 
-SendMessageBatchRequestEntry SQSExtendedClient::StoreMessageBatchInS3 (const SendMessageBatchRequestEntry& request) const
+bool SQSExtendedClient::CompressMessageInline (const SendMessageRequest& request,
+                                               SendMessageRequest& reqWithInlineSupport) const
 {
-  SendMessageBatchRequestEntry reqWithS3Support = request;
+  Aws::String inlineBody;
+  if (m_sqsconfig->IsAlwaysThroughS3 () || !m_sqsconfig->IsInlineCompressionEnabled ()
+      || !SQSExtendedClient::EncodeMessageBodyInline (request.GetMessageBody (), request.GetMessageAttributes (), inlineBody))
+  {
+    return false;
+  }
 
-  Aws::String s3Key = SQSExtendedClient::RandomizedS3Key ();
-  Aws::String body = reqWithS3Support.GetMessageBody ();
-  unsigned size = body.size ();
-  std::shared_ptr<Aws::IOStream> bodyAsStream = Aws::MakeShared<Aws::StringStream> (ALLOCATION_TAG);
-  *bodyAsStream << body;
-  bodyAsStream->flush ();
+  reqWithInlineSupport = CopyWithoutBody (request);
 
   // Add message attribute as a flag
   MessageAttributeValue messageAttributeValue;
-  messageAttributeValue.SetDataType ("Number");
-  messageAttributeValue.SetStringValue (std::to_string (size).c_str ());
-  reqWithS3Support.AddMessageAttributes (RESERVED_ATTRIBUTE_NAME, messageAttributeValue);
+  messageAttributeValue.SetDataType ("String");
+  messageAttributeValue.SetStringValue (SQSDeflateCodec::NAME);
+  reqWithInlineSupport.AddMessageAttributes (INLINE_CODEC_ATTRIBUTE_NAME, messageAttributeValue);
+  reqWithInlineSupport.SetMessageBody (inlineBody);
+
+  return true;
+}
+
+bool SQSExtendedClient::CompressMessageBatchInline (const SendMessageBatchRequestEntry& request,
+                                                    SendMessageBatchRequestEntry& reqWithInlineSupport) const
+{
+  Aws::String inlineBody;
+  if (m_sqsconfig->IsAlwaysThroughS3 () || !m_sqsconfig->IsInlineCompressionEnabled ()
+      || !SQSExtendedClient::EncodeMessageBodyInline (request.GetMessageBody (), request.GetMessageAttributes (), inlineBody))
+  {
+    return false;
+  }
+
+  reqWithInlineSupport = CopyWithoutBody (request);
+
+  // Add message attribute as a flag
+  MessageAttributeValue messageAttributeValue;
+  messageAttributeValue.SetDataType ("String");
+  messageAttributeValue.SetStringValue (SQSDeflateCodec::NAME);
+  reqWithInlineSupport.AddMessageAttributes (INLINE_CODEC_ATTRIBUTE_NAME, messageAttributeValue);
+  reqWithInlineSupport.SetMessageBody (inlineBody);
+
+  return true;
+}
+
+bool SQSExtendedClient::EncodeMessageBodyInline (const Aws::String& body,
+                                                 const Aws::Map<Aws::String, MessageAttributeValue>& messageAttributes,
+                                                 Aws::String& inlineBody) const
+{
+  unsigned messageSizeThreshold = m_sqsconfig->GetMessageSizeThreshold ();
+  unsigned msgAttributesSize = SQSExtendedClient::GetMsgAttributesSize (messageAttributes);
+  msgAttributesSize += strlen (INLINE_CODEC_ATTRIBUTE_NAME) + strlen ("String") + strlen (SQSDeflateCodec::NAME);
+  if (msgAttributesSize >= messageSizeThreshold || body.size () > MAX_INLINE_COMPRESSION_RATIO * messageSizeThreshold)
+  {
+    return false;
+  }
+
+  // fastest level, this runs on the send path of every large message. Deflate stops once the output could no
+  // longer fit as base64 next to the attributes, so a body bound for s3 is never deflated as a whole here
+  SQSDeflateCodec inlineCodec (1);
+  size_t maxEncodedLength = (messageSizeThreshold - msgAttributesSize) / 4 * 3;
+  Aws::String encodedBody;
+  if (!inlineCodec.EncodeWithin (body.c_str (), body.size (), std::min (maxEncodedLength, body.size ()), encodedBody))
+  {
+    return false;
+  }
+
+  ByteBuffer encodedBuffer (reinterpret_cast<const unsigned char*> (encodedBody.c_str ()), encodedBody.size ());
+  inlineBody = HashingUtils::Base64Encode (encodedBuffer);
+  return true;
+}
+
+bool SQSExtendedClient::DecodeMessageBodyInline (const Aws::String& inlineBody, const Aws::String& codecName,
+                                                 Aws::String& body) const
+{
+  std::shared_ptr<SQSPayloadCodec> payloadCodec = m_sqsconfig->GetPayloadCodec (codecName);
+  if (!payloadCodec)
+  {
+    return false;
+  }
+
+  ByteBuffer encodedBuffer = HashingUtils::Base64Decode (inlineBody);
+  SQSPayloadStream encodedBody (reinterpret_cast<const char*> (encodedBuffer.GetUnderlyingData ()),
+                                encodedBuffer.GetLength ());
+  return payloadCodec->Decode (encodedBody, body);
+}
+
+bool SQSExtendedClient::StoreMessageBodyInS3 (const Aws::String& body, SQSLargeMessageS3Pointer& s3Pointer) const
+{
+  s3Pointer.SetS3BucketName (m_sqsconfig->GetS3BucketName ());
+
+  // Store the encoded payload when the codec shrinks it, otherwise straight from the caller's buffer
+  std::shared_ptr<SQSPayloadCodec> payloadCodec = m_sqsconfig->GetPayloadCodec ();
+  Aws::String encodedBody;
+  const Aws::String* storedBody = &body;
+  if (payloadCodec && payloadCodec->Encode (body.c_str (), body.size (), encodedBody))
+  {
+    s3Pointer.SetCodec (payloadCodec->GetName ());
+    storedBody = &encodedBody;
+  }
+
+  if (m_sqsconfig->IsPayloadDeduplicationEnabled ())
+  {
+    // identical payloads share one object, keyed by the digest of the stored bytes
+    ByteBuffer digest = HashingUtils::CalculateSHA256 (*storedBody);
+    s3Pointer.SetS3Key (m_sqsconfig->GetS3KeyGenerator ()->GenerateKey (
+        CONTENT_ADDRESSED_KEY_PREFIX + HashingUtils::HexEncode (digest)));
+    return SQSExtendedClient::StoreSharedPayloadInS3 (s3Pointer.GetS3Key (), storedBody->c_str (), storedBody->size ());
+  }
+
+  s3Pointer.SetS3Key (SQSExtendedClient::RandomizedS3Key ());
+  return SQSExtendedClient::StorePayloadInS3 (s3Pointer.GetS3Key (), storedBody->c_str (), storedBody->size ());
+}
+
+void SQSExtendedClient::LoadPayloadsFromS3 (const Aws::Vector<SQSLargeMessageS3Pointer>& s3Pointers,
+                                            Aws::Vector<Aws::String>& payloads, Aws::Vector<char>& isLoaded) const
+{
+  // group the payloads packed in the same object, ordered by offset
+  Aws::Vector<Aws::Vector<size_t> > reads;
+  Aws::Map<Aws::String, Aws::Vector<size_t> > packs;
+  for (size_t i = 0; i < s3Pointers.size (); ++i)
+  {
+    if (!s3Pointers[i].S3LengthHasBeenSet ())
+    {
+      reads.push_back (Aws::Vector<size_t> (1, i));
+    }
+    else if (s3Pointers[i].GetS3Length () == 0)
+    {
+      isLoaded[i] = 1;
+    }
+    else
+    {
+      packs[s3Pointers[i].GetS3BucketName () + "/" + s3Pointers[i].GetS3Key ()].push_back (i);
+    }
+  }
+
+  // neighbours in a pack are read with one ranged get, as long as little of what lies between is wasted
+  for (auto& pack : packs)
+  {
+    Aws::Vector<size_t>& packed = pack.second;
+    std::sort (packed.begin (), packed.end (), [&s3Pointers] (size_t a, size_t b)
+    {
+      return s3Pointers[a].GetS3Offset () < s3Pointers[b].GetS3Offset ();
+    });
+
+    size_t firstRead = reads.size ();
+    long long readEnd = 0;
+    for (size_t i : packed)
+    {
+      const SQSLargeMessageS3Pointer& s3Pointer = s3Pointers[i];
+      if (reads.size () == firstRead || s3Pointer.GetS3Offset () - readEnd > MAX_MERGED_READ_GAP)
+      {
+        reads.push_back (Aws::Vector<size_t> ());
+      }
+      reads.back ().push_back (i);
+      readEnd = std::max (readEnd, s3Pointer.GetS3Offset () + s3Pointer.GetS3Length ());
+    }
+  }
+
+  // fetch concurrently, every read fills its own payloads so the messages keep their order
+  SQSBoundedTaskRunner taskRunner (m_s3Executor, m_sqsconfig->GetS3MaxConcurrency ());
+  taskRunner.Run (reads.size (), [this, &reads, &s3Pointers, &payloads, &isLoaded] (size_t r)
+  {
+    const Aws::Vector<size_t>& read = reads[r];
+    if (read.size () == 1)
+    {
+      isLoaded[read[0]] = SQSExtendedClient::LoadPayloadFromS3 (s3Pointers[read[0]], payloads[read[0]]);
+    }
+    else if (SQSExtendedClient::LoadPackedPayloadsFromS3 (s3Pointers, read, payloads))
+    {
+      for (size_t i : read)
+      {
+        isLoaded[i] = 1;
+      }
+    }
+  });
+}
+
+bool SQSExtendedClient::LoadPayloadFromS3 (const SQSLargeMessageS3Pointer& s3Pointer, Aws::String& payload) const
+{
+  std::shared_ptr<SQSPayloadCodec> payloadCodec;
+  if (!s3Pointer.GetCodec ().empty ())
+  {
+    payloadCodec = m_sqsconfig->GetPayloadCodec (s3Pointer.GetCodec ());
+    if (!payloadCodec)
+    {
+      return false;
+    }
+  }
+
+  if (!payloadCodec && s3Pointer.S3LengthHasBeenSet ()
+      && s3Pointer.GetS3Length () >= m_sqsconfig->GetRangedDownloadThreshold ())
+  {
+    return SQSExtendedClient::LoadRangedPayloadFromS3 (s3Pointer, payload);
+  }
+
+  GetObjectRequest getObjectRequest;
+  getObjectRequest.SetBucket (s3Pointer.GetS3BucketName ());
+  getObjectRequest.SetKey (s3Pointer.GetS3Key ());
+  if (s3Pointer.S3LengthHasBeenSet ())
+  {
+    getObjectRequest.SetRange (ByteRange (s3Pointer.GetS3Offset (), s3Pointer.GetS3Length ()));
+  }
+  GetObjectOutcome getObjectOutcome = m_sqsconfig->GetS3Client ()->GetObject (getObjectRequest);
+  if (!getObjectOutcome.IsSuccess ())
+  {
+    return false;
+  }
+
+  // decode while reading, the stored object is never held in memory as a whole
+  Aws::IOStream& storedPayload = getObjectOutcome.GetResult ().GetBody ();
+  if (payloadCodec)
+  {
+    return payloadCodec->Decode (storedPayload, payload);
+  }
+
+  char chunk[S3_READ_CHUNK_SIZE];
+  while (storedPayload.read (chunk, sizeof (chunk)) || storedPayload.gcount () > 0)
+  {
+    payload.append (chunk, static_cast<size_t> (storedPayload.gcount ()));
+  }
+  return true;
+}
+
+bool SQSExtendedClient::LoadRangedPayloadFromS3 (const SQSLargeMessageS3Pointer& s3Pointer, Aws::String& payload) const
+{
+  size_t length = static_cast<size_t> (s3Pointer.GetS3Length ());
+  size_t partSize = m_sqsconfig->GetRangedDownloadPartSize ();
+  size_t partCount = (length + partSize - 1) / partSize;
+
+  // every part is written in place into its own slot of the pre-sized payload
+  size_t payloadLength = payload.size ();
+  payload.resize (payloadLength + length);
+  char* destination = &payload[payloadLength];
+
+  std::atomic<bool> failed (false);
+  SQSBoundedTaskRunner taskRunner (m_s3Executor, m_sqsconfig->GetS3MaxConcurrency ());
+  taskRunner.Run (partCount, [&] (size_t part)
+  {
+    size_t offset = part * partSize;
+    size_t partLength = std::min (partSize, length - offset);
+    char* partDestination = destination + offset;
+
+    // a failed part is fetched again on its own, the other parts are kept
+    for (unsigned attempt = 0; !failed && attempt <= m_sqsconfig->GetS3MaxRetries (); ++attempt)
+    {
+      GetObjectRequest getObjectRequest;
+      getObjectRequest.SetBucket (s3Pointer.GetS3BucketName ());
+      getObjectRequest.SetKey (s3Pointer.GetS3Key ());
+      getObjectRequest.SetRange (ByteRange (s3Pointer.GetS3Offset () + offset, partLength));
+      getObjectRequest.SetResponseStreamFactory ([partDestination, partLength] ()
+      {
+        return Aws::New<SQSPayloadRegionStream> (ALLOCATION_TAG, partDestination, partLength);
+      });
+      GetObjectOutcome getObjectOutcome = m_sqsconfig->GetS3Client ()->GetObject (getObjectRequest);
+
+      if (getObjectOutcome.IsSuccess ())
+      {
+        Aws::IOStream& partStream = getObjectOutcome.GetResult ().GetBody ();
+        if (partStream.good () && partStream.tellp () == static_cast<std::streamoff> (partLength))
+        {
+          return;
+        }
+        // a connection cut short leaves the part incomplete, it is worth another try
+        continue;
+      }
+
+      if (!getObjectOutcome.GetError ().ShouldRetry ())
+      {
+        break;
+      }
+    }
+    failed = true;
+  });
+
+  if (failed)
+  {
+    payload.resize (payloadLength);
+    return false;
+  }
+  return true;
+}
+
+bool SQSExtendedClient::DownloadPayloadFromS3 (const SQSLargeMessageS3Pointer& s3Pointer,
+                                               const Aws::IOStreamFactory& streamFactory) const
+{
+  std::shared_ptr<SQSPayloadCodec> payloadCodec;
+  if (!s3Pointer.GetCodec ().empty ())
+  {
+    payloadCodec = m_sqsconfig->GetPayloadCodec (s3Pointer.GetCodec ());
+    if (!payloadCodec)
+    {
+      return false;
+    }
+  }
+
+  GetObjectRequest getObjectRequest;
+  getObjectRequest.SetBucket (s3Pointer.GetS3BucketName ());
+  getObjectRequest.SetKey (s3Pointer.GetS3Key ());
+  if (s3Pointer.S3LengthHasBeenSet ())
+  {
+    getObjectRequest.SetRange (ByteRange (s3Pointer.GetS3Offset (), s3Pointer.GetS3Length ()));
+  }
+
+  // a raw payload goes straight from the connection to the caller's stream
+  if (!payloadCodec)
+  {
+    getObjectRequest.SetResponseStreamFactory (streamFactory);
+    GetObjectOutcome getObjectOutcome = m_sqsconfig->GetS3Client ()->GetObject (getObjectRequest);
+    return getObjectOutcome.IsSuccess () && getObjectOutcome.GetResult ().GetBody ().good ();
+  }
+
+  GetObjectOutcome getObjectOutcome = m_sqsconfig->GetS3Client ()->GetObject (getObjectRequest);
+  if (!getObjectOutcome.IsSuccess ())
+  {
+    return false;
+  }
+
+  Aws::IOStream* destination = streamFactory ();
+  bool isDecoded = payloadCodec->Decode (getObjectOutcome.GetResult ().GetBody (), *destination);
+  Aws::Delete (destination);
+  return isDecoded;
+}
+
+bool SQSExtendedClient::LoadPackedPayloadsFromS3 (const Aws::Vector<SQSLargeMessageS3Pointer>& s3Pointers,
+                                                  const Aws::Vector<size_t>& packed,
+                                                  Aws::Vector<Aws::String>& payloads) const
+{
+  const SQSLargeMessageS3Pointer& first = s3Pointers[packed.front ()];
+  long long readOffset = first.GetS3Offset ();
+  long long readEnd = readOffset;
+  for (size_t i : packed)
+  {
+    readEnd = std::max (readEnd, s3Pointers[i].GetS3Offset () + s3Pointers[i].GetS3Length ());
+  }
+
+  GetObjectRequest getObjectRequest;
+  getObjectRequest.SetBucket (first.GetS3BucketName ());
+  getObjectRequest.SetKey (first.GetS3Key ());
+  getObjectRequest.SetRange (ByteRange (readOffset, readEnd - readOffset));
+  GetObjectOutcome getObjectOutcome = m_sqsconfig->GetS3Client ()->GetObject (getObjectRequest);
+  if (!getObjectOutcome.IsSuccess ())
+  {
+    return false;
+  }
+
+  Aws::IOStream& storedRange = getObjectOutcome.GetResult ().GetBody ();
+  Aws::String range;
+  range.resize (static_cast<size_t> (readEnd - readOffset));
+  storedRange.read (&range[0], static_cast<std::streamsize> (range.size ()));
+  if (static_cast<size_t> (storedRange.gcount ()) != range.size ())
+  {
+    return false;
+  }
+
+  // every payload is cut from the range in place
+  for (size_t i : packed)
+  {
+    const SQSLargeMessageS3Pointer& s3Pointer = s3Pointers[i];
+    const char* storedPayload = range.c_str () + (s3Pointer.GetS3Offset () - readOffset);
+    size_t storedLength = static_cast<size_t> (s3Pointer.GetS3Length ());
+    if (s3Pointer.GetCodec ().empty ())
+    {
+      payloads[i].append (storedPayload, storedLength);
+      continue;
+    }
+
+    std::shared_ptr<SQSPayloadCodec> payloadCodec = m_sqsconfig->GetPayloadCodec (s3Pointer.GetCodec ());
+    SQSPayloadStream storedStream (storedPayload, storedLength);
+    if (!payloadCodec || !payloadCodec->Decode (storedStream, payloads[i]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SQSExtendedClient::StoreSharedPayloadInS3 (const Aws::String& s3Key, const char* payload, size_t length) const
+{
+  Aws::String s3BucketName = m_sqsconfig->GetS3BucketName ();
+  Aws::String cacheKey = s3BucketName + "/" + s3Key;
+  if (m_payloadDigestCache->Contains (cacheKey))
+  {
+    return true;
+  }
+
+  HeadObjectRequest headObjectRequest;
+  headObjectRequest.SetBucket (s3BucketName);
+  headObjectRequest.SetKey (s3Key);
+  HeadObjectOutcome headObjectOutcome = m_sqsconfig->GetS3Client ()->HeadObject (headObjectRequest);
+
+  // an object stored too long ago is uploaded again, which restarts its lifecycle expiry. One reused is cached as
+  // old as s3 says it is, so the cache lets it go when it would have to be uploaded again
+  if (headObjectOutcome.IsSuccess ())
+  {
+    long long ageMillis = std::max (0LL, static_cast<long long> (
+        DateTime::Now ().Millis () - headObjectOutcome.GetResult ().GetLastModified ().Millis ()));
+    std::chrono::milliseconds age (ageMillis);
+    if (age < PayloadReuseWindow (*m_sqsconfig))
+    {
+      m_payloadDigestCache->Add (cacheKey, age);
+      return true;
+    }
+  }
+
+  if (SQSExtendedClient::StorePayloadInS3 (s3Key, payload, length))
+  {
+    m_payloadDigestCache->Add (cacheKey);
+    return true;
+  }
+
+  return false;
+}
+
+void SQSExtendedClient::DeletePayloadFromS3 (const Aws::String& s3BucketName, const Aws::String& s3Key) const
+{
+  if (IsSharedPayloadKey (s3Key))
+  {
+    return;
+  }
+
+  DeleteObjectRequest deleteObjectRequest;
+  deleteObjectRequest.SetBucket (s3BucketName);
+  deleteObjectRequest.SetKey (s3Key);
+  m_sqsconfig->GetS3Client ()->DeleteObject (deleteObjectRequest);
+}
+
+Aws::Vector<Error> SQSExtendedClient::DeletePayloadsFromS3 (const Aws::String& s3BucketName,
+                                                           const Aws::Vector<Aws::String>& s3Keys) const
+{
+  Aws::Vector<Error> s3Errors;
+  for (size_t first = 0; first < s3Keys.size (); first += DELETE_OBJECTS_MAX_KEYS)
+  {
+    size_t last = std::min (first + DELETE_OBJECTS_MAX_KEYS, s3Keys.size ());
+
+    // quiet mode only reports the keys that could not be deleted
+    Aws::S3::Model::Delete objectsToDelete;
+    objectsToDelete.SetQuiet (true);
+    for (size_t i = first; i < last; ++i)
+    {
+      ObjectIdentifier objectIdentifier;
+      objectIdentifier.SetKey (s3Keys[i]);
+      objectsToDelete.AddObjects (objectIdentifier);
+    }
+
+    DeleteObjectsRequest deleteObjectsRequest;
+    deleteObjectsRequest.SetBucket (s3BucketName);
+    deleteObjectsRequest.SetDelete (objectsToDelete);
+    DeleteObjectsOutcome deleteObjectsOutcome = m_sqsconfig->GetS3Client ()->DeleteObjects (deleteObjectsRequest);
+    if (deleteObjectsOutcome.IsSuccess ())
+    {
+      const Aws::Vector<Error>& errors = deleteObjectsOutcome.GetResult ().GetErrors ();
+      s3Errors.insert (s3Errors.end (), errors.begin (), errors.end ());
+      continue;
+    }
+
+    for (size_t i = first; i < last; ++i)
+    {
+      Error s3Error;
+      s3Error.SetKey (s3Keys[i]);
+      s3Error.SetCode (deleteObjectsOutcome.GetError ().GetExceptionName ());
+      s3Error.SetMessage (deleteObjectsOutcome.GetError ().GetMessage ());
+      s3Errors.push_back (s3Error);
+    }
+  }
+
+  return s3Errors;
+}
+
+bool SQSExtendedClient::StorePayloadInS3 (const Aws::String& s3Key, const char* payload, size_t length) const
+{
+  if (length >= m_sqsconfig->GetMultipartUploadThreshold ())
+  {
+    return SQSExtendedClient::StoreMultipartPayloadInS3 (s3Key, payload, length);
+  }
 
-  // Upload payload to S3
   PutObjectRequest putObjectRequest;
   putObjectRequest.SetBucket (m_sqsconfig->GetS3BucketName ());
   putObjectRequest.SetKey (s3Key);
-  putObjectRequest.SetBody (bodyAsStream);
-  putObjectRequest.SetContentLength (static_cast<long> (putObjectRequest.GetBody ()->tellp ()));
+  putObjectRequest.SetBody (Aws::MakeShared<SQSPayloadStream> (ALLOCATION_TAG, payload, length));
+  putObjectRequest.SetContentLength (static_cast<long> (length));
   PutObjectOutcome putObjectOutcome = m_sqsconfig->GetS3Client ()->PutObject (putObjectRequest);
+  return putObjectOutcome.IsSuccess ();
+}
 
-  // Get S3 Handler/Pointer
-  SQSLargeMessageS3Pointer s3Pointer;
-  s3Pointer.SetS3BucketName (m_sqsconfig->GetS3BucketName ());
-  s3Pointer.SetS3Key (s3Key);
-  JsonValue json = s3Pointer.Jsonize ();
-  reqWithS3Support.SetMessageBody (json.WriteReadable ());
+bool SQSExtendedClient::StoreMultipartPayloadInS3 (const Aws::String& s3Key, const char* payload, size_t length) const
+{
+  std::shared_ptr<S3::S3Client> s3Client = m_sqsconfig->GetS3Client ();
+  Aws::String s3BucketName = m_sqsconfig->GetS3BucketName ();
+
+  CreateMultipartUploadRequest createMultipartUploadRequest;
+  createMultipartUploadRequest.SetBucket (s3BucketName);
+  createMultipartUploadRequest.SetKey (s3Key);
+  CreateMultipartUploadOutcome createMultipartUploadOutcome = s3Client->CreateMultipartUpload (
+      createMultipartUploadRequest);
+  if (!createMultipartUploadOutcome.IsSuccess ())
+  {
+    return false;
+  }
+  Aws::String uploadId = createMultipartUploadOutcome.GetResult ().GetUploadId ();
+
+  // grow the parts when the payload would need more than s3 allows
+  size_t partSize = std::max (static_cast<size_t> (m_sqsconfig->GetMultipartUploadPartSize ()),
+                              (length + MULTIPART_UPLOAD_MAX_PARTS - 1) / MULTIPART_UPLOAD_MAX_PARTS);
+  size_t partCount = (length + partSize - 1) / partSize;
+
+  // upload parts concurrently, each one read in place from the payload and retried on its own
+  Aws::Vector<CompletedPart> completedParts (partCount);
+  std::atomic<bool> failed (false);
+  SQSBoundedTaskRunner taskRunner (m_s3Executor, m_sqsconfig->GetS3MaxConcurrency ());
+  taskRunner.Run (partCount, [&] (size_t part)
+  {
+    size_t offset = part * partSize;
+    size_t partLength = std::min (partSize, length - offset);
+    int partNumber = static_cast<int> (part + 1);
+
+    for (unsigned attempt = 0; !failed && attempt <= m_sqsconfig->GetS3MaxRetries (); ++attempt)
+    {
+      UploadPartRequest uploadPartRequest;
+      uploadPartRequest.SetBucket (s3BucketName);
+      uploadPartRequest.SetKey (s3Key);
+      uploadPartRequest.SetUploadId (uploadId);
+      uploadPartRequest.SetPartNumber (partNumber);
+      uploadPartRequest.SetBody (Aws::MakeShared<SQSPayloadStream> (ALLOCATION_TAG, payload + offset, partLength));
+      uploadPartRequest.SetContentLength (static_cast<long> (partLength));
+      UploadPartOutcome uploadPartOutcome = s3Client->UploadPart (uploadPartRequest);
+
+      if (uploadPartOutcome.IsSuccess ())
+      {
+        completedParts[part].SetPartNumber (partNumber);
+        completedParts[part].SetETag (uploadPartOutcome.GetResult ().GetETag ());
+        return;
+      }
+
+      if (!uploadPartOutcome.GetError ().ShouldRetry ())
+      {
+        break;
+      }
+    }
+    failed = true;
+  });
+
+  if (!failed)
+  {
+    CompletedMultipartUpload completedMultipartUpload;
+    completedMultipartUpload.SetParts (completedParts);
+
+    CompleteMultipartUploadRequest completeMultipartUploadRequest;
+    completeMultipartUploadRequest.SetBucket (s3BucketName);
+    completeMultipartUploadRequest.SetKey (s3Key);
+    completeMultipartUploadRequest.SetUploadId (uploadId);
+    completeMultipartUploadRequest.SetMultipartUpload (completedMultipartUpload);
+    CompleteMultipartUploadOutcome completeMultipartUploadOutcome = s3Client->CompleteMultipartUpload (
+        completeMultipartUploadRequest);
+    if (completeMultipartUploadOutcome.IsSuccess ())
+    {
+      return true;
+    }
+  }
 
-  return reqWithS3Support;
+  // don't leave the uploaded parts behind, s3 would keep billing for them
+  AbortMultipartUploadRequest abortMultipartUploadRequest;
+  abortMultipartUploadRequest.SetBucket (s3BucketName);
+  abortMultipartUploadRequest.SetKey (s3Key);
+  abortMultipartUploadRequest.SetUploadId (uploadId);
+  s3Client->AbortMultipartUpload (abortMultipartUploadRequest);
+  return false;
 }
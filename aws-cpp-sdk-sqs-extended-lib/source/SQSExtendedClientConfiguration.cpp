@@ -15,16 +15,45 @@
 
 #include <aws/core/utils/memory/stl/AWSStringStream.h>
 #include <aws/sqs/extendedlib/SQSExtendedClientConfiguration.h>
+#include <aws/sqs/extendedlib/SQSDeflateCodec.h>
+#include <aws/sqs/extendedlib/SQSUuidS3KeyGenerator.h>
+#include <algorithm>
 
 using namespace Aws::SQS::ExtendedLib;
 
+static const char* ALLOCATION_TAG = "SQSExtendedClientConfiguration";
+
+// S3 refuses parts smaller than 5MB, except for the last one
+static const unsigned MULTIPART_UPLOAD_MIN_PART_SIZE = 5 * 1024 * 1024;
+
 SQSExtendedClientConfiguration::SQSExtendedClientConfiguration () :
     m_s3Client (nullptr),
     m_s3BucketName ("bucket"),
     m_messageSizeThreshold (262144),
     m_largePayloadSupport (true),
-    m_alwaysThroughS3 (false)
+    m_alwaysThroughS3 (false),
+    m_inlineCompression (false),
+    m_payloadDeduplication (false),
+    m_batchPacking (false),
+    m_lazyPayloadLoading (false),
+    m_batchPipelining (false),
+    m_compactS3Pointer (false),
+    m_receiptHandleEnvelope (false),
+    m_payloadDeduplicationCacheSize (1024),
+    m_payloadDeduplicationMaxAge (86400),
+    m_payloadDeduplicationSafetyMargin (3600),
+    m_s3MaxConcurrency (10),
+    m_asyncThreadPoolSize (10),
+    m_multipartUploadThreshold (100 * 1024 * 1024),
+    m_multipartUploadPartSize (16 * 1024 * 1024),
+    m_s3MaxRetries (3),
+    m_rangedDownloadThreshold (64 * 1024 * 1024),
+    m_rangedDownloadPartSize (8 * 1024 * 1024),
+    m_payloadCodec (nullptr),
+    m_s3KeyGenerator (Aws::MakeShared<SQSUuidS3KeyGenerator> (ALLOCATION_TAG)),
+    m_s3PayloadReaper (nullptr)
 {
+  m_payloadCodecs[SQSDeflateCodec::NAME] = Aws::MakeShared<SQSDeflateCodec> (ALLOCATION_TAG);
 }
 
 void SQSExtendedClientConfiguration::SetLargePayloadSupportEnabled (const std::shared_ptr<Aws::S3::S3Client> s3Client,
@@ -62,6 +91,141 @@ bool SQSExtendedClientConfiguration::IsAlwaysThroughS3 () const
   return m_alwaysThroughS3;
 }
 
+void SQSExtendedClientConfiguration::SetInlineCompressionEnabled ()
+{
+  m_inlineCompression = true;
+}
+
+void SQSExtendedClientConfiguration::SetInlineCompressionDisabled ()
+{
+  m_inlineCompression = false;
+}
+
+bool SQSExtendedClientConfiguration::IsInlineCompressionEnabled () const
+{
+  return m_inlineCompression;
+}
+
+void SQSExtendedClientConfiguration::SetPayloadDeduplicationEnabled ()
+{
+  m_payloadDeduplication = true;
+}
+
+void SQSExtendedClientConfiguration::SetPayloadDeduplicationDisabled ()
+{
+  m_payloadDeduplication = false;
+}
+
+bool SQSExtendedClientConfiguration::IsPayloadDeduplicationEnabled () const
+{
+  return m_payloadDeduplication;
+}
+
+void SQSExtendedClientConfiguration::SetBatchPackingEnabled ()
+{
+  m_batchPacking = true;
+}
+
+void SQSExtendedClientConfiguration::SetBatchPackingDisabled ()
+{
+  m_batchPacking = false;
+}
+
+bool SQSExtendedClientConfiguration::IsBatchPackingEnabled () const
+{
+  return m_batchPacking;
+}
+
+void SQSExtendedClientConfiguration::SetLazyPayloadLoadingEnabled ()
+{
+  m_lazyPayloadLoading = true;
+}
+
+void SQSExtendedClientConfiguration::SetLazyPayloadLoadingDisabled ()
+{
+  m_lazyPayloadLoading = false;
+}
+
+bool SQSExtendedClientConfiguration::IsLazyPayloadLoadingEnabled () const
+{
+  return m_lazyPayloadLoading;
+}
+
+void SQSExtendedClientConfiguration::SetBatchPipeliningEnabled ()
+{
+  m_batchPipelining = true;
+}
+
+void SQSExtendedClientConfiguration::SetBatchPipeliningDisabled ()
+{
+  m_batchPipelining = false;
+}
+
+bool SQSExtendedClientConfiguration::IsBatchPipeliningEnabled () const
+{
+  return m_batchPipelining;
+}
+
+void SQSExtendedClientConfiguration::SetCompactS3PointerEnabled ()
+{
+  m_compactS3Pointer = true;
+}
+
+void SQSExtendedClientConfiguration::SetCompactS3PointerDisabled ()
+{
+  m_compactS3Pointer = false;
+}
+
+bool SQSExtendedClientConfiguration::IsCompactS3PointerEnabled () const
+{
+  return m_compactS3Pointer;
+}
+
+void SQSExtendedClientConfiguration::SetReceiptHandleEnvelopeEnabled ()
+{
+  m_receiptHandleEnvelope = true;
+}
+
+void SQSExtendedClientConfiguration::SetReceiptHandleEnvelopeDisabled ()
+{
+  m_receiptHandleEnvelope = false;
+}
+
+bool SQSExtendedClientConfiguration::IsReceiptHandleEnvelopeEnabled () const
+{
+  return m_receiptHandleEnvelope;
+}
+
+void SQSExtendedClientConfiguration::SetPayloadDeduplicationCacheSize (unsigned payloadDeduplicationCacheSize)
+{
+  m_payloadDeduplicationCacheSize = payloadDeduplicationCacheSize;
+}
+
+unsigned SQSExtendedClientConfiguration::GetPayloadDeduplicationCacheSize () const
+{
+  return m_payloadDeduplicationCacheSize;
+}
+
+void SQSExtendedClientConfiguration::SetPayloadDeduplicationMaxAge (unsigned payloadDeduplicationMaxAge)
+{
+  m_payloadDeduplicationMaxAge = payloadDeduplicationMaxAge;
+}
+
+unsigned SQSExtendedClientConfiguration::GetPayloadDeduplicationMaxAge () const
+{
+  return m_payloadDeduplicationMaxAge;
+}
+
+void SQSExtendedClientConfiguration::SetPayloadDeduplicationSafetyMargin (unsigned payloadDeduplicationSafetyMargin)
+{
+  m_payloadDeduplicationSafetyMargin = payloadDeduplicationSafetyMargin;
+}
+
+unsigned SQSExtendedClientConfiguration::GetPayloadDeduplicationSafetyMargin () const
+{
+  return m_payloadDeduplicationSafetyMargin;
+}
+
 std::shared_ptr<Aws::S3::S3Client> SQSExtendedClientConfiguration::GetS3Client () const
 {
   return m_s3Client;
@@ -77,3 +241,117 @@ unsigned SQSExtendedClientConfiguration::GetMessageSizeThreshold () const
   return m_messageSizeThreshold;
 }
 
+void SQSExtendedClientConfiguration::SetS3MaxConcurrency (unsigned s3MaxConcurrency)
+{
+  m_s3MaxConcurrency = s3MaxConcurrency > 0 ? s3MaxConcurrency : 1;
+}
+
+unsigned SQSExtendedClientConfiguration::GetS3MaxConcurrency () const
+{
+  return m_s3MaxConcurrency;
+}
+
+void SQSExtendedClientConfiguration::SetAsyncThreadPoolSize (unsigned asyncThreadPoolSize)
+{
+  m_asyncThreadPoolSize = asyncThreadPoolSize > 0 ? asyncThreadPoolSize : 1;
+}
+
+unsigned SQSExtendedClientConfiguration::GetAsyncThreadPoolSize () const
+{
+  return m_asyncThreadPoolSize;
+}
+
+void SQSExtendedClientConfiguration::SetMultipartUploadThreshold (unsigned multipartUploadThreshold)
+{
+  m_multipartUploadThreshold = multipartUploadThreshold;
+}
+
+unsigned SQSExtendedClientConfiguration::GetMultipartUploadThreshold () const
+{
+  return m_multipartUploadThreshold;
+}
+
+void SQSExtendedClientConfiguration::SetMultipartUploadPartSize (unsigned multipartUploadPartSize)
+{
+  m_multipartUploadPartSize = std::max (multipartUploadPartSize, MULTIPART_UPLOAD_MIN_PART_SIZE);
+}
+
+unsigned SQSExtendedClientConfiguration::GetMultipartUploadPartSize () const
+{
+  return m_multipartUploadPartSize;
+}
+
+void SQSExtendedClientConfiguration::SetS3MaxRetries (unsigned s3MaxRetries)
+{
+  m_s3MaxRetries = s3MaxRetries;
+}
+
+unsigned SQSExtendedClientConfiguration::GetS3MaxRetries () const
+{
+  return m_s3MaxRetries;
+}
+
+void SQSExtendedClientConfiguration::SetRangedDownloadThreshold (unsigned rangedDownloadThreshold)
+{
+  m_rangedDownloadThreshold = rangedDownloadThreshold;
+}
+
+unsigned SQSExtendedClientConfiguration::GetRangedDownloadThreshold () const
+{
+  return m_rangedDownloadThreshold;
+}
+
+void SQSExtendedClientConfiguration::SetRangedDownloadPartSize (unsigned rangedDownloadPartSize)
+{
+  m_rangedDownloadPartSize = std::max (rangedDownloadPartSize, 1u);
+}
+
+unsigned SQSExtendedClientConfiguration::GetRangedDownloadPartSize () const
+{
+  return m_rangedDownloadPartSize;
+}
+
+void SQSExtendedClientConfiguration::SetPayloadCodec (const std::shared_ptr<SQSPayloadCodec>& payloadCodec)
+{
+  m_payloadCodec = payloadCodec;
+  if (payloadCodec)
+  {
+    AddPayloadCodec (payloadCodec);
+  }
+}
+
+std::shared_ptr<SQSPayloadCodec> SQSExtendedClientConfiguration::GetPayloadCodec () const
+{
+  return m_payloadCodec;
+}
+
+void SQSExtendedClientConfiguration::AddPayloadCodec (const std::shared_ptr<SQSPayloadCodec>& payloadCodec)
+{
+  m_payloadCodecs[payloadCodec->GetName ()] = payloadCodec;
+}
+
+std::shared_ptr<SQSPayloadCodec> SQSExtendedClientConfiguration::GetPayloadCodec (const Aws::String& name) const
+{
+  auto payloadCodec = m_payloadCodecs.find (name);
+  return payloadCodec != m_payloadCodecs.end () ? payloadCodec->second : nullptr;
+}
+
+void SQSExtendedClientConfiguration::SetS3KeyGenerator (const std::shared_ptr<SQSS3KeyGenerator>& s3KeyGenerator)
+{
+  m_s3KeyGenerator = s3KeyGenerator;
+}
+
+std::shared_ptr<SQSS3KeyGenerator> SQSExtendedClientConfiguration::GetS3KeyGenerator () const
+{
+  return m_s3KeyGenerator;
+}
+
+void SQSExtendedClientConfiguration::SetS3PayloadReaper (const std::shared_ptr<SQSS3PayloadReaper>& s3PayloadReaper)
+{
+  m_s3PayloadReaper = s3PayloadReaper;
+}
+
+std::shared_ptr<SQSS3PayloadReaper> SQSExtendedClientConfiguration::GetS3PayloadReaper () const
+{
+  return m_s3PayloadReaper;
+}
@@ -13,9 +13,49 @@
  * permissions and limitations under the License.
  */
 #include <aws/sqs/extendedlib/SQSLargeMessageS3Pointer.h>
+#include <aws/sqs/extendedlib/SQSLargeMessageS3PointerView.h>
+#include <cstring>
 
 using namespace Aws::Utils::Json;
 
+namespace
+{
+  void AppendNumber (Aws::String& body, unsigned long long number)
+  {
+    char digits[24];
+    size_t length = 0;
+    do
+    {
+      digits[length++] = static_cast<char> ('0' + number % 10);
+      number /= 10;
+    }
+    while (number > 0);
+    while (length > 0)
+    {
+      body += digits[--length];
+    }
+  }
+
+  void AppendString (Aws::String& body, const Aws::String& field)
+  {
+    body += ' ';
+    AppendNumber (body, field.size ());
+    body += ':';
+    body += field;
+  }
+
+  void AppendOptionalNumber (Aws::String& body, bool hasBeenSet, long long number)
+  {
+    body += ' ';
+    if (!hasBeenSet || number < 0)
+    {
+      body += '-';
+      return;
+    }
+    AppendNumber (body, static_cast<unsigned long long> (number));
+  }
+}
+
 namespace Aws
 {
   namespace SQS
@@ -24,12 +64,14 @@ namespace Aws
     {
 
       SQSLargeMessageS3Pointer::SQSLargeMessageS3Pointer () :
-          m_s3BucketNameHasBeenSet (false), m_s3KeyHasBeenSet (false)
+          m_s3BucketNameHasBeenSet (false), m_s3KeyHasBeenSet (false), m_codecHasBeenSet (false),
+          m_s3Offset (0), m_s3OffsetHasBeenSet (false), m_s3Length (0), m_s3LengthHasBeenSet (false)
       {
       }
 
       SQSLargeMessageS3Pointer::SQSLargeMessageS3Pointer (const JsonValue& jsonValue) :
-          m_s3BucketNameHasBeenSet (false), m_s3KeyHasBeenSet (false)
+          m_s3BucketNameHasBeenSet (false), m_s3KeyHasBeenSet (false), m_codecHasBeenSet (false),
+          m_s3Offset (0), m_s3OffsetHasBeenSet (false), m_s3Length (0), m_s3LengthHasBeenSet (false)
       {
         *this = jsonValue;
       }
@@ -49,6 +91,24 @@ namespace Aws
           m_s3KeyHasBeenSet = true;
         }
 
+        if (jsonValue.ValueExists ("Codec"))
+        {
+          m_codec = jsonValue.GetString ("Codec");
+          m_codecHasBeenSet = true;
+        }
+
+        if (jsonValue.ValueExists ("S3Offset"))
+        {
+          m_s3Offset = jsonValue.GetInt64 ("S3Offset");
+          m_s3OffsetHasBeenSet = true;
+        }
+
+        if (jsonValue.ValueExists ("S3Length"))
+        {
+          m_s3Length = jsonValue.GetInt64 ("S3Length");
+          m_s3LengthHasBeenSet = true;
+        }
+
         return *this;
       }
 
@@ -63,9 +123,33 @@ namespace Aws
         if (m_s3KeyHasBeenSet)
           payload.WithString ("S3Key", m_s3Key);
 
+        if (m_codecHasBeenSet)
+          payload.WithString ("Codec", m_codec);
+
+        if (m_s3OffsetHasBeenSet)
+          payload.WithInt64 ("S3Offset", m_s3Offset);
+
+        if (m_s3LengthHasBeenSet)
+          payload.WithInt64 ("S3Length", m_s3Length);
+
         return payload;
       }
 
+      Aws::String
+      SQSLargeMessageS3Pointer::Serialize () const
+      {
+        Aws::String body;
+        body.reserve (std::strlen (SQSLargeMessageS3PointerView::COMPACT_FORM_TAG) + m_s3BucketName.size ()
+                      + m_s3Key.size () + m_codec.size () + 64);
+        body += SQSLargeMessageS3PointerView::COMPACT_FORM_TAG;
+        AppendString (body, m_s3BucketName);
+        AppendString (body, m_s3Key);
+        AppendString (body, m_codec);
+        AppendOptionalNumber (body, m_s3OffsetHasBeenSet, m_s3Offset);
+        AppendOptionalNumber (body, m_s3LengthHasBeenSet, m_s3Length);
+        return body;
+      }
+
     } // namespace Model
   } // namespace ACM
 } // namespace Aws
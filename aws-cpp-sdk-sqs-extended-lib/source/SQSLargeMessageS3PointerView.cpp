@@ -0,0 +1,287 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/sqs/extendedlib/SQSLargeMessageS3PointerView.h>
+#include <cstring>
+#include <limits>
+
+using namespace Aws::SQS::ExtendedLib;
+
+const char* SQSLargeMessageS3PointerView::COMPACT_FORM_TAG = "SQSS3P/1";
+
+namespace
+{
+  // Walks a body once, every read fails without moving on a mismatch
+  class Cursor
+  {
+
+  private:
+    const SQSStringView& m_body;
+    size_t m_pos;
+
+  public:
+    Cursor (const SQSStringView& body, size_t pos) :
+        m_body (body), m_pos (pos)
+    {
+    }
+
+    bool AtEnd () const
+    {
+      return m_pos == m_body.GetSize ();
+    }
+
+    bool Peek (char c) const
+    {
+      return m_pos < m_body.GetSize () && m_body[m_pos] == c;
+    }
+
+    bool Expect (char c)
+    {
+      if (!Peek (c))
+      {
+        return false;
+      }
+      ++m_pos;
+      return true;
+    }
+
+    void SkipWhitespace ()
+    {
+      while (m_pos < m_body.GetSize ()
+          && (m_body[m_pos] == ' ' || m_body[m_pos] == '\t' || m_body[m_pos] == '\n' || m_body[m_pos] == '\r'))
+      {
+        ++m_pos;
+      }
+    }
+
+    // Decimal digits, at least one, refusing anything a long long cannot hold
+    bool ReadNumber (long long& number)
+    {
+      size_t pos = m_pos;
+      unsigned long long value = 0;
+      const unsigned long long maxValue = static_cast<unsigned long long> (std::numeric_limits<long long>::max ());
+      while (pos < m_body.GetSize () && m_body[pos] >= '0' && m_body[pos] <= '9')
+      {
+        unsigned digit = static_cast<unsigned> (m_body[pos] - '0');
+        if (value > (maxValue - digit) / 10)
+        {
+          return false;
+        }
+        value = value * 10 + digit;
+        ++pos;
+      }
+      if (pos == m_pos)
+      {
+        return false;
+      }
+      m_pos = pos;
+      number = static_cast<long long> (value);
+      return true;
+    }
+
+    // "<n>:" followed by n characters
+    bool ReadPrefixedString (SQSStringView& field)
+    {
+      size_t start = m_pos;
+      long long length = 0;
+      if (!ReadNumber (length) || !Expect (':') || static_cast<unsigned long long> (length) > m_body.GetSize () - m_pos)
+      {
+        m_pos = start;
+        return false;
+      }
+      field = m_body.Substr (m_pos, static_cast<size_t> (length));
+      m_pos += static_cast<size_t> (length);
+      return true;
+    }
+
+    // A number, or "-" when it was not set
+    bool ReadOptionalNumber (long long& number, bool& hasBeenSet)
+    {
+      if (Expect ('-'))
+      {
+        number = 0;
+        hasBeenSet = false;
+        return true;
+      }
+      hasBeenSet = ReadNumber (number);
+      return hasBeenSet;
+    }
+
+    // A json string without escape sequences, the view excludes the quotes
+    bool ReadJsonString (SQSStringView& field)
+    {
+      if (!Peek ('"'))
+      {
+        return false;
+      }
+      for (size_t pos = m_pos + 1; pos < m_body.GetSize (); ++pos)
+      {
+        if (m_body[pos] == '\\' || static_cast<unsigned char> (m_body[pos]) < 0x20)
+        {
+          return false;
+        }
+        if (m_body[pos] == '"')
+        {
+          field = m_body.Substr (m_pos + 1, pos - m_pos - 1);
+          m_pos = pos + 1;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // Skips a scalar json value nobody asked for, nested ones are refused
+    bool SkipJsonScalar ()
+    {
+      SQSStringView ignored;
+      if (ReadJsonString (ignored))
+      {
+        return true;
+      }
+      static const char* literals[] = { "true", "false", "null" };
+      for (const char* literal : literals)
+      {
+        if (m_body.Substr (m_pos).StartsWith (literal))
+        {
+          m_pos += std::strlen (literal);
+          return true;
+        }
+      }
+      size_t start = m_pos;
+      while (m_pos < m_body.GetSize () && ((m_body[m_pos] != '\0' && std::strchr ("+-.eE", m_body[m_pos]) != nullptr)
+          || (m_body[m_pos] >= '0' && m_body[m_pos] <= '9')))
+      {
+        ++m_pos;
+      }
+      return m_pos > start;
+    }
+
+  };
+}
+
+SQSLargeMessageS3PointerView::SQSLargeMessageS3PointerView () :
+    m_s3Offset (0), m_s3OffsetHasBeenSet (false), m_s3Length (0), m_s3LengthHasBeenSet (false)
+{
+}
+
+bool SQSLargeMessageS3PointerView::Parse (const SQSStringView& body)
+{
+  *this = SQSLargeMessageS3PointerView ();
+  bool isParsed = body.StartsWith (COMPACT_FORM_TAG) ? SQSLargeMessageS3PointerView::ParseCompact (body)
+                                                     : SQSLargeMessageS3PointerView::ParseJson (body);
+  if (!isParsed)
+  {
+    *this = SQSLargeMessageS3PointerView ();
+  }
+  return isParsed;
+}
+
+bool SQSLargeMessageS3PointerView::ParseCompact (const SQSStringView& body)
+{
+  Cursor cursor (body, std::strlen (COMPACT_FORM_TAG));
+  return cursor.Expect (' ') && cursor.ReadPrefixedString (m_s3BucketName)
+      && cursor.Expect (' ') && cursor.ReadPrefixedString (m_s3Key)
+      && cursor.Expect (' ') && cursor.ReadPrefixedString (m_codec)
+      && cursor.Expect (' ') && cursor.ReadOptionalNumber (m_s3Offset, m_s3OffsetHasBeenSet)
+      && cursor.Expect (' ') && cursor.ReadOptionalNumber (m_s3Length, m_s3LengthHasBeenSet)
+      && cursor.AtEnd ();
+}
+
+bool SQSLargeMessageS3PointerView::ParseJson (const SQSStringView& body)
+{
+  Cursor cursor (body, 0);
+  cursor.SkipWhitespace ();
+  if (!cursor.Expect ('{'))
+  {
+    return false;
+  }
+  cursor.SkipWhitespace ();
+
+  bool isFirst = true;
+  while (!cursor.Expect ('}'))
+  {
+    if (!isFirst && !cursor.Expect (','))
+    {
+      return false;
+    }
+    isFirst = false;
+
+    SQSStringView name;
+    cursor.SkipWhitespace ();
+    if (!cursor.ReadJsonString (name))
+    {
+      return false;
+    }
+    cursor.SkipWhitespace ();
+    if (!cursor.Expect (':'))
+    {
+      return false;
+    }
+    cursor.SkipWhitespace ();
+
+    bool isRead;
+    if (name == "S3BucketName")
+    {
+      isRead = cursor.ReadJsonString (m_s3BucketName);
+    }
+    else if (name == "S3Key")
+    {
+      isRead = cursor.ReadJsonString (m_s3Key);
+    }
+    else if (name == "Codec")
+    {
+      isRead = cursor.ReadJsonString (m_codec);
+    }
+    else if (name == "S3Offset")
+    {
+      isRead = m_s3OffsetHasBeenSet = cursor.ReadNumber (m_s3Offset);
+    }
+    else if (name == "S3Length")
+    {
+      isRead = m_s3LengthHasBeenSet = cursor.ReadNumber (m_s3Length);
+    }
+    else
+    {
+      isRead = cursor.SkipJsonScalar ();
+    }
+    if (!isRead)
+    {
+      return false;
+    }
+    cursor.SkipWhitespace ();
+  }
+
+  cursor.SkipWhitespace ();
+  return cursor.AtEnd ();
+}
+
+SQSLargeMessageS3Pointer SQSLargeMessageS3PointerView::ToS3Pointer () const
+{
+  SQSLargeMessageS3Pointer s3Pointer;
+  s3Pointer.SetS3BucketName (m_s3BucketName.ToString ());
+  s3Pointer.SetS3Key (m_s3Key.ToString ());
+  if (!m_codec.IsEmpty ())
+  {
+    s3Pointer.SetCodec (m_codec.ToString ());
+  }
+  if (m_s3OffsetHasBeenSet)
+  {
+    s3Pointer.SetS3Offset (m_s3Offset);
+  }
+  if (m_s3LengthHasBeenSet)
+  {
+    s3Pointer.SetS3Length (m_s3Length);
+  }
+  return s3Pointer;
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/sqs/extendedlib/SQSLazyPayload.h>
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <algorithm>
+
+using namespace Aws::SQS::ExtendedLib;
+
+SQSLazyPayload::SQSLazyPayload (const Aws::String& body) :
+    m_size (static_cast<long long> (body.size ())), m_isOffloaded (false), m_body (body), m_isLoaded (true)
+{
+}
+
+SQSLazyPayload::SQSLazyPayload (const SQSLargeMessageS3Pointer& s3Pointer, long long size, const Loader& loader,
+                                const StreamLoader& streamLoader) :
+    m_s3Pointer (s3Pointer), m_size (size), m_isOffloaded (true), m_loader (loader), m_streamLoader (streamLoader),
+    m_isLoaded (false)
+{
+}
+
+bool SQSLazyPayload::IsOffloaded () const
+{
+  return m_isOffloaded;
+}
+
+long long SQSLazyPayload::GetSize () const
+{
+  return m_size;
+}
+
+const SQSLargeMessageS3Pointer& SQSLazyPayload::GetS3Pointer () const
+{
+  return m_s3Pointer;
+}
+
+bool SQSLazyPayload::IsLoaded ()
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+  return m_isLoaded;
+}
+
+bool SQSLazyPayload::Load ()
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+  if (!m_isLoaded)
+  {
+    Aws::String body;
+    body.reserve (static_cast<size_t> (m_size));
+    if (m_loader (m_s3Pointer, body))
+    {
+      m_body.swap (body);
+      m_isLoaded = true;
+    }
+  }
+  return m_isLoaded;
+}
+
+const Aws::String& SQSLazyPayload::GetBody ()
+{
+  Load ();
+  return m_body;
+}
+
+bool SQSLazyPayload::Read (long long offset, long long length, Aws::String& payload)
+{
+  if (offset < 0 || length < 0 || offset > m_size)
+  {
+    return false;
+  }
+  length = std::min (length, m_size - offset);
+
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    if (!m_isLoaded && m_s3Pointer.GetCodec ().empty ())
+    {
+      if (length == 0)
+      {
+        return true;
+      }
+
+      // the range is taken from within the stored payload, which may itself be a range of a packed object
+      SQSLargeMessageS3Pointer rangePointer = m_s3Pointer;
+      rangePointer.SetS3Offset (m_s3Pointer.GetS3Offset () + offset);
+      rangePointer.SetS3Length (length);
+      return m_loader (rangePointer, payload);
+    }
+  }
+
+  if (!Load ())
+  {
+    return false;
+  }
+  payload.append (m_body, static_cast<size_t> (offset), static_cast<size_t> (length));
+  return true;
+}
+
+bool SQSLazyPayload::Download (const Aws::IOStreamFactory& streamFactory)
+{
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    if (!m_isLoaded && m_streamLoader)
+    {
+      return m_streamLoader (m_s3Pointer, streamFactory);
+    }
+  }
+
+  if (!Load ())
+  {
+    return false;
+  }
+
+  Aws::IOStream* destination = streamFactory ();
+  destination->write (m_body.c_str (), static_cast<std::streamsize> (m_body.size ()));
+  bool isWritten = destination->good ();
+  Aws::Delete (destination);
+  return isWritten;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/sqs/extendedlib/SQSPayloadDigestCache.h>
+
+using namespace Aws::SQS::ExtendedLib;
+
+SQSPayloadDigestCache::SQSPayloadDigestCache (size_t capacity, std::chrono::seconds maxAge) :
+    m_capacity (capacity), m_maxAge (maxAge)
+{
+}
+
+bool SQSPayloadDigestCache::Contains (const Aws::String& s3Key)
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+
+  auto entry = m_entries.find (s3Key);
+  if (entry == m_entries.end ())
+  {
+    return false;
+  }
+
+  if (Clock::now () - entry->second->second > m_maxAge)
+  {
+    m_recency.erase (entry->second);
+    m_entries.erase (entry);
+    return false;
+  }
+
+  m_recency.splice (m_recency.begin (), m_recency, entry->second);
+  return true;
+}
+
+void SQSPayloadDigestCache::Add (const Aws::String& s3Key)
+{
+  Add (s3Key, std::chrono::milliseconds (0));
+}
+
+void SQSPayloadDigestCache::Add (const Aws::String& s3Key, std::chrono::milliseconds age)
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+  Clock::time_point storedAt = Clock::now () - age;
+
+  if (m_capacity == 0)
+  {
+    return;
+  }
+
+  auto entry = m_entries.find (s3Key);
+  if (entry != m_entries.end ())
+  {
+    entry->second->second = storedAt;
+    m_recency.splice (m_recency.begin (), m_recency, entry->second);
+    return;
+  }
+
+  if (m_entries.size () >= m_capacity)
+  {
+    m_entries.erase (m_recency.back ().first);
+    m_recency.pop_back ();
+  }
+
+  m_recency.push_front (Entry (s3Key, storedAt));
+  m_entries[s3Key] = m_recency.begin ();
+}
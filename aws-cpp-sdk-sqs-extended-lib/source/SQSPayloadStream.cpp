@@ -0,0 +1,116 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/sqs/extendedlib/SQSPayloadStream.h>
+#include <algorithm>
+#include <limits>
+
+using namespace Aws::SQS::ExtendedLib;
+
+SQSPayloadStreamBuf::SQSPayloadStreamBuf (const char* payload, size_t length)
+{
+  // the get area is the payload itself, std::streambuf never writes through it
+  char* begin = const_cast<char*> (payload);
+  setg (begin, begin, begin + length);
+}
+
+std::streambuf::pos_type SQSPayloadStreamBuf::seekoff (off_type off, std::ios_base::seekdir dir,
+                                                        std::ios_base::openmode which)
+{
+  if ((which & std::ios_base::in) == 0)
+  {
+    return pos_type (off_type (-1));
+  }
+
+  off_type base = 0;
+  if (dir == std::ios_base::cur)
+  {
+    base = gptr () - eback ();
+  }
+  else if (dir == std::ios_base::end)
+  {
+    base = egptr () - eback ();
+  }
+
+  off_type target = base + off;
+  if (target < 0 || target > egptr () - eback ())
+  {
+    return pos_type (off_type (-1));
+  }
+
+  setg (eback (), eback () + target, egptr ());
+  return pos_type (target);
+}
+
+std::streambuf::pos_type SQSPayloadStreamBuf::seekpos (pos_type pos, std::ios_base::openmode which)
+{
+  return seekoff (off_type (pos), std::ios_base::beg, which);
+}
+
+SQSPayloadStream::SQSPayloadStream (const char* payload, size_t length) :
+    Aws::IOStream (nullptr), m_streamBuf (payload, length)
+{
+  rdbuf (&m_streamBuf);
+}
+
+SQSPayloadRegionBuf::SQSPayloadRegionBuf (char* region, size_t length)
+{
+  setp (region, region + length);
+}
+
+std::streambuf::pos_type SQSPayloadRegionBuf::seekoff (off_type off, std::ios_base::seekdir dir,
+                                                        std::ios_base::openmode which)
+{
+  if ((which & std::ios_base::out) == 0)
+  {
+    return pos_type (off_type (-1));
+  }
+
+  off_type base = 0;
+  if (dir == std::ios_base::cur)
+  {
+    base = pptr () - pbase ();
+  }
+  else if (dir == std::ios_base::end)
+  {
+    base = epptr () - pbase ();
+  }
+
+  off_type target = base + off;
+  if (target < 0 || target > epptr () - pbase ())
+  {
+    return pos_type (off_type (-1));
+  }
+
+  // setp rewinds to the start of the region, pbump then moves to the target an int at a time
+  setp (pbase (), epptr ());
+  for (off_type left = target; left > 0;)
+  {
+    int step = static_cast<int> (std::min<off_type> (left, std::numeric_limits<int>::max ()));
+    pbump (step);
+    left -= step;
+  }
+  return pos_type (target);
+}
+
+std::streambuf::pos_type SQSPayloadRegionBuf::seekpos (pos_type pos, std::ios_base::openmode which)
+{
+  return seekoff (off_type (pos), std::ios_base::beg, which);
+}
+
+SQSPayloadRegionStream::SQSPayloadRegionStream (char* region, size_t length) :
+    Aws::IOStream (nullptr), m_streamBuf (region, length)
+{
+  rdbuf (&m_streamBuf);
+}
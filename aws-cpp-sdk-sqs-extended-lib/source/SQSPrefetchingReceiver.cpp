@@ -0,0 +1,256 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/sqs/extendedlib/SQSPrefetchingReceiver.h>
+#include <algorithm>
+
+using namespace Aws::SQS::Model;
+using namespace Aws::SQS::ExtendedLib;
+
+// pause after a failed receive, so a broken queue is not hammered
+static const std::chrono::seconds RECEIVE_RETRY_DELAY (1);
+
+SQSPrefetchingReceiver::SQSPrefetchingReceiver (const std::shared_ptr<SQSClient>& sqsClient,
+                                                const ReceiveMessageRequest& request, unsigned maxBufferedMessages,
+                                                size_t maxBufferedBytes, unsigned pollers, unsigned visibilityTimeout,
+                                                unsigned visibilityMargin) :
+    m_sqsClient (sqsClient), m_extendedClient (std::dynamic_pointer_cast<SQSExtendedClient> (sqsClient)),
+    m_request (request), m_maxBufferedMessages (std::max (maxBufferedMessages, 1u)), m_maxBufferedBytes (maxBufferedBytes),
+    m_bufferedBytes (0), m_reservedMessages (0), m_reservedBytes (0), m_droppedMessages (0), m_shutdown (false)
+{
+  int timeout = request.GetVisibilityTimeout () > 0 ? request.GetVisibilityTimeout () : static_cast<int> (visibilityTimeout);
+  m_visibleFor = std::chrono::seconds (std::max (timeout - static_cast<int> (visibilityMargin), 0));
+
+  for (unsigned i = 0; i < std::max (pollers, 1u); ++i)
+  {
+    m_pollers.push_back (std::thread (&SQSPrefetchingReceiver::Poll, this));
+  }
+}
+
+SQSPrefetchingReceiver::~SQSPrefetchingReceiver ()
+{
+  Shutdown ();
+}
+
+bool SQSPrefetchingReceiver::Next (Message& message, std::chrono::milliseconds timeout)
+{
+  Clock::time_point waitUntil = Clock::now () + timeout;
+  std::unique_lock<std::mutex> lock (m_mutex);
+  while (!m_shutdown)
+  {
+    DropExpired (Clock::now ());
+    if (!m_buffer.empty ())
+    {
+      message = m_buffer.front ().message;
+      m_bufferedBytes -= message.GetBody ().size ();
+      m_buffer.pop_front ();
+      m_roomAvailable.notify_all ();
+      return true;
+    }
+
+    if (m_messageAvailable.wait_until (lock, waitUntil) == std::cv_status::timeout)
+    {
+      DropExpired (Clock::now ());
+      if (m_buffer.empty () || m_shutdown)
+      {
+        return false;
+      }
+    }
+  }
+  return false;
+}
+
+void SQSPrefetchingReceiver::Shutdown ()
+{
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_shutdown = true;
+  }
+  m_roomAvailable.notify_all ();
+  m_messageAvailable.notify_all ();
+
+  for (auto& poller : m_pollers)
+  {
+    if (poller.joinable () && poller.get_id () != std::this_thread::get_id ())
+    {
+      poller.join ();
+    }
+  }
+}
+
+size_t SQSPrefetchingReceiver::GetBufferedMessages ()
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+  return m_buffer.size ();
+}
+
+size_t SQSPrefetchingReceiver::GetDroppedMessages ()
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+  return m_droppedMessages;
+}
+
+void SQSPrefetchingReceiver::Poll ()
+{
+  size_t receiveSize = GetReceiveSize ();
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock (m_mutex);
+      m_roomAvailable.wait (lock, [this] ()
+      {
+        return m_shutdown || HasRoom ();
+      });
+      if (m_shutdown)
+      {
+        return;
+      }
+
+      // slots are taken before receiving, so the pollers together never receive more than the buffer holds
+      m_reservedMessages += receiveSize;
+    }
+
+    // the visibility timeout starts when sqs hands the messages out, so counting from the request is safe
+    Clock::time_point deadline = Clock::now () + m_visibleFor;
+    ReceiveMessageOutcome outcome = m_sqsClient->ReceiveMessage (m_request);
+    Aws::Vector<Message> messages;
+    if (outcome.IsSuccess ())
+    {
+      messages = outcome.GetResult ().GetMessages ();
+    }
+    size_t payloadBytes = 0;
+    bool isHydrated = Hydrate (messages, deadline, payloadBytes);
+
+    std::unique_lock<std::mutex> lock (m_mutex);
+    m_reservedMessages -= receiveSize;
+    m_reservedBytes -= payloadBytes;
+    m_roomAvailable.notify_all ();
+    if (!isHydrated)
+    {
+      return;
+    }
+    if (!outcome.IsSuccess ())
+    {
+      m_roomAvailable.wait_for (lock, RECEIVE_RETRY_DELAY, [this] ()
+      {
+        return m_shutdown;
+      });
+      continue;
+    }
+
+    for (const Message& message : messages)
+    {
+      BufferedMessage bufferedMessage;
+      bufferedMessage.message = message;
+      bufferedMessage.deadline = deadline;
+      m_buffer.push_back (bufferedMessage);
+      m_bufferedBytes += message.GetBody ().size ();
+    }
+    if (!messages.empty ())
+    {
+      m_messageAvailable.notify_all ();
+    }
+  }
+}
+
+bool SQSPrefetchingReceiver::Hydrate (Aws::Vector<Message>& messages, Clock::time_point deadline, size_t& payloadBytes)
+{
+  if (!m_extendedClient)
+  {
+    return true;
+  }
+
+  size_t pendingBytes = 0;
+  for (const Message& message : messages)
+  {
+    pendingBytes += m_extendedClient->GetPendingPayloadSize (message);
+  }
+  if (pendingBytes == 0)
+  {
+    return true;
+  }
+
+  // payloads left in s3 by a lazy receive are fetched once their bytes fit, messages past their deadline are not
+  {
+    std::unique_lock<std::mutex> lock (m_mutex);
+    bool hasRoom = m_roomAvailable.wait_until (lock, deadline, [this, pendingBytes] ()
+    {
+      return m_shutdown || HasRoomFor (pendingBytes);
+    });
+    if (m_shutdown)
+    {
+      return false;
+    }
+    if (!hasRoom)
+    {
+      m_droppedMessages += messages.size ();
+      messages.clear ();
+      return true;
+    }
+    m_reservedBytes += pendingBytes;
+    payloadBytes = pendingBytes;
+  }
+
+  // a message whose payload cannot be fetched is dropped and becomes visible again
+  Aws::Vector<Message> hydrated;
+  for (Message& message : messages)
+  {
+    if (m_extendedClient->HydrateMessage (message))
+    {
+      hydrated.push_back (message);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock (m_mutex);
+  m_droppedMessages += messages.size () - hydrated.size ();
+  messages.swap (hydrated);
+  return true;
+}
+
+size_t SQSPrefetchingReceiver::GetReceiveSize () const
+{
+  return static_cast<size_t> (std::max (m_request.GetMaxNumberOfMessages (), 1));
+}
+
+bool SQSPrefetchingReceiver::HasRoom () const
+{
+  // a whole receive has to fit, unless nothing is buffered or on its way and the buffer would never get any
+  if (m_buffer.empty () && m_reservedMessages == 0)
+  {
+    return true;
+  }
+  return m_buffer.size () + m_reservedMessages + GetReceiveSize () <= m_maxBufferedMessages
+      && m_bufferedBytes + m_reservedBytes < m_maxBufferedBytes;
+}
+
+bool SQSPrefetchingReceiver::HasRoomFor (size_t payloadBytes) const
+{
+  return m_bufferedBytes + m_reservedBytes == 0 || m_bufferedBytes + m_reservedBytes + payloadBytes <= m_maxBufferedBytes;
+}
+
+void SQSPrefetchingReceiver::DropExpired (Clock::time_point now)
+{
+  bool dropped = false;
+  while (!m_buffer.empty () && m_buffer.front ().deadline <= now)
+  {
+    m_bufferedBytes -= m_buffer.front ().message.GetBody ().size ();
+    m_buffer.pop_front ();
+    ++m_droppedMessages;
+    dropped = true;
+  }
+  if (dropped)
+  {
+    m_roomAvailable.notify_all ();
+  }
+}
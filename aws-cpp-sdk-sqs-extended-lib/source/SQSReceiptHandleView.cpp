@@ -0,0 +1,146 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/sqs/extendedlib/SQSReceiptHandleView.h>
+#include <cstring>
+
+using namespace Aws::SQS::ExtendedLib;
+
+const char* SQSReceiptHandleView::ENVELOPE_TAG = "SQSRH/1";
+const char* SQSReceiptHandleView::S3_BUCKET_NAME_MARKER = "-..s3BucketName..-";
+const char* SQSReceiptHandleView::S3_KEY_MARKER = "-..s3Key..-";
+
+namespace
+{
+  // bucket names and keys are far below this, it only keeps the length from overflowing
+  const size_t MAX_FIELD_LENGTH_DIGITS = 9;
+
+  // "<n>:" followed by n characters and a space, from pos on
+  bool ReadPrefixedString (const SQSStringView& receiptHandle, size_t& pos, SQSStringView& field)
+  {
+    size_t length = 0;
+    size_t digits = 0;
+    while (pos + digits < receiptHandle.GetSize () && digits <= MAX_FIELD_LENGTH_DIGITS
+        && receiptHandle[pos + digits] >= '0' && receiptHandle[pos + digits] <= '9')
+    {
+      length = length * 10 + static_cast<size_t> (receiptHandle[pos + digits] - '0');
+      ++digits;
+    }
+    size_t start = pos + digits + 1;
+    if (digits == 0 || digits > MAX_FIELD_LENGTH_DIGITS || start > receiptHandle.GetSize ()
+        || receiptHandle[start - 1] != ':' || length >= receiptHandle.GetSize () - start
+        || receiptHandle[start + length] != ' ')
+    {
+      return false;
+    }
+    field = receiptHandle.Substr (start, length);
+    pos = start + length + 1;
+    return true;
+  }
+
+  void AppendPrefixedString (Aws::String& receiptHandle, const Aws::String& field)
+  {
+    receiptHandle += std::to_string (field.size ()).c_str ();
+    receiptHandle += ':';
+    receiptHandle += field;
+    receiptHandle += ' ';
+  }
+}
+
+Aws::String SQSReceiptHandleView::Envelope (const Aws::String& s3BucketName, const Aws::String& s3Key,
+                                            const Aws::String& sqsReceiptHandle)
+{
+  Aws::String receiptHandle;
+  receiptHandle.reserve (std::strlen (ENVELOPE_TAG) + s3BucketName.size () + s3Key.size () + sqsReceiptHandle.size () + 24);
+  receiptHandle += ENVELOPE_TAG;
+  receiptHandle += ' ';
+  AppendPrefixedString (receiptHandle, s3BucketName);
+  AppendPrefixedString (receiptHandle, s3Key);
+  receiptHandle += sqsReceiptHandle;
+  return receiptHandle;
+}
+
+Aws::String SQSReceiptHandleView::EmbedWithMarkers (const Aws::String& s3BucketName, const Aws::String& s3Key,
+                                                    const Aws::String& sqsReceiptHandle)
+{
+  return S3_BUCKET_NAME_MARKER + s3BucketName + S3_BUCKET_NAME_MARKER
+      + S3_KEY_MARKER + s3Key + S3_KEY_MARKER + sqsReceiptHandle;
+}
+
+SQSReceiptHandleView::SQSReceiptHandleView () :
+    m_isExtended (false)
+{
+}
+
+bool SQSReceiptHandleView::Parse (const SQSStringView& receiptHandle)
+{
+  *this = SQSReceiptHandleView ();
+  m_isExtended = receiptHandle.StartsWith (ENVELOPE_TAG) ? SQSReceiptHandleView::ParseEnvelope (receiptHandle)
+                                                         : SQSReceiptHandleView::ParseMarkers (receiptHandle);
+  if (!m_isExtended)
+  {
+    *this = SQSReceiptHandleView ();
+    m_sqsReceiptHandle = receiptHandle;
+  }
+  return m_isExtended;
+}
+
+bool SQSReceiptHandleView::ParseEnvelope (const SQSStringView& receiptHandle)
+{
+  size_t pos = std::strlen (ENVELOPE_TAG);
+  if (pos >= receiptHandle.GetSize () || receiptHandle[pos] != ' ')
+  {
+    return false;
+  }
+  ++pos;
+  if (!ReadPrefixedString (receiptHandle, pos, m_s3BucketName) || !ReadPrefixedString (receiptHandle, pos, m_s3Key))
+  {
+    return false;
+  }
+  m_sqsReceiptHandle = receiptHandle.Substr (pos);
+  return true;
+}
+
+bool SQSReceiptHandleView::ParseMarkers (const SQSStringView& receiptHandle)
+{
+  // the markers are searched forward only, each part ends where the next marker starts
+  SQSStringView bucketMarker (S3_BUCKET_NAME_MARKER);
+  SQSStringView keyMarker (S3_KEY_MARKER);
+  if (!receiptHandle.StartsWith (bucketMarker))
+  {
+    return false;
+  }
+  size_t bucketStart = bucketMarker.GetSize ();
+  size_t bucketEnd = receiptHandle.Find (bucketMarker, bucketStart);
+  if (bucketEnd == SQSStringView::NPOS)
+  {
+    return false;
+  }
+  size_t keyStart = bucketEnd + bucketMarker.GetSize ();
+  if (!receiptHandle.Substr (keyStart).StartsWith (keyMarker))
+  {
+    return false;
+  }
+  keyStart += keyMarker.GetSize ();
+  size_t keyEnd = receiptHandle.Find (keyMarker, keyStart);
+  if (keyEnd == SQSStringView::NPOS)
+  {
+    return false;
+  }
+
+  m_s3BucketName = receiptHandle.Substr (bucketStart, bucketEnd - bucketStart);
+  m_s3Key = receiptHandle.Substr (keyStart, keyEnd - keyStart);
+  m_sqsReceiptHandle = receiptHandle.Substr (keyEnd + keyMarker.GetSize ());
+  return true;
+}
@@ -0,0 +1,418 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/sqs/extendedlib/SQSS3PayloadReaper.h>
+#include <aws/core/utils/memory/stl/AWSMap.h>
+#include <aws/s3/model/DeleteObjectsRequest.h>
+#include <aws/s3/model/Delete.h>
+#include <aws/s3/model/ObjectIdentifier.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+
+using namespace Aws::S3::Model;
+using namespace Aws::SQS::ExtendedLib;
+
+static const char* ALLOCATION_TAG = "SQSS3PayloadReaper";
+static const size_t DELETE_OBJECTS_MAX_KEYS = 1000;
+// doubled on every retry of the same keys
+static const std::chrono::milliseconds DELETE_RETRY_DELAY (200);
+// reaped lines a log gathers before it is worth rewriting
+static const size_t LOG_COMPACTION_MIN_LINES = 1024;
+
+namespace
+{
+  // bucket names and keys are far below this, it only keeps the length from overflowing
+  const size_t MAX_FIELD_LENGTH_DIGITS = 9;
+
+  // "<n>:" followed by n characters and the terminator, from pos on
+  bool ReadPrefixedString (const Aws::String& log, size_t& pos, char terminator, Aws::String& field)
+  {
+    size_t length = 0;
+    size_t digits = 0;
+    while (pos + digits < log.size () && digits <= MAX_FIELD_LENGTH_DIGITS
+        && log[pos + digits] >= '0' && log[pos + digits] <= '9')
+    {
+      length = length * 10 + static_cast<size_t> (log[pos + digits] - '0');
+      ++digits;
+    }
+    size_t start = pos + digits + 1;
+    if (digits == 0 || digits > MAX_FIELD_LENGTH_DIGITS || start > log.size ()
+        || log[start - 1] != ':' || length >= log.size () - start || log[start + length] != terminator)
+    {
+      return false;
+    }
+    field = log.substr (start, length);
+    pos = start + length + 1;
+    return true;
+  }
+
+  // keys may hold any byte, a newline included, so both fields go with their length in front
+  void WritePrefixedString (Aws::OFStream& log, const Aws::String& field, char terminator)
+  {
+    log << field.size () << ':' << field << terminator;
+  }
+}
+
+SQSS3PayloadReaper::SQSS3PayloadReaper (const std::shared_ptr<Aws::S3::S3Client>& s3Client, unsigned maxConcurrency,
+                                        unsigned maxRetries, const Aws::String& logPath) :
+    m_s3Client (s3Client), m_maxRetries (maxRetries), m_reaping (0), m_reapedDeletes (0), m_failedDeletes (0),
+    m_shutdown (false), m_logPath (logPath), m_reapedLines (0)
+{
+  RecoverLog ();
+
+  for (unsigned i = 0; i < std::max (maxConcurrency, 1u); ++i)
+  {
+    m_reaperStates.push_back (Aws::MakeShared<Reaper> (ALLOCATION_TAG));
+    m_reaperStates.back ()->detached = false;
+    m_reapers.push_back (std::thread (&SQSS3PayloadReaper::Reap, this, m_reaperStates.back ()));
+  }
+}
+
+SQSS3PayloadReaper::~SQSS3PayloadReaper ()
+{
+  Shutdown ();
+}
+
+bool SQSS3PayloadReaper::Enqueue (const Aws::String& s3BucketName, const Aws::String& s3Key)
+{
+  PendingDelete pendingDelete;
+  pendingDelete.s3BucketName = s3BucketName;
+  pendingDelete.s3Key = s3Key;
+
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    if (m_shutdown)
+    {
+      return false;
+    }
+    WriteLog ('+', pendingDelete);
+    m_pending.push_back (pendingDelete);
+  }
+  m_workAvailable.notify_one ();
+  return true;
+}
+
+void SQSS3PayloadReaper::Flush ()
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_drained.wait (lock, [this] ()
+  {
+    return m_pending.empty () && m_reaping == 0;
+  });
+}
+
+void SQSS3PayloadReaper::Shutdown ()
+{
+  bool isReaper = false;
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_shutdown = true;
+    for (size_t i = 0; i < m_reapers.size (); ++i)
+    {
+      if (m_reapers[i].joinable () && m_reapers[i].get_id () == std::this_thread::get_id ())
+      {
+        m_reaperStates[i]->detached = true;
+        m_reapers[i].detach ();
+        m_reaping -= m_reaperStates[i]->pendingDeletes.size ();
+        isReaper = true;
+      }
+    }
+  }
+  m_workAvailable.notify_all ();
+  m_shutdownRequested.notify_all ();
+
+  for (auto& reaper : m_reapers)
+  {
+    if (reaper.joinable ())
+    {
+      reaper.join ();
+    }
+  }
+
+  // a detached reaper's keys stay pending in the log, what the others left is deleted from here without retries
+  std::unique_lock<std::mutex> lock (m_mutex);
+  while (isReaper && !m_pending.empty ())
+  {
+    Aws::Vector<PendingDelete> pendingDeletes;
+    SQSS3PayloadReaper::TakeBatch (pendingDeletes);
+    lock.unlock ();
+    Aws::Vector<PendingDelete> failedDeletes = SQSS3PayloadReaper::DeleteFromS3 (pendingDeletes);
+    lock.lock ();
+    SQSS3PayloadReaper::MarkReaped (pendingDeletes, failedDeletes);
+  }
+  if (m_pending.empty () && m_reaping == 0)
+  {
+    m_drained.notify_all ();
+  }
+
+  // only the keys given up are pending now, the next reaper starts from a log holding them alone
+  if (m_log.is_open ())
+  {
+    RewriteLog ();
+    m_log.close ();
+  }
+}
+
+size_t SQSS3PayloadReaper::GetPendingDeletes ()
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+  return m_pending.size () + m_reaping;
+}
+
+size_t SQSS3PayloadReaper::GetReapedDeletes ()
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+  return m_reapedDeletes;
+}
+
+size_t SQSS3PayloadReaper::GetFailedDeletes ()
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+  return m_failedDeletes;
+}
+
+void SQSS3PayloadReaper::Reap (std::shared_ptr<Reaper> reaper)
+{
+  // only filled and cleared under the lock, the log compaction reads it meanwhile
+  Aws::Vector<PendingDelete>& pendingDeletes = reaper->pendingDeletes;
+  while (true)
+  {
+    // consecutive keys of the same bucket go in a single multi-object delete
+    {
+      std::unique_lock<std::mutex> lock (m_mutex);
+      m_workAvailable.wait (lock, [this] ()
+      {
+        return m_shutdown || !m_pending.empty ();
+      });
+      if (m_pending.empty ())
+      {
+        return;
+      }
+      SQSS3PayloadReaper::TakeBatch (pendingDeletes);
+    }
+
+    Aws::Vector<PendingDelete> failedDeletes = SQSS3PayloadReaper::DeleteFromS3 (pendingDeletes);
+    for (unsigned retry = 0; !reaper->detached && !failedDeletes.empty () && retry < m_maxRetries; ++retry)
+    {
+      std::unique_lock<std::mutex> lock (m_mutex);
+      if (m_shutdownRequested.wait_for (lock, DELETE_RETRY_DELAY * (1 << std::min (retry, 8u)), [this] ()
+      {
+        return m_shutdown;
+      }))
+      {
+        break;
+      }
+      lock.unlock ();
+      failedDeletes = SQSS3PayloadReaper::DeleteFromS3 (failedDeletes);
+    }
+    if (reaper->detached)
+    {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock (m_mutex);
+    SQSS3PayloadReaper::MarkReaped (pendingDeletes, failedDeletes);
+  }
+}
+
+void SQSS3PayloadReaper::TakeBatch (Aws::Vector<PendingDelete>& pendingDeletes)
+{
+  while (!m_pending.empty () && pendingDeletes.size () < DELETE_OBJECTS_MAX_KEYS
+      && (pendingDeletes.empty () || m_pending.front ().s3BucketName == pendingDeletes[0].s3BucketName))
+  {
+    pendingDeletes.push_back (m_pending.front ());
+    m_pending.pop_front ();
+  }
+  m_reaping += pendingDeletes.size ();
+}
+
+void SQSS3PayloadReaper::MarkReaped (Aws::Vector<PendingDelete>& pendingDeletes,
+                                     const Aws::Vector<PendingDelete>& failedDeletes)
+{
+  // given up keys stay unmarked in the log, for the next reaper to try again
+  Aws::Map<Aws::String, size_t> givenUp;
+  for (auto& failedDelete : failedDeletes)
+  {
+    ++givenUp[failedDelete.s3BucketName + ' ' + failedDelete.s3Key];
+  }
+
+  for (auto& pendingDelete : pendingDeletes)
+  {
+    auto givenUpEntry = givenUp.find (pendingDelete.s3BucketName + ' ' + pendingDelete.s3Key);
+    if (givenUpEntry != givenUp.end () && givenUpEntry->second > 0)
+    {
+      --givenUpEntry->second;
+      continue;
+    }
+    WriteLog ('-', pendingDelete);
+    ++m_reapedLines;
+  }
+  if (m_log.is_open ())
+  {
+    m_givenUp.insert (m_givenUp.end (), failedDeletes.begin (), failedDeletes.end ());
+  }
+  m_reapedDeletes += pendingDeletes.size () - failedDeletes.size ();
+  m_failedDeletes += failedDeletes.size ();
+  m_reaping -= pendingDeletes.size ();
+  pendingDeletes.clear ();
+  CompactLog ();
+  if (m_pending.empty () && m_reaping == 0)
+  {
+    m_drained.notify_all ();
+  }
+}
+
+Aws::Vector<SQSS3PayloadReaper::PendingDelete> SQSS3PayloadReaper::DeleteFromS3 (
+    const Aws::Vector<PendingDelete>& pendingDeletes) const
+{
+  // quiet mode only reports the keys that could not be deleted
+  Aws::S3::Model::Delete objectsToDelete;
+  objectsToDelete.SetQuiet (true);
+  for (auto& pendingDelete : pendingDeletes)
+  {
+    ObjectIdentifier objectIdentifier;
+    objectIdentifier.SetKey (pendingDelete.s3Key);
+    objectsToDelete.AddObjects (objectIdentifier);
+  }
+
+  DeleteObjectsRequest deleteObjectsRequest;
+  deleteObjectsRequest.SetBucket (pendingDeletes[0].s3BucketName);
+  deleteObjectsRequest.SetDelete (objectsToDelete);
+  DeleteObjectsOutcome deleteObjectsOutcome = m_s3Client->DeleteObjects (deleteObjectsRequest);
+  if (!deleteObjectsOutcome.IsSuccess ())
+  {
+    return pendingDeletes;
+  }
+
+  Aws::Vector<PendingDelete> failedDeletes;
+  for (auto& error : deleteObjectsOutcome.GetResult ().GetErrors ())
+  {
+    for (auto& pendingDelete : pendingDeletes)
+    {
+      if (pendingDelete.s3Key == error.GetKey ())
+      {
+        failedDeletes.push_back (pendingDelete);
+        break;
+      }
+    }
+  }
+  return failedDeletes;
+}
+
+void SQSS3PayloadReaper::RecoverLog ()
+{
+  if (m_logPath.empty ())
+  {
+    return;
+  }
+
+  // every entry is an operation, a bucket and a key, "+" once enqueued and "-" once reaped
+  Aws::IFStream logFile (m_logPath.c_str (), std::ios_base::in | std::ios_base::binary);
+  Aws::String log ((std::istreambuf_iterator<char> (logFile)), std::istreambuf_iterator<char> ());
+  logFile.close ();
+
+  Aws::Vector<PendingDelete> enqueued;
+  Aws::Map<Aws::String, size_t> reaped;
+  size_t pos = 0;
+  while (pos + 2 < log.size () && (log[pos] == '+' || log[pos] == '-') && log[pos + 1] == ' ')
+  {
+    // an entry cut short by a crash ends the log, its key could name another object
+    char operation = log[pos];
+    pos += 2;
+    PendingDelete pendingDelete;
+    if (!ReadPrefixedString (log, pos, ' ', pendingDelete.s3BucketName)
+        || !ReadPrefixedString (log, pos, '\n', pendingDelete.s3Key))
+    {
+      break;
+    }
+    if (operation == '+')
+    {
+      enqueued.push_back (pendingDelete);
+    }
+    else
+    {
+      ++reaped[pendingDelete.s3BucketName + ' ' + pendingDelete.s3Key];
+    }
+  }
+
+  for (auto& pendingDelete : enqueued)
+  {
+    auto reapedEntry = reaped.find (pendingDelete.s3BucketName + ' ' + pendingDelete.s3Key);
+    if (reapedEntry != reaped.end () && reapedEntry->second > 0)
+    {
+      --reapedEntry->second;
+      continue;
+    }
+    m_pending.push_back (pendingDelete);
+  }
+
+  // rewrite the log with the keys still pending only, so it does not grow across restarts
+  RewriteLog ();
+}
+
+void SQSS3PayloadReaper::RewriteLog ()
+{
+  // written aside and moved over the log, a crash meanwhile leaves the previous log whole
+  Aws::String rewrittenPath = m_logPath + ".rewrite";
+  m_log.close ();
+  m_log.open (rewrittenPath.c_str (), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+  for (auto& pendingDelete : m_givenUp)
+  {
+    WriteLog ('+', pendingDelete);
+  }
+  for (auto& reaper : m_reaperStates)
+  {
+    for (auto& pendingDelete : reaper->pendingDeletes)
+    {
+      WriteLog ('+', pendingDelete);
+    }
+  }
+  for (auto& pendingDelete : m_pending)
+  {
+    WriteLog ('+', pendingDelete);
+  }
+  m_log.close ();
+
+  // rename does not replace an existing file everywhere
+  if (std::rename (rewrittenPath.c_str (), m_logPath.c_str ()) != 0)
+  {
+    std::remove (m_logPath.c_str ());
+    std::rename (rewrittenPath.c_str (), m_logPath.c_str ());
+  }
+  m_log.open (m_logPath.c_str (), std::ios_base::out | std::ios_base::app | std::ios_base::binary);
+  m_reapedLines = 0;
+}
+
+void SQSS3PayloadReaper::CompactLog ()
+{
+  size_t pendingLines = m_givenUp.size () + m_reaping + m_pending.size ();
+  if (m_log.is_open () && m_reapedLines >= LOG_COMPACTION_MIN_LINES && m_reapedLines > pendingLines)
+  {
+    RewriteLog ();
+  }
+}
+
+void SQSS3PayloadReaper::WriteLog (char operation, const PendingDelete& pendingDelete)
+{
+  if (!m_log.is_open ())
+  {
+    return;
+  }
+  m_log << operation << ' ';
+  WritePrefixedString (m_log, pendingDelete.s3BucketName, ' ');
+  WritePrefixedString (m_log, pendingDelete.s3Key, '\n');
+  m_log.flush ();
+}
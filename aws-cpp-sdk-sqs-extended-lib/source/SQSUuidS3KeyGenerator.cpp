@@ -0,0 +1,125 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/sqs/extendedlib/SQSUuidS3KeyGenerator.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+
+using namespace Aws::SQS::ExtendedLib;
+
+namespace
+{
+  const char HEX_DIGITS[] = "0123456789abcdef";
+  const unsigned MAX_PREFIX_LENGTH = 16;
+
+  std::mt19937_64& ThreadRandomGenerator ()
+  {
+    // seeded once per thread; the thread id and clock keep seeds apart where random_device is weak
+    static thread_local std::mt19937_64 generator ([] ()
+    {
+      std::random_device device;
+      std::seed_seq seed
+      {
+        device (), device (), device (), device (),
+        static_cast<unsigned> (std::hash<std::thread::id> () (std::this_thread::get_id ())),
+        static_cast<unsigned> (std::chrono::high_resolution_clock::now ().time_since_epoch ().count ())
+      };
+      return std::mt19937_64 (seed);
+    } ());
+    return generator;
+  }
+
+  void AppendHex (Aws::String& key, unsigned long long value, unsigned digits)
+  {
+    for (unsigned i = digits; i > 0; --i)
+    {
+      key += HEX_DIGITS[(value >> ((i - 1) * 4)) & 0xf];
+    }
+  }
+
+  // fnv-1a, enough to spread names evenly and cheap compared to a request
+  unsigned long long HashName (const Aws::String& name)
+  {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (char c : name)
+    {
+      hash ^= static_cast<unsigned char> (c);
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+} // anonymous namespace
+
+SQSUuidS3KeyGenerator::SQSUuidS3KeyGenerator (SQSS3KeyFormat format, SQSS3KeyPrefix prefix, unsigned prefixLength) :
+    m_format (format), m_prefix (prefix), m_prefixLength (std::min (prefixLength, MAX_PREFIX_LENGTH))
+{
+}
+
+Aws::String SQSUuidS3KeyGenerator::GenerateKey () const
+{
+  std::mt19937_64& generator = ThreadRandomGenerator ();
+  unsigned long long high = generator ();
+  unsigned long long low = generator ();
+
+  if (m_format == SQSS3KeyFormat::UUID_V7)
+  {
+    unsigned long long millis = std::chrono::duration_cast<std::chrono::milliseconds> (
+        std::chrono::system_clock::now ().time_since_epoch ()).count ();
+    high = (millis << 16) | (high & 0x0fffULL) | 0x7000ULL;
+  }
+  else
+  {
+    high = (high & ~0xf000ULL) | 0x4000ULL;
+  }
+  low = (low & 0x3fffffffffffffffULL) | 0x8000000000000000ULL;
+
+  Aws::String key;
+  key.reserve (MAX_PREFIX_LENGTH + 37);
+  AppendHex (key, high >> 32, 8);
+  key += '-';
+  AppendHex (key, high >> 16, 4);
+  key += '-';
+  AppendHex (key, high, 4);
+  key += '-';
+  AppendHex (key, low >> 48, 4);
+  key += '-';
+  AppendHex (key, low, 12);
+
+  return PrefixKey (key, false);
+}
+
+Aws::String SQSUuidS3KeyGenerator::GenerateKey (const Aws::String& name) const
+{
+  return PrefixKey (name, true);
+}
+
+Aws::String SQSUuidS3KeyGenerator::PrefixKey (const Aws::String& key, bool isNamed) const
+{
+  if (m_prefix == SQSS3KeyPrefix::NONE || m_prefixLength == 0)
+  {
+    return key;
+  }
+
+  unsigned long long prefix = (m_prefix == SQSS3KeyPrefix::RANDOM && !isNamed)
+      ? ThreadRandomGenerator () () : HashName (key);
+
+  Aws::String prefixedKey;
+  prefixedKey.reserve (m_prefixLength + 1 + key.size ());
+  AppendHex (prefixedKey, prefix, m_prefixLength);
+  prefixedKey += '/';
+  prefixedKey += key;
+  return prefixedKey;
+}
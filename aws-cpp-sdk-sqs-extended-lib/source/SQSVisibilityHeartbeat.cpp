@@ -0,0 +1,339 @@
+/*
+ * Copyright 2010-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <aws/sqs/extendedlib/SQSVisibilityHeartbeat.h>
+#include <aws/sqs/model/ChangeMessageVisibilityBatchRequest.h>
+#include <aws/sqs/extendedlib/SQSBatchResultMapper.h>
+#include <algorithm>
+
+using namespace Aws;
+using namespace Aws::SQS;
+using namespace Aws::SQS::Model;
+using namespace Aws::SQS::ExtendedLib;
+
+static const size_t CHANGE_MESSAGE_VISIBILITY_BATCH_MAX_ENTRIES = 10;
+// a batch sqs failed as a whole is tried again after this, while the margin lasts
+static const std::chrono::seconds EXTENSION_RETRY_DELAY (1);
+static const char* ALLOCATION_TAG = "SQSVisibilityHeartbeat";
+
+SQSVisibilityHeartbeat::SQSVisibilityHeartbeat (const std::shared_ptr<SQSClient>& sqsClient,
+                                                std::chrono::seconds visibilityTimeout,
+                                                std::chrono::seconds extensionMargin) :
+    m_sqsClient (sqsClient), m_visibilityTimeout (visibilityTimeout),
+    m_extensionMargin (std::min (extensionMargin, visibilityTimeout)), m_shutdown (false),
+    m_detached (Aws::MakeShared<bool> (ALLOCATION_TAG, false))
+{
+  m_heartbeat = std::thread (&SQSVisibilityHeartbeat::Beat, this, m_detached);
+}
+
+SQSVisibilityHeartbeat::~SQSVisibilityHeartbeat ()
+{
+  Shutdown ();
+}
+
+void SQSVisibilityHeartbeat::Track (const Aws::String& queueUrl, const Aws::String& receiptHandle)
+{
+  TrackedMessage trackedMessage;
+  trackedMessage.nextExtension = Clock::now () + m_visibilityTimeout - m_extensionMargin;
+  trackedMessage.isExtending = false;
+
+  std::lock_guard<std::mutex> lock (m_mutex);
+  if (m_shutdown)
+  {
+    return;
+  }
+  m_tracked[queueUrl][receiptHandle] = trackedMessage;
+  m_wakeUp.notify_one ();
+}
+
+void SQSVisibilityHeartbeat::Untrack (const Aws::String& queueUrl, const Aws::String& receiptHandle)
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+  auto queueMessages = m_tracked.find (queueUrl);
+  if (queueMessages == m_tracked.end ())
+  {
+    return;
+  }
+  queueMessages->second.erase (receiptHandle);
+  if (queueMessages->second.empty ())
+  {
+    m_tracked.erase (queueMessages);
+  }
+}
+
+std::future<ChangeMessageVisibilityOutcome> SQSVisibilityHeartbeat::Nack (const Aws::String& queueUrl,
+                                                                          const Aws::String& receiptHandle)
+{
+  SQSVisibilityHeartbeat::Untrack (queueUrl, receiptHandle);
+
+  PendingNack pendingNack;
+  pendingNack.receiptHandle = receiptHandle;
+  std::future<ChangeMessageVisibilityOutcome> outcome = pendingNack.outcome.get_future ();
+
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    if (!m_shutdown)
+    {
+      m_nacks[queueUrl].push_back (std::move (pendingNack));
+      m_wakeUp.notify_one ();
+      return outcome;
+    }
+  }
+
+  ChangeMessageVisibilityRequest request;
+  request.SetQueueUrl (queueUrl);
+  request.SetReceiptHandle (receiptHandle);
+  request.SetVisibilityTimeout (0);
+  pendingNack.outcome.set_value (m_sqsClient->ChangeMessageVisibility (request));
+  return outcome;
+}
+
+size_t SQSVisibilityHeartbeat::GetTrackedCount () const
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+  size_t trackedCount = 0;
+  for (auto& queueMessages : m_tracked)
+  {
+    trackedCount += queueMessages.second.size ();
+  }
+  return trackedCount;
+}
+
+void SQSVisibilityHeartbeat::Shutdown ()
+{
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_shutdown = true;
+    m_tracked.clear ();
+  }
+  m_wakeUp.notify_all ();
+
+  if (!m_heartbeat.joinable ())
+  {
+    return;
+  }
+  if (m_heartbeat.get_id () == std::this_thread::get_id ())
+  {
+    *m_detached = true;
+    m_heartbeat.detach ();
+
+    std::unique_lock<std::mutex> lock (m_mutex);
+    while (!m_nacks.empty ())
+    {
+      Aws::String queueUrl;
+      Aws::Vector<PendingNack> pendingNacks = SQSVisibilityHeartbeat::TakeNackBatch (queueUrl);
+      lock.unlock ();
+      SQSVisibilityHeartbeat::NackBatch (queueUrl, pendingNacks);
+      lock.lock ();
+    }
+    return;
+  }
+  m_heartbeat.join ();
+}
+
+void SQSVisibilityHeartbeat::Beat (std::shared_ptr<bool> detached)
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  while (true)
+  {
+    // nacks go out right away, one queue at a time
+    if (!m_nacks.empty ())
+    {
+      Aws::String queueUrl;
+      Aws::Vector<PendingNack> pendingNacks = SQSVisibilityHeartbeat::TakeNackBatch (queueUrl);
+      lock.unlock ();
+      SQSVisibilityHeartbeat::NackBatch (queueUrl, pendingNacks);
+      if (*detached)
+      {
+        return;
+      }
+      lock.lock ();
+      continue;
+    }
+
+    if (m_shutdown)
+    {
+      return;
+    }
+
+    // a queue is extended once one of its messages is due, the others due within half the margin go along
+    Clock::time_point now = Clock::now ();
+    Clock::time_point coalesceUntil = now + m_extensionMargin / 2;
+    Clock::time_point wakeUp = Clock::time_point::max ();
+    Aws::String queueUrl;
+    Aws::Vector<Aws::String> receiptHandles;
+    for (auto& queueMessages : m_tracked)
+    {
+      bool isDue = false;
+      for (auto& trackedMessage : queueMessages.second)
+      {
+        if (!trackedMessage.second.isExtending)
+        {
+          isDue = isDue || trackedMessage.second.nextExtension <= now;
+          wakeUp = std::min (wakeUp, trackedMessage.second.nextExtension);
+        }
+      }
+      if (!isDue)
+      {
+        continue;
+      }
+
+      // overdue messages first, a queue with more than a batch of them gets another turn right after
+      for (auto deadline : { now, coalesceUntil })
+      {
+        for (auto& trackedMessage : queueMessages.second)
+        {
+          if (receiptHandles.size () < CHANGE_MESSAGE_VISIBILITY_BATCH_MAX_ENTRIES && !trackedMessage.second.isExtending
+              && trackedMessage.second.nextExtension <= deadline)
+          {
+            trackedMessage.second.isExtending = true;
+            receiptHandles.push_back (trackedMessage.first);
+          }
+        }
+      }
+      queueUrl = queueMessages.first;
+      break;
+    }
+
+    if (receiptHandles.empty ())
+    {
+      if (wakeUp == Clock::time_point::max ())
+      {
+        m_wakeUp.wait (lock);
+      }
+      else
+      {
+        m_wakeUp.wait_until (lock, wakeUp);
+      }
+      continue;
+    }
+
+    Aws::Vector<Clock::time_point> nextExtensions (receiptHandles.size ());
+    lock.unlock ();
+    SQSVisibilityHeartbeat::ExtendBatch (queueUrl, receiptHandles, nextExtensions);
+    if (*detached)
+    {
+      return;
+    }
+    lock.lock ();
+
+    // messages untracked meanwhile are gone already
+    auto queueMessages = m_tracked.find (queueUrl);
+    if (queueMessages == m_tracked.end ())
+    {
+      continue;
+    }
+    for (size_t i = 0; i < receiptHandles.size (); ++i)
+    {
+      auto trackedMessage = queueMessages->second.find (receiptHandles[i]);
+      if (trackedMessage == queueMessages->second.end ())
+      {
+        continue;
+      }
+      if (nextExtensions[i] == Clock::time_point::max ())
+      {
+        queueMessages->second.erase (trackedMessage);
+      }
+      else
+      {
+        trackedMessage->second.nextExtension = nextExtensions[i];
+        trackedMessage->second.isExtending = false;
+      }
+    }
+    if (queueMessages->second.empty ())
+    {
+      m_tracked.erase (queueMessages);
+    }
+  }
+}
+
+Aws::Vector<SQSVisibilityHeartbeat::PendingNack> SQSVisibilityHeartbeat::TakeNackBatch (Aws::String& queueUrl)
+{
+  auto queueNacks = m_nacks.begin ();
+  queueUrl = queueNacks->first;
+  Aws::Vector<PendingNack> pendingNacks;
+  while (!queueNacks->second.empty () && pendingNacks.size () < CHANGE_MESSAGE_VISIBILITY_BATCH_MAX_ENTRIES)
+  {
+    pendingNacks.push_back (std::move (queueNacks->second.front ()));
+    queueNacks->second.pop_front ();
+  }
+  if (queueNacks->second.empty ())
+  {
+    m_nacks.erase (queueNacks);
+  }
+  return pendingNacks;
+}
+
+void SQSVisibilityHeartbeat::ExtendBatch (const Aws::String& queueUrl, const Aws::Vector<Aws::String>& receiptHandles,
+                                          Aws::Vector<Clock::time_point>& nextExtensions) const
+{
+  ChangeMessageVisibilityBatchRequest request;
+  request.SetQueueUrl (queueUrl);
+  for (size_t i = 0; i < receiptHandles.size (); ++i)
+  {
+    ChangeMessageVisibilityBatchRequestEntry entry;
+    entry.SetId (SQSBatchResultMapper::GetEntryId (i));
+    entry.SetReceiptHandle (receiptHandles[i]);
+    entry.SetVisibilityTimeout (static_cast<int> (m_visibilityTimeout.count ()));
+    request.AddEntries (entry);
+  }
+
+  // the new timeout runs from the request on, time_point::max marks the messages to stop tracking, the timeouts are
+  // read ahead since a Shutdown from within the request may destroy the heartbeat
+  Clock::duration extendedFor = m_visibilityTimeout - m_extensionMargin;
+  Clock::time_point sentAt = Clock::now ();
+  Aws::Vector<ChangeMessageVisibilityOutcome> outcomes = SQSVisibilityHeartbeat::ChangeVisibilityBatch (request);
+  for (size_t i = 0; i < outcomes.size (); ++i)
+  {
+    if (outcomes[i].IsSuccess ())
+    {
+      nextExtensions[i] = sentAt + extendedFor;
+    }
+    else
+    {
+      nextExtensions[i] = outcomes[i].GetError ().ShouldRetry () ? sentAt + EXTENSION_RETRY_DELAY : Clock::time_point::max ();
+    }
+  }
+}
+
+void SQSVisibilityHeartbeat::NackBatch (const Aws::String& queueUrl, Aws::Vector<PendingNack>& pendingNacks) const
+{
+  ChangeMessageVisibilityBatchRequest request;
+  request.SetQueueUrl (queueUrl);
+  for (size_t i = 0; i < pendingNacks.size (); ++i)
+  {
+    ChangeMessageVisibilityBatchRequestEntry entry;
+    entry.SetId (SQSBatchResultMapper::GetEntryId (i));
+    entry.SetReceiptHandle (pendingNacks[i].receiptHandle);
+    entry.SetVisibilityTimeout (0);
+    request.AddEntries (entry);
+  }
+
+  Aws::Vector<ChangeMessageVisibilityOutcome> outcomes = SQSVisibilityHeartbeat::ChangeVisibilityBatch (request);
+  for (size_t i = 0; i < pendingNacks.size (); ++i)
+  {
+    pendingNacks[i].outcome.set_value (outcomes[i]);
+  }
+}
+
+Aws::Vector<ChangeMessageVisibilityOutcome> SQSVisibilityHeartbeat::ChangeVisibilityBatch (
+    const ChangeMessageVisibilityBatchRequest& request) const
+{
+  ChangeMessageVisibilityBatchOutcome outcome = m_sqsClient->ChangeMessageVisibilityBatch (request);
+  return SQSBatchResultMapper::Map<ChangeMessageVisibilityOutcome> (
+      outcome, request.GetEntries ().size (), [] (const ChangeMessageVisibilityBatchResultEntry&)
+  {
+    return ChangeMessageVisibilityOutcome (NoResult ());
+  });
+}